@@ -0,0 +1,358 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteAsyncBus.h"
+#include "WeatherBusLiteSerial.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * Constructor.
+ *
+ * @param loop The event loop the bus's coroutines run on
+ * @param fd Non-blocking descriptor of the bus, see weatherBusLiteOpenSerial
+ */
+WeatherBusLiteAsyncBus::WeatherBusLiteAsyncBus(WeatherBusLiteEventLoop &loop, int fd)
+    : _loop(loop), _fd(fd), _head(0), _tail(0) {}
+
+/**
+ * Query the temperature.
+ *
+ * @param temperature The temperature
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryTemp(float &temperature) {
+    return request('T', temperature, nullptr);
+}
+
+/**
+ * Query the temperature with its quality flags.
+ *
+ * @param temperature The temperature
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryTemp(float &temperature, uint8_t &flags) {
+    return request('T', temperature, &flags);
+}
+
+/**
+ * Query the humidity.
+ *
+ * @param humidity The humidity
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryHumidity(float &humidity) {
+    return request('H', humidity, nullptr);
+}
+
+/**
+ * Query the humidity with its quality flags.
+ *
+ * @param humidity The humidity
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryHumidity(float &humidity, uint8_t &flags) {
+    return request('H', humidity, &flags);
+}
+
+/**
+ * Query the pressure.
+ *
+ * @param pressure The pressure
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryPressure(float &pressure) {
+    return request('P', pressure, nullptr);
+}
+
+/**
+ * Query the pressure with its quality flags.
+ *
+ * @param pressure The pressure
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryPressure(float &pressure, uint8_t &flags) {
+    return request('P', pressure, &flags);
+}
+
+/**
+ * Query the air quality.
+ *
+ * @param airQuality The air quality
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryAirQuality(float &airQuality) {
+    return request('A', airQuality, nullptr);
+}
+
+/**
+ * Query the air quality with its quality flags.
+ *
+ * @param airQuality The air quality
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryAirQuality(float &airQuality, uint8_t &flags) {
+    return request('A', airQuality, &flags);
+}
+
+/**
+ * Query the UV index.
+ *
+ * @param uv The UV index
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryUV(float &uv) {
+    return request('U', uv, nullptr);
+}
+
+/**
+ * Query the UV index with its quality flags.
+ *
+ * @param uv The UV index
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryUV(float &uv, uint8_t &flags) {
+    return request('U', uv, &flags);
+}
+
+/**
+ * Query the rainfall.
+ *
+ * @param rainfall The rainfall
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryRainfall(float &rainfall) {
+    return request('R', rainfall, nullptr);
+}
+
+/**
+ * Query the rainfall with its quality flags.
+ *
+ * @param rainfall The rainfall
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryRainfall(float &rainfall, uint8_t &flags) {
+    return request('R', rainfall, &flags);
+}
+
+/**
+ * Query the wind speed.
+ *
+ * @param windSpeed The wind speed
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryWindSpeed(float &windSpeed) {
+    return request('W', windSpeed, nullptr);
+}
+
+/**
+ * Query the wind speed with its quality flags.
+ *
+ * @param windSpeed The wind speed
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryWindSpeed(float &windSpeed, uint8_t &flags) {
+    return request('W', windSpeed, &flags);
+}
+
+/**
+ * Query the wind direction.
+ *
+ * @param windDirection The wind direction
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryWindDirection(float &windDirection) {
+    return request('D', windDirection, nullptr);
+}
+
+/**
+ * Query the wind direction with its quality flags.
+ *
+ * @param windDirection The wind direction
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryWindDirection(float &windDirection, uint8_t &flags) {
+    return request('D', windDirection, &flags);
+}
+
+/**
+ * Query the canopy temperature.
+ *
+ * @param canopyTemperature The canopy temperature
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryCanopyTemperature(float &canopyTemperature) {
+    return request('C', canopyTemperature, nullptr);
+}
+
+/**
+ * Query the canopy temperature with its quality flags.
+ *
+ * @param canopyTemperature The canopy temperature
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryCanopyTemperature(float &canopyTemperature, uint8_t &flags) {
+    return request('C', canopyTemperature, &flags);
+}
+
+/**
+ * Query a custom sensor.
+ *
+ * @param queryType The type of the sensor
+ * @param value The value
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryCustom(char queryType, float &value) {
+    return request(queryType, value, nullptr);
+}
+
+/**
+ * Query a custom sensor with its quality flags.
+ *
+ * @param queryType The type of the sensor
+ * @param value The value
+ * @param flags The quality flags (WEATHERBUSLITE_FLAG_*)
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::queryCustom(char queryType, float &value, uint8_t &flags) {
+    return request(queryType, value, &flags);
+}
+
+/**
+ * Query a sensor. Every public query returns this coroutine directly, so
+ * a query is two coroutine frames: this one and readFrame.
+ *
+ * @param queryType The type of the sensor
+ * @param value The value
+ * @param flags The quality flags, or nullptr
+ * @return Awaitable yielding true if successful, false otherwise
+ */
+WeatherBusLiteTask<bool> WeatherBusLiteAsyncBus::request(char queryType, float &value, uint8_t *flags) {
+    char query[3] = {'?', queryType, '\0'};
+    if (!sendQuery(query)) {
+        co_return false;
+    }
+    char frame[64];
+    if (co_await readFrame(queryType, frame, sizeof(frame)) < 0) {
+        co_return false;
+    }
+    WeatherBusLiteFields fields;
+    if (!weatherBusLiteParseReading(frame, value, fields)) {
+        co_return false;
+    }
+    if (flags != nullptr) {
+        *flags = fields.flags;
+    }
+    co_return true;
+}
+
+/**
+ * Send a query without waiting.
+ *
+ * Bytes still buffered from an earlier exchange, here or in the driver,
+ * are dropped, like a late reply the Arduino master never reads. A full
+ * transmit buffer is waited on for up to the response timeout; a query
+ * never fills a healthy one, so this does not stall the event loop.
+ *
+ * @param query The query, e.g. "?T"
+ * @return True if the whole query was written, false otherwise
+ */
+bool WeatherBusLiteAsyncBus::sendQuery(const char *query) {
+    _head = _tail = 0;
+    tcflush(_fd, TCIFLUSH);  // Fails harmlessly if the bus is not a tty
+
+    char line[32];
+    size_t length = strlen(query);
+    if (length + 2 > sizeof(line)) {
+        return false;
+    }
+    memcpy(line, query, length);
+    line[length++] = '\r';
+    line[length++] = '\n';
+
+    uint64_t deadline = weatherBusLiteNanos() + WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT * 1000000ULL;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(_fd, line + written, length - written);
+        if (n > 0) {
+            written += n;
+        } else if (n < 0 && errno == EAGAIN) {
+            uint64_t now = weatherBusLiteNanos();
+            if (now >= deadline) {
+                return false;
+            }
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            poll(&pfd, 1, (int)((deadline - now + 999999ULL) / 1000000ULL));
+        } else if (n < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read a response frame.
+ *
+ * Reads before waiting, so a reply that is already buffered costs no
+ * trip through the event loop.
+ *
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame
+ * @param size Size of the buffer
+ * @param timeout Maximum wait in ms
+ * @return Awaitable yielding the length of the frame, -1 on timeout
+ */
+WeatherBusLiteTask<int> WeatherBusLiteAsyncBus::readFrame(char expectedType, char *frame, size_t size, int timeout) {
+    WeatherBusLiteDecoder decoder(frame, size);
+    decoder.begin(expectedType);
+
+    uint64_t deadline = weatherBusLiteNanos() + (uint64_t)timeout * 1000000ULL;
+    for (;;) {
+        while (_head < _tail) {
+            if (decoder.feedPlain(_buffer[_head++])) {
+                co_return (int)decoder.length();
+            }
+        }
+        ssize_t count = read(_fd, _buffer, sizeof(_buffer));
+        if (count > 0) {
+            _head = 0;
+            _tail = count;
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EINTR) {
+            co_return -1;
+        }  // A terminal with VMIN=0 returns 0 rather than EAGAIN when it is empty
+        if (!co_await _loop.readable(_fd, deadline)) {
+            co_return -1;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef WEATHERBUSLITE_ASYNC_BUS_H
+#define WEATHERBUSLITE_ASYNC_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WeatherBusLiteDecoder.h"
+#include "WeatherBusLiteEventLoop.h"
+#include "WeatherBusLiteHostBus.h"
+#include "WeatherBusLiteTask.h"
+
+// co_await-able master for one bus on a WeatherBusLiteEventLoop (C++20).
+// Same queries and results as the blocking WeatherBusLite methods; while
+// a query waits for its reply the loop runs other buses' coroutines.
+// Out-parameters must outlive the await, which they do when awaited
+// directly as in `if (co_await bus.queryTemp(t))`.
+class WeatherBusLiteAsyncBus {
+public:
+    WeatherBusLiteAsyncBus(WeatherBusLiteEventLoop &loop, int fd);
+
+    WeatherBusLiteTask<bool> queryTemp(float &temperature);
+    WeatherBusLiteTask<bool> queryTemp(float &temperature, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryHumidity(float &humidity);
+    WeatherBusLiteTask<bool> queryHumidity(float &humidity, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryPressure(float &pressure);
+    WeatherBusLiteTask<bool> queryPressure(float &pressure, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryAirQuality(float &airQuality);
+    WeatherBusLiteTask<bool> queryAirQuality(float &airQuality, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryUV(float &uv);
+    WeatherBusLiteTask<bool> queryUV(float &uv, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryRainfall(float &rainfall);
+    WeatherBusLiteTask<bool> queryRainfall(float &rainfall, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryWindSpeed(float &windSpeed);
+    WeatherBusLiteTask<bool> queryWindSpeed(float &windSpeed, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryWindDirection(float &windDirection);
+    WeatherBusLiteTask<bool> queryWindDirection(float &windDirection, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryCanopyTemperature(float &canopyTemperature);
+    WeatherBusLiteTask<bool> queryCanopyTemperature(float &canopyTemperature, uint8_t &flags);
+    WeatherBusLiteTask<bool> queryCustom(char queryType, float &value);
+    WeatherBusLiteTask<bool> queryCustom(char queryType, float &value, uint8_t &flags);
+
+    bool sendQuery(const char *query);
+    WeatherBusLiteTask<int> readFrame(char expectedType, char *frame, size_t size, int timeout = WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT);
+
+private:
+    WeatherBusLiteTask<bool> request(char queryType, float &value, uint8_t *flags);
+
+    WeatherBusLiteEventLoop &_loop;
+    int _fd;
+    char _buffer[WEATHERBUSLITE_HOST_READ_SIZE];
+    size_t _head;  // First unread byte
+    size_t _tail;  // End of the read bytes
+};
+
+#endif
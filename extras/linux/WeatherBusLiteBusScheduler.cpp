@@ -0,0 +1,451 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteBusScheduler.h"
+#include "WeatherBusLiteSerial.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define EVENT_READABLE 0x01
+#define EVENT_TIMER 0x02
+#define TASK_QUEUED 0x80000000u
+
+// epoll tag of the kick eventfd; bus tags are index * 2 (+1 for the timer)
+#define KICK_TAG UINT64_MAX
+
+/**
+ * Add one to the kick eventfd, retrying if a signal interrupts the write.
+ * EAGAIN means the counter is full, so a kick is pending anyway.
+ *
+ * @param fd The eventfd
+ */
+static void kick(int fd) {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * Constructor of a bus task.
+ *
+ * @param index Index of the bus
+ * @param fd Descriptor of the bus
+ * @param types Sensor types to sweep
+ * @param sweepInterval ms between sweep starts
+ */
+WeatherBusLiteBusScheduler::Task::Task(int index, int fd, const char *types, unsigned long sweepInterval)
+    : index(index), fd(fd), timerFd(-1), types(types), sweepInterval(sweepInterval), state(SWEEP_DUE),
+      next(0), sweepStart(0), queried(0), decoder(frame, sizeof(frame)), pending(0) {}
+
+/**
+ * Constructor.
+ *
+ * @param handler Called for every reading, from any worker thread
+ * @param workers Number of worker threads
+ */
+WeatherBusLiteBusScheduler::WeatherBusLiteBusScheduler(Handler handler, int workers)
+    : _handler(handler), _epollFd(-1), _kickFd(-1), _running(false), _idle(0), _steals(0) {
+    for (int i = 0; i < (workers > 0 ? workers : 1); i++) {
+        _workers.emplace_back(new Worker());
+    }
+}
+
+/**
+ * Destructor. Stops the workers; the bus descriptors stay open.
+ */
+WeatherBusLiteBusScheduler::~WeatherBusLiteBusScheduler() {
+    stop();
+}
+
+/**
+ * Add a bus. Only allowed before start().
+ *
+ * @param fd Non-blocking descriptor of the bus, see weatherBusLiteOpenSerial
+ * @param types Sensor types to sweep, e.g. "THP"
+ * @param sweepInterval ms between sweep starts, 0 to sweep back to back
+ * @return Index of the bus in readings, -1 if running or types is empty
+ */
+int WeatherBusLiteBusScheduler::addBus(int fd, const char *types, unsigned long sweepInterval) {
+    if (_running || types[0] == '\0') {
+        return -1;
+    }
+    _tasks.emplace_back(new Task(_tasks.size(), fd, types, sweepInterval));
+    return _tasks.size() - 1;
+}
+
+/**
+ * Set a handler called when a bus completes a sweep, from any worker
+ * thread. Only allowed before start().
+ *
+ * @param handler Gets the bus index and the sweep's start and end in
+ *                weatherBusLiteNanos() time
+ */
+void WeatherBusLiteBusScheduler::setSweepHandler(SweepHandler handler) {
+    _sweepHandler = handler;
+}
+
+/**
+ * Register every bus with epoll and start the workers.
+ *
+ * @return True if started, false if already running or setup failed
+ */
+bool WeatherBusLiteBusScheduler::start() {
+    if (_running) {
+        return false;
+    }
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _kickFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_epollFd < 0 || _kickFd < 0) {
+        release();
+        return false;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = KICK_TAG;
+    epoll_ctl(_epollFd, EPOLL_CTL_ADD, _kickFd, &event);
+
+    for (size_t i = 0; i < _tasks.size(); i++) {
+        Task *task = _tasks[i].get();
+        task->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (task->timerFd < 0) {
+            release();
+            return false;
+        }
+        event.events = EPOLLIN | EPOLLET;
+        event.data.u64 = i * 2;
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, task->fd, &event) < 0) {
+            release();
+            return false;
+        }
+        event.data.u64 = i * 2 + 1;
+        epoll_ctl(_epollFd, EPOLL_CTL_ADD, task->timerFd, &event);
+
+        // Every bus starts with a sweep, spread over the workers
+        task->pending.store(TASK_QUEUED);
+        _workers[i % _workers.size()]->tasks.push_back(task);
+    }
+
+    _running = true;
+    for (size_t i = 0; i < _workers.size(); i++) {
+        _workers[i]->thread = std::thread(&WeatherBusLiteBusScheduler::work, this, (int)i);
+    }
+    return true;
+}
+
+/**
+ * Stop the workers.
+ *
+ * A query in progress is abandoned; its reply is read and dropped by the
+ * next master that uses the bus. A later start() begins every bus with a
+ * new sweep.
+ */
+void WeatherBusLiteBusScheduler::stop() {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    for (size_t i = 0; i < _workers.size(); i++) {
+        kick(_kickFd);
+    }
+    for (size_t i = 0; i < _workers.size(); i++) {
+        _workers[i]->thread.join();
+    }
+    release();
+}
+
+/**
+ * Close the descriptors start() opened and put every bus back to the
+ * start of a sweep, with nothing queued. Workers must not be running.
+ */
+void WeatherBusLiteBusScheduler::release() {
+    for (size_t i = 0; i < _workers.size(); i++) {
+        _workers[i]->tasks.clear();
+    }
+    for (size_t i = 0; i < _tasks.size(); i++) {
+        Task *task = _tasks[i].get();
+        if (task->timerFd >= 0) {
+            close(task->timerFd);
+            task->timerFd = -1;
+        }
+        task->state = SWEEP_DUE;
+        task->next = 0;
+        task->pending.store(0);
+    }
+    if (_kickFd >= 0) {
+        close(_kickFd);
+    }
+    if (_epollFd >= 0) {
+        close(_epollFd);
+    }
+    _kickFd = _epollFd = -1;
+}
+
+/**
+ * Tasks workers took from another worker's deque.
+ *
+ * @return Number of steals
+ */
+uint64_t WeatherBusLiteBusScheduler::steals() const {
+    return _steals.load(std::memory_order_relaxed);
+}
+
+/**
+ * Worker thread.
+ *
+ * @param index Index of the worker
+ */
+void WeatherBusLiteBusScheduler::work(int index) {
+    Worker &worker = *_workers[index];
+    struct epoll_event events[WEATHERBUSLITE_BUS_SCHEDULER_EVENTS];
+    while (_running.load(std::memory_order_relaxed)) {
+        Task *task;
+        if (take(index, task)) {
+            run(task);
+            continue;
+        }
+
+        _idle.fetch_add(1);
+        int count = epoll_wait(_epollFd, events, WEATHERBUSLITE_BUS_SCHEDULER_EVENTS, 100);
+        _idle.fetch_sub(1);
+        for (int i = 0; i < count; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == KICK_TAG) {
+                uint64_t value;
+                while (read(_kickFd, &value, sizeof(value)) < 0 && errno == EINTR) {
+                }  // EAGAIN if another worker drained it first
+                continue;
+            }
+            notify(index, _tasks[tag / 2].get(), tag % 2 ? EVENT_TIMER : EVENT_READABLE);
+        }
+
+        // Let sleeping workers share a burst of events
+        bool backlog;
+        {
+            std::lock_guard<std::mutex> lock(worker.lock);
+            backlog = worker.tasks.size() > 1;
+        }
+        if (backlog && _idle.load() > 0) {
+            kick(_kickFd);
+        }
+    }
+}
+
+/**
+ * Take a runnable task, stealing if the worker's own deque is empty.
+ *
+ * @param index Index of the worker
+ * @param task The task
+ * @return True if a task was taken, false if there is no work
+ */
+bool WeatherBusLiteBusScheduler::take(int index, Task *&task) {
+    {
+        Worker &own = *_workers[index];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();  // Newest first, its bytes are still hot
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < _workers.size(); i++) {
+        Worker &victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();  // Oldest, least likely to be hot for the victim
+            victim.tasks.pop_front();
+            _steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Record events for a task and queue it unless it is queued or running.
+ *
+ * @param index Index of the worker that saw the events
+ * @param task The task
+ * @param events EVENT_* bits
+ */
+void WeatherBusLiteBusScheduler::notify(int index, Task *task, uint32_t events) {
+    uint32_t previous = task->pending.fetch_or(events | TASK_QUEUED);
+    if (previous & TASK_QUEUED) {
+        return;  // Whoever runs it will see the new bits
+    }
+    Worker &worker = *_workers[index];
+    std::lock_guard<std::mutex> lock(worker.lock);
+    worker.tasks.push_back(task);
+}
+
+/**
+ * Run a task until it has no more events.
+ *
+ * @param task The task
+ */
+void WeatherBusLiteBusScheduler::run(Task *task) {
+    for (;;) {
+        uint32_t events = task->pending.exchange(TASK_QUEUED) & ~TASK_QUEUED;
+        step(task, events);
+        uint32_t expected = TASK_QUEUED;
+        if (task->pending.compare_exchange_strong(expected, 0)) {
+            return;  // No events arrived while running
+        }
+    }
+}
+
+/**
+ * Advance a bus's state machine.
+ *
+ * @param task The task
+ * @param events EVENT_* bits
+ */
+void WeatherBusLiteBusScheduler::step(Task *task, uint32_t events) {
+    if (events & EVENT_READABLE) {
+        // Edge-triggered, so read until the descriptor is empty
+        char buffer[WEATHERBUSLITE_HOST_READ_SIZE];
+        ssize_t count;
+        while ((count = read(task->fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t i = 0; i < count && task->state == WAIT_FOR_REPLY; i++) {
+                if (task->decoder.feedPlain(buffer[i])) {
+                    float value;
+                    WeatherBusLiteFields fields;
+                    bool ok = weatherBusLiteParseReading(task->frame, value, fields);
+                    finish(task, ok, value, ok ? fields.flags : 0);
+                    break;  // The rest belongs to no query, like HostBus::sendQuery drops it
+                }
+            }
+        }
+    }
+
+    if (events & EVENT_TIMER) {
+        uint64_t expirations;
+        if (read(task->timerFd, &expirations, sizeof(expirations)) > 0) {  // Not if rearmed since
+            if (task->state == WAIT_FOR_REPLY) {
+                finish(task, false, 0, 0);
+            } else if (task->state == WAIT_FOR_SWEEP) {
+                task->state = SWEEP_DUE;
+            }
+        }
+    }
+
+    if (task->state == SWEEP_DUE) {
+        task->sweepStart = weatherBusLiteNanos();
+        task->next = 0;
+        sendNext(task);
+    }
+}
+
+/**
+ * Query the next sensor of the sweep, or end the sweep.
+ *
+ * A query the bus does not take whole fails at once, since no reply can
+ * come. A sweep with such a failure waits at least the response timeout
+ * before the next one, so a bus that takes no bytes is not spun on.
+ *
+ * @param task The task
+ */
+void WeatherBusLiteBusScheduler::sendNext(Task *task) {
+    bool refused = false;
+    for (;;) {
+        uint64_t now = weatherBusLiteNanos();
+        if (task->next >= task->types.size()) {
+            if (_sweepHandler) {
+                _sweepHandler(task->index, task->sweepStart, now);
+            }
+            uint64_t elapsed = (now - task->sweepStart) / 1000000ULL;
+            unsigned long wait = task->sweepInterval > elapsed ? task->sweepInterval - elapsed : 0;
+            if (refused && wait < WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT) {
+                wait = WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT;
+            }
+            if (wait > 0) {
+                task->state = WAIT_FOR_SWEEP;
+                arm(task, wait);
+                return;
+            }
+            task->sweepStart = now;
+            task->next = 0;
+        }
+
+        char query[4] = {'?', task->types[task->next], '\r', '\n'};
+        task->decoder.begin(query[1]);
+        task->queried = now;
+        task->state = WAIT_FOR_REPLY;
+        arm(task, WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT);
+        ssize_t written;
+        while ((written = write(task->fd, query, sizeof(query))) < 0 && errno == EINTR) {
+        }
+        if (written == (ssize_t)sizeof(query)) {
+            return;
+        }
+        refused = true;
+        report(task, false, 0, 0);
+        task->next++;
+    }
+}
+
+/**
+ * Hand over a reading and move to the next sensor.
+ *
+ * @param task The task
+ * @param ok True if the node answered
+ * @param value The value
+ * @param flags The quality flags
+ */
+void WeatherBusLiteBusScheduler::finish(Task *task, bool ok, float value, uint8_t flags) {
+    report(task, ok, value, flags);
+    task->next++;
+    sendNext(task);
+}
+
+/**
+ * Hand over a reading of the sensor being read.
+ *
+ * @param task The task
+ * @param ok True if the node answered
+ * @param value The value
+ * @param flags The quality flags
+ */
+void WeatherBusLiteBusScheduler::report(Task *task, bool ok, float value, uint8_t flags) {
+    WeatherBusLiteHostReading reading;
+    reading.bus = task->index;
+    reading.type = task->types[task->next];
+    reading.ok = ok;
+    reading.value = value;
+    reading.flags = flags;
+    reading.queried = task->queried;
+    reading.received = weatherBusLiteNanos();
+    _handler(reading);
+}
+
+/**
+ * Arm a bus's timer, replacing any earlier expiry.
+ *
+ * @param task The task
+ * @param ms Time until expiry
+ */
+void WeatherBusLiteBusScheduler::arm(Task *task, unsigned long ms) {
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    timerfd_settime(task->timerFd, 0, &spec, nullptr);
+}
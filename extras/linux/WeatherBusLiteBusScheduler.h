@@ -0,0 +1,94 @@
+#ifndef WEATHERBUSLITE_BUS_SCHEDULER_H
+#define WEATHERBUSLITE_BUS_SCHEDULER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WeatherBusLiteCollector.h"
+#include "WeatherBusLiteDecoder.h"
+#include "WeatherBusLiteHostBus.h"
+
+// events a worker takes from epoll at once
+#define WEATHERBUSLITE_BUS_SCHEDULER_EVENTS 64
+
+// Many buses on a few threads. Each bus is a small state machine that
+// sends a query, waits for the reply or its timeout and moves on to the
+// next sensor, so a bus that is waiting for a node holds no thread.
+//
+// Readiness comes from one edge-triggered epoll set holding every bus
+// descriptor and a timerfd per bus for response timeouts and sweep
+// intervals. An event marks its bus runnable and queues it on the deque
+// of the worker that saw it; workers run their own deque newest first
+// and steal the oldest task from a busy worker when their own is empty.
+// A bus only ever runs on one worker at a time.
+class WeatherBusLiteBusScheduler {
+public:
+    typedef WeatherBusLiteCollector::Handler Handler;
+    typedef std::function<void(int bus, uint64_t start, uint64_t end)> SweepHandler;
+
+    WeatherBusLiteBusScheduler(Handler handler, int workers);
+    ~WeatherBusLiteBusScheduler();
+
+    int addBus(int fd, const char *types, unsigned long sweepInterval = 0);
+    void setSweepHandler(SweepHandler handler);
+    bool start();
+    void stop();
+
+    uint64_t steals() const;
+
+private:
+    enum TaskState { SWEEP_DUE, WAIT_FOR_REPLY, WAIT_FOR_SWEEP };
+
+    struct Task {
+        int index;
+        int fd;
+        int timerFd;
+        std::string types;
+        unsigned long sweepInterval;  // ms between sweep starts
+        TaskState state;
+        size_t next;                  // Index into types of the sensor being read
+        uint64_t sweepStart;
+        uint64_t queried;
+        char frame[64];
+        WeatherBusLiteDecoder decoder;
+        std::atomic<uint32_t> pending;  // Event bits, TASK_QUEUED while queued or running
+
+        Task(int index, int fd, const char *types, unsigned long sweepInterval);
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task *> tasks;
+        std::thread thread;
+    };
+
+    void work(int index);
+    bool take(int index, Task *&task);
+    void notify(int index, Task *task, uint32_t events);
+    void run(Task *task);
+    void step(Task *task, uint32_t events);
+    void sendNext(Task *task);
+    void finish(Task *task, bool ok, float value, uint8_t flags);
+    void report(Task *task, bool ok, float value, uint8_t flags);
+    void arm(Task *task, unsigned long ms);
+    void release();
+
+    Handler _handler;
+    SweepHandler _sweepHandler;
+    std::vector<std::unique_ptr<Task>> _tasks;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    int _epollFd;
+    int _kickFd;  // Wakes idle workers so they can steal
+    std::atomic<bool> _running;
+    std::atomic<int> _idle;
+    std::atomic<uint64_t> _steals;
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteCollector.h"
+#include "WeatherBusLiteSerial.h"
+
+#include <chrono>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * Add one to an eventfd, retrying if a signal interrupts the write. Nothing
+ * else can fail on a valid blocking eventfd short of 2^64 - 2 unread wakeups.
+ *
+ * @param fd The eventfd
+ */
+static void wake(int fd) {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * Constructor of a bus entry.
+ *
+ * @param fd Descriptor of the bus
+ * @param types Sensor types to sweep, e.g. "THP"
+ * @param sweepInterval ms between sweep starts
+ */
+WeatherBusLiteCollector::Bus::Bus(int fd, const char *types, unsigned long sweepInterval)
+    : bus(fd), types(types), sweepInterval(sweepInterval) {}
+
+/**
+ * Constructor.
+ *
+ * @param handler Called on the aggregator thread for every reading
+ * @param queueCapacity Readings the queue holds
+ */
+WeatherBusLiteCollector::WeatherBusLiteCollector(Handler handler, size_t queueCapacity)
+    : _handler(handler), _queue(queueCapacity), _wakeFd(-1), _running(false), _readersDone(false), _sleeping(false), _dropped(0) {}
+
+/**
+ * Destructor. Stops the threads; the bus descriptors stay open.
+ */
+WeatherBusLiteCollector::~WeatherBusLiteCollector() {
+    stop();
+}
+
+/**
+ * Add a bus. Only allowed before start().
+ *
+ * @param fd Non-blocking descriptor of the bus, see weatherBusLiteOpenSerial
+ * @param types Sensor types to sweep, e.g. "THP"
+ * @param sweepInterval ms between sweep starts, 0 to sweep back to back
+ * @return Index of the bus in readings, -1 if already running
+ */
+int WeatherBusLiteCollector::addBus(int fd, const char *types, unsigned long sweepInterval) {
+    if (_running) {
+        return -1;
+    }
+    _buses.emplace_back(new Bus(fd, types, sweepInterval));
+    return _buses.size() - 1;
+}
+
+/**
+ * Start the reader and aggregator threads.
+ *
+ * @return True if started, false if already running or the eventfd failed
+ */
+bool WeatherBusLiteCollector::start() {
+    if (_running) {
+        return false;
+    }
+    _wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (_wakeFd < 0) {
+        return false;
+    }
+    _running = true;
+    _readersDone = false;
+    _aggregator = std::thread(&WeatherBusLiteCollector::aggregate, this);
+    for (size_t i = 0; i < _buses.size(); i++) {
+        _buses[i]->thread = std::thread(&WeatherBusLiteCollector::readBus, this, (int)i);
+    }
+    return true;
+}
+
+/**
+ * Stop all threads.
+ *
+ * Readers finish the query in progress, which may take up to the response
+ * timeout. Readings still queued are handed to the handler before this
+ * returns.
+ */
+void WeatherBusLiteCollector::stop() {
+    if (!_running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_stopMutex);
+        _running = false;
+    }
+    _stopped.notify_all();
+    for (size_t i = 0; i < _buses.size(); i++) {
+        _buses[i]->thread.join();
+    }
+
+    _readersDone = true;
+    wake(_wakeFd);
+    _aggregator.join();
+    close(_wakeFd);
+    _wakeFd = -1;
+}
+
+/**
+ * Readings dropped because the queue was full.
+ *
+ * @return Number of readings
+ */
+uint64_t WeatherBusLiteCollector::dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * Reader thread of one bus.
+ *
+ * @param index Index of the bus
+ */
+void WeatherBusLiteCollector::readBus(int index) {
+    Bus &entry = *_buses[index];
+    while (_running.load(std::memory_order_relaxed)) {
+        uint64_t sweepStart = weatherBusLiteNanos();
+        for (size_t i = 0; i < entry.types.size() && _running.load(std::memory_order_relaxed); i++) {
+            WeatherBusLiteHostReading reading;
+            WeatherBusLiteFields fields;
+            reading.bus = index;
+            reading.type = entry.types[i];
+            reading.queried = weatherBusLiteNanos();
+            reading.ok = entry.bus.queryCustom(reading.type, reading.value, fields);
+            reading.flags = reading.ok ? fields.flags : 0;
+            reading.received = weatherBusLiteNanos();
+            publish(reading);
+        }
+        if (!waitForNextSweep(sweepStart, entry.sweepInterval)) {
+            break;
+        }
+    }
+}
+
+/**
+ * Wait until the next sweep is due.
+ *
+ * @param sweepStart weatherBusLiteNanos() when the last sweep started
+ * @param interval ms between sweep starts
+ * @return True to sweep again, false if stopping
+ */
+bool WeatherBusLiteCollector::waitForNextSweep(uint64_t sweepStart, unsigned long interval) {
+    if (interval == 0) {
+        return _running.load(std::memory_order_relaxed);
+    }
+    uint64_t elapsed = weatherBusLiteNanos() - sweepStart;
+    std::chrono::nanoseconds wait(interval * 1000000ULL > elapsed ? interval * 1000000ULL - elapsed : 0);
+    std::unique_lock<std::mutex> lock(_stopMutex);
+    _stopped.wait_for(lock, wait, [this] { return !_running.load(); });
+    return _running.load();
+}
+
+/**
+ * Queue a reading and wake the aggregator if it is asleep.
+ *
+ * @param reading The reading
+ */
+void WeatherBusLiteCollector::publish(const WeatherBusLiteHostReading &reading) {
+    if (!_queue.push(reading)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Pairs with the fence in aggregate(): either we see the flag or the
+    // aggregator sees our item before it blocks
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed) && _sleeping.exchange(false)) {
+        wake(_wakeFd);
+    }
+}
+
+/**
+ * Aggregator thread.
+ */
+void WeatherBusLiteCollector::aggregate() {
+    WeatherBusLiteHostReading reading;
+    for (;;) {
+        while (_queue.pop(reading)) {
+            _handler(reading);
+        }
+        if (_readersDone.load()) {
+            // Nothing is published after the readers are joined, so one more
+            // pass empties the queue
+            while (_queue.pop(reading)) {
+                _handler(reading);
+            }
+            break;
+        }
+
+        _sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_queue.pop(reading)) {
+            _sleeping.store(false, std::memory_order_relaxed);
+            _handler(reading);
+            continue;
+        }
+
+        uint64_t count;
+        while (read(_wakeFd, &count, sizeof(count)) < 0 && errno == EINTR) {
+        }
+        _sleeping.store(false, std::memory_order_relaxed);
+    }
+}
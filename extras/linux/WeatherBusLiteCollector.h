@@ -0,0 +1,80 @@
+#ifndef WEATHERBUSLITE_COLLECTOR_H
+#define WEATHERBUSLITE_COLLECTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WeatherBusLiteHostBus.h"
+#include "WeatherBusLiteMpscQueue.h"
+
+// default number of readings the queue holds before readers drop them
+#define WEATHERBUSLITE_COLLECTOR_QUEUE 4096
+
+// One query result, as handed to the aggregator.
+struct WeatherBusLiteHostReading {
+    int bus;            // Index returned by addBus
+    char type;          // Sensor type
+    bool ok;            // False if the node did not answer
+    float value;
+    uint8_t flags;      // WEATHERBUSLITE_FLAG_* bits
+    uint64_t queried;   // weatherBusLiteNanos() when the query was sent
+    uint64_t received;  // weatherBusLiteNanos() when the reply was parsed
+};
+
+// Multi-bus collector for a Linux host. Each bus gets a reader thread
+// that sweeps its sensors with WeatherBusLiteHostBus and pushes every
+// result into a lock-free MPSC queue; a single aggregator thread pops
+// them and calls the handler, so the handler never needs locking.
+//
+// The aggregator sleeps on an eventfd when the queue is empty. Readers
+// only write to it when the aggregator announced that it is going to
+// sleep, so a busy pipeline costs no system calls beyond the bus I/O.
+class WeatherBusLiteCollector {
+public:
+    typedef std::function<void(const WeatherBusLiteHostReading &)> Handler;
+
+    explicit WeatherBusLiteCollector(Handler handler, size_t queueCapacity = WEATHERBUSLITE_COLLECTOR_QUEUE);
+    ~WeatherBusLiteCollector();
+
+    int addBus(int fd, const char *types, unsigned long sweepInterval = 0);
+    bool start();
+    void stop();
+
+    uint64_t dropped() const;
+
+private:
+    struct Bus {
+        WeatherBusLiteHostBus bus;
+        std::string types;
+        unsigned long sweepInterval;  // ms between sweep starts, 0 to sweep back to back
+        std::thread thread;
+
+        Bus(int fd, const char *types, unsigned long sweepInterval);
+    };
+
+    void readBus(int index);
+    void publish(const WeatherBusLiteHostReading &reading);
+    void aggregate();
+    bool waitForNextSweep(uint64_t sweepStart, unsigned long interval);
+
+    Handler _handler;
+    WeatherBusLiteMpscQueue<WeatherBusLiteHostReading> _queue;
+    std::vector<std::unique_ptr<Bus>> _buses;
+    std::thread _aggregator;
+    int _wakeFd;
+    std::atomic<bool> _running;
+    std::atomic<bool> _readersDone;  // Set by stop() once the readers are joined
+    std::atomic<bool> _sleeping;  // Aggregator is about to block on _wakeFd
+    std::atomic<uint64_t> _dropped;
+    std::mutex _stopMutex;
+    std::condition_variable _stopped;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteEventLoop.h"
+#include "WeatherBusLiteSerial.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * Constructor of a readable awaiter.
+ *
+ * @param loop The event loop
+ * @param fd The descriptor
+ * @param deadline weatherBusLiteNanos() time to give up at
+ */
+WeatherBusLiteEventLoop::ReadableAwaiter::ReadableAwaiter(WeatherBusLiteEventLoop &loop, int fd, uint64_t deadline)
+    : _loop(loop), _fd(fd), _deadline(deadline), _sequence(0), _ready(false) {}
+
+/**
+ * Register the waiting coroutine with the loop.
+ *
+ * @param handle The coroutine
+ * @return True to suspend, false to resume at once because the
+ *         descriptor cannot be watched
+ */
+bool WeatherBusLiteEventLoop::ReadableAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    _handle = handle;
+    return _loop.watch(this);
+}
+
+/**
+ * Constructor of a sleep awaiter.
+ *
+ * @param loop The event loop
+ * @param deadline weatherBusLiteNanos() time to resume at
+ */
+WeatherBusLiteEventLoop::SleepAwaiter::SleepAwaiter(WeatherBusLiteEventLoop &loop, uint64_t deadline)
+    : _loop(loop), _deadline(deadline) {}
+
+/**
+ * Queue the sleeping coroutine's wakeup.
+ *
+ * @param handle The coroutine
+ */
+void WeatherBusLiteEventLoop::SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    _loop._sleepTimers.push(SleepTimer{_deadline, handle});
+}
+
+/**
+ * Constructor.
+ */
+WeatherBusLiteEventLoop::WeatherBusLiteEventLoop() : _epollFd(epoll_create1(EPOLL_CLOEXEC)), _sequence(0) {}
+
+/**
+ * Destructor. Destroys spawned coroutines that have not finished.
+ */
+WeatherBusLiteEventLoop::~WeatherBusLiteEventLoop() {
+    for (size_t i = 0; i < _spawned.size(); i++) {
+        _spawned[i].destroy();
+    }
+    close(_epollFd);
+}
+
+/**
+ * Start a coroutine on the next run() iteration. The loop owns it from
+ * now on.
+ *
+ * @param task The coroutine
+ */
+void WeatherBusLiteEventLoop::spawn(WeatherBusLiteTask<void> task) {
+    std::coroutine_handle<> handle = task.release();
+    _spawned.push_back(handle);
+    _ready.push_back(handle);
+}
+
+/**
+ * Wait for a descriptor to become readable.
+ *
+ * @param fd Non-blocking descriptor
+ * @param deadline weatherBusLiteNanos() time to give up at
+ * @return Awaiter yielding true if readable, false at the deadline
+ */
+WeatherBusLiteEventLoop::ReadableAwaiter WeatherBusLiteEventLoop::readable(int fd, uint64_t deadline) {
+    return ReadableAwaiter(*this, fd, deadline);
+}
+
+/**
+ * Wait for a while.
+ *
+ * @param ms Time to wait
+ * @return Awaiter
+ */
+WeatherBusLiteEventLoop::SleepAwaiter WeatherBusLiteEventLoop::sleep(unsigned long ms) {
+    return SleepAwaiter(*this, weatherBusLiteNanos() + ms * 1000000ULL);
+}
+
+/**
+ * Arm epoll and the deadline for a waiter.
+ *
+ * @param waiter The waiter
+ * @return True if armed, false if epoll refused the descriptor
+ */
+bool WeatherBusLiteEventLoop::watch(ReadableAwaiter *waiter) {
+    int fd = waiter->_fd;
+    if (fd < 0) {
+        return false;
+    }
+    if ((size_t)fd >= _waiters.size()) {
+        _waiters.resize(fd + 1, nullptr);
+        _registered.resize(fd + 1, false);
+    }
+
+    // One-shot, so a reply that arrives after a timeout wakes nobody
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (epoll_ctl(_epollFd, _registered[fd] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) {
+        return false;
+    }
+    _registered[fd] = true;
+
+    waiter->_sequence = ++_sequence;
+    _waiters[fd] = waiter;
+    _readTimers.push(ReadTimer{waiter->_deadline, waiter->_sequence, fd});
+    return true;
+}
+
+/**
+ * Resume coroutines whose deadline has passed.
+ *
+ * @param now weatherBusLiteNanos() time
+ */
+void WeatherBusLiteEventLoop::expire(uint64_t now) {
+    while (!_readTimers.empty() && _readTimers.top().deadline <= now) {
+        ReadTimer timer = _readTimers.top();
+        _readTimers.pop();
+        ReadableAwaiter *waiter = _waiters[timer.fd];
+        if (waiter != nullptr && waiter->_sequence == timer.sequence) {
+            _waiters[timer.fd] = nullptr;
+            waiter->_ready = false;
+            _ready.push_back(waiter->_handle);
+        }
+    }
+    while (!_sleepTimers.empty() && _sleepTimers.top().deadline <= now) {
+        _ready.push_back(_sleepTimers.top().handle);
+        _sleepTimers.pop();
+    }
+}
+
+/**
+ * Time until the earliest deadline.
+ *
+ * @param now weatherBusLiteNanos() time
+ * @return Timeout for epoll_wait in ms, -1 if there is no deadline
+ */
+int WeatherBusLiteEventLoop::timeout(uint64_t now) {
+    // Timers of waiters that were resumed by data are dropped lazily
+    while (!_readTimers.empty()) {
+        const ReadTimer &timer = _readTimers.top();
+        ReadableAwaiter *waiter = _waiters[timer.fd];
+        if (waiter != nullptr && waiter->_sequence == timer.sequence) {
+            break;
+        }
+        _readTimers.pop();
+    }
+
+    uint64_t deadline = UINT64_MAX;
+    if (!_readTimers.empty()) {
+        deadline = _readTimers.top().deadline;
+    }
+    if (!_sleepTimers.empty() && _sleepTimers.top().deadline < deadline) {
+        deadline = _sleepTimers.top().deadline;
+    }
+    if (deadline == UINT64_MAX) {
+        return -1;
+    }
+    return deadline > now ? (int)((deadline - now + 999999ULL) / 1000000ULL) : 0;
+}
+
+/**
+ * Run until every spawned coroutine has finished.
+ */
+void WeatherBusLiteEventLoop::run() {
+    struct epoll_event events[WEATHERBUSLITE_EVENT_LOOP_EVENTS];
+    while (!_spawned.empty()) {
+        while (!_ready.empty()) {
+            std::coroutine_handle<> handle = _ready.front();
+            _ready.pop_front();
+            handle.resume();
+        }
+
+        for (size_t i = 0; i < _spawned.size();) {
+            if (_spawned[i].done()) {
+                _spawned[i].destroy();
+                _spawned[i] = _spawned.back();
+                _spawned.pop_back();
+            } else {
+                i++;
+            }
+        }
+        if (_spawned.empty()) {
+            break;
+        }
+
+        int count = epoll_wait(_epollFd, events, WEATHERBUSLITE_EVENT_LOOP_EVENTS, timeout(weatherBusLiteNanos()));
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            ReadableAwaiter *waiter = _waiters[fd];
+            if (waiter != nullptr) {
+                _waiters[fd] = nullptr;
+                waiter->_ready = true;
+                _ready.push_back(waiter->_handle);
+            }
+        }
+        expire(weatherBusLiteNanos());
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef WEATHERBUSLITE_EVENT_LOOP_H
+#define WEATHERBUSLITE_EVENT_LOOP_H
+
+#include <coroutine>
+#include <deque>
+#include <queue>
+#include <stdint.h>
+#include <vector>
+
+#include "WeatherBusLiteTask.h"
+
+// events taken from epoll at once
+#define WEATHERBUSLITE_EVENT_LOOP_EVENTS 64
+
+// Single-threaded epoll loop that resumes coroutines when a descriptor
+// becomes readable or a deadline passes. Each descriptor has at most one
+// waiter, which is all a bus needs: only one query is ever outstanding.
+// Waiting allocates nothing once the loop's tables have grown to the
+// number of buses.
+class WeatherBusLiteEventLoop {
+public:
+    // Suspends until a descriptor is readable or a deadline passes
+    class ReadableAwaiter {
+    public:
+        ReadableAwaiter(WeatherBusLiteEventLoop &loop, int fd, uint64_t deadline);
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return _ready; }
+
+    private:
+        friend class WeatherBusLiteEventLoop;
+
+        WeatherBusLiteEventLoop &_loop;
+        int _fd;
+        uint64_t _deadline;
+        uint64_t _sequence;
+        std::coroutine_handle<> _handle;
+        bool _ready;  // True if readable, false if the deadline passed
+    };
+
+    // Suspends for a while
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(WeatherBusLiteEventLoop &loop, uint64_t deadline);
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+    private:
+        WeatherBusLiteEventLoop &_loop;
+        uint64_t _deadline;
+    };
+
+    WeatherBusLiteEventLoop();
+    ~WeatherBusLiteEventLoop();
+
+    void spawn(WeatherBusLiteTask<void> task);
+    void run();
+
+    ReadableAwaiter readable(int fd, uint64_t deadline);
+    SleepAwaiter sleep(unsigned long ms);
+
+private:
+    struct ReadTimer {
+        uint64_t deadline;
+        uint64_t sequence;  // Of the waiter, which may have been resumed already
+        int fd;
+
+        bool operator>(const ReadTimer &other) const { return deadline > other.deadline; }
+    };
+
+    struct SleepTimer {
+        uint64_t deadline;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const SleepTimer &other) const { return deadline > other.deadline; }
+    };
+
+    template <typename T>
+    using TimerQueue = std::priority_queue<T, std::vector<T>, std::greater<T>>;
+
+    bool watch(ReadableAwaiter *waiter);
+    void expire(uint64_t now);
+    int timeout(uint64_t now);
+
+    int _epollFd;
+    uint64_t _sequence;
+    std::vector<ReadableAwaiter *> _waiters;  // By descriptor
+    std::vector<bool> _registered;            // Descriptor is in the epoll set
+    TimerQueue<ReadTimer> _readTimers;
+    TimerQueue<SleepTimer> _sleepTimers;
+    std::deque<std::coroutine_handle<>> _ready;
+    std::vector<std::coroutine_handle<>> _spawned;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteFramePool.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// Free lists of one thread, and the chunks backing them
+struct ThreadPool {
+    FreeBlock *free[WEATHERBUSLITE_FRAME_CLASSES] = {};
+    std::vector<void *> chunks;
+
+    ~ThreadPool() {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            ::free(chunks[i]);
+        }
+    }
+};
+
+thread_local ThreadPool threadPool;
+std::atomic<uint64_t> heapCount(0);
+
+}
+
+/**
+ * Allocate a frame.
+ *
+ * @param size Size of the frame
+ * @return The block, never null
+ */
+void *WeatherBusLiteFramePool::allocate(size_t size) {
+    size_t sizeClass = (size + WEATHERBUSLITE_FRAME_GRANULE - 1) / WEATHERBUSLITE_FRAME_GRANULE - 1;
+    if (sizeClass >= WEATHERBUSLITE_FRAME_CLASSES) {
+        heapCount.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    FreeBlock *&head = threadPool.free[sizeClass];
+    if (head == nullptr) {
+        size_t blockSize = (sizeClass + 1) * WEATHERBUSLITE_FRAME_GRANULE;
+        char *chunk = (char *)malloc(blockSize * WEATHERBUSLITE_FRAME_CHUNK);
+        if (chunk == nullptr) {
+            throw std::bad_alloc();
+        }
+        heapCount.fetch_add(1, std::memory_order_relaxed);
+        threadPool.chunks.push_back(chunk);
+        for (size_t i = 0; i < WEATHERBUSLITE_FRAME_CHUNK; i++) {
+            FreeBlock *block = (FreeBlock *)(chunk + i * blockSize);
+            block->next = head;
+            head = block;
+        }
+    }
+    FreeBlock *block = head;
+    head = block->next;
+    return block;
+}
+
+/**
+ * Return a frame to the pool of the calling thread, which must be the
+ * thread that allocated it.
+ *
+ * @param block The block
+ * @param size Size passed to allocate()
+ */
+void WeatherBusLiteFramePool::release(void *block, size_t size) {
+    size_t sizeClass = (size + WEATHERBUSLITE_FRAME_GRANULE - 1) / WEATHERBUSLITE_FRAME_GRANULE - 1;
+    if (sizeClass >= WEATHERBUSLITE_FRAME_CLASSES) {
+        ::operator delete(block);
+        return;
+    }
+    FreeBlock *freed = (FreeBlock *)block;
+    freed->next = threadPool.free[sizeClass];
+    threadPool.free[sizeClass] = freed;
+}
+
+/**
+ * Heap allocations made by the pool: one per chunk, plus one per frame
+ * too large for a size class. Stays flat once the pool has warmed up.
+ *
+ * @return Number of allocations
+ */
+uint64_t WeatherBusLiteFramePool::heapAllocations() {
+    return heapCount.load(std::memory_order_relaxed);
+}
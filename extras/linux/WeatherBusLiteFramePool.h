@@ -0,0 +1,29 @@
+#ifndef WEATHERBUSLITE_FRAME_POOL_H
+#define WEATHERBUSLITE_FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// size classes of the pool, coroutine frames larger than the last one
+// go to the heap
+#define WEATHERBUSLITE_FRAME_GRANULE 64
+#define WEATHERBUSLITE_FRAME_CLASSES 32
+
+// blocks carved from one heap allocation when a class runs dry
+#define WEATHERBUSLITE_FRAME_CHUNK 32
+
+// Allocator for coroutine frames. Frames of the same coroutine always
+// have the same size, so per-thread free lists by size class make every
+// allocation after warm-up a pointer pop, with no locking and no malloc.
+// Blocks are kept for reuse and only returned when the thread exits, so
+// a frame must be freed on the thread that created it, as it is when
+// coroutines stay on one WeatherBusLiteEventLoop.
+class WeatherBusLiteFramePool {
+public:
+    static void *allocate(size_t size);
+    static void release(void *block, size_t size);
+
+    static uint64_t heapAllocations();
+};
+
+#endif
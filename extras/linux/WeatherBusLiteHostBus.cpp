@@ -0,0 +1,164 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteHostBus.h"
+#include "WeatherBusLiteSerial.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * Constructor.
+ *
+ * @param fd Non-blocking descriptor of the bus, see weatherBusLiteOpenSerial
+ */
+WeatherBusLiteHostBus::WeatherBusLiteHostBus(int fd) : _fd(fd), _head(0), _tail(0) {}
+
+/**
+ * Send a query.
+ *
+ * Bytes still buffered from an earlier exchange are dropped, here and in
+ * the kernel, like a late reply the Arduino master never reads. Gives up if
+ * the port does not take the query within the response timeout.
+ *
+ * @param query The query, e.g. "?T"
+ * @return True if the whole query was written, false otherwise
+ */
+bool WeatherBusLiteHostBus::sendQuery(const char *query) {
+    _head = _tail = 0;
+    tcflush(_fd, TCIFLUSH);  // Fails harmlessly if the bus is not a tty
+
+    char line[32];
+    size_t length = strlen(query);
+    if (length + 2 > sizeof(line)) {
+        return false;
+    }
+    memcpy(line, query, length);
+    line[length++] = '\r';
+    line[length++] = '\n';
+
+    uint64_t deadline = weatherBusLiteNanos() + WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT * 1000000ULL;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(_fd, line + written, length - written);
+        if (n > 0) {
+            written += n;
+        } else if (n < 0 && errno == EAGAIN) {
+            uint64_t now = weatherBusLiteNanos();
+            if (now >= deadline) {
+                return false;
+            }
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            poll(&pfd, 1, (int)((deadline - now + 999999ULL) / 1000000ULL));
+        } else if (n < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Wait for and read the next chunk of bytes.
+ *
+ * An interrupted wait or a spurious wakeup leaves the buffer empty but
+ * still counts as success, so the caller checks its deadline and retries.
+ *
+ * @param timeout Maximum wait in ms
+ * @return False on timeout, end of file or a read error, true otherwise
+ */
+bool WeatherBusLiteHostBus::fill(int timeout) {
+    _head = _tail = 0;
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeout);
+    if (ready == 0) {
+        return false;
+    }
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    ssize_t n = read(_fd, _buffer, sizeof(_buffer));
+    if (n < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    _tail = n;
+    return n > 0;
+}
+
+/**
+ * Read a response frame.
+ *
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame
+ * @param size Size of the buffer
+ * @param timeout Maximum wait in ms
+ * @return Length of the frame, -1 on timeout
+ */
+int WeatherBusLiteHostBus::readFrame(char expectedType, char *frame, size_t size, int timeout) {
+    WeatherBusLiteDecoder decoder(frame, size);
+    decoder.begin(expectedType);
+
+    uint64_t deadline = weatherBusLiteNanos() + (uint64_t)timeout * 1000000ULL;
+    for (;;) {
+        while (_head < _tail) {
+            if (decoder.feedPlain(_buffer[_head++])) {
+                return decoder.length();
+            }
+        }
+        uint64_t now = weatherBusLiteNanos();
+        if (now >= deadline) {
+            return -1;
+        }
+        int remaining = (int)((deadline - now + 999999ULL) / 1000000ULL);
+        if (!fill(remaining)) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Query a sensor.
+ *
+ * @param queryType The type of the sensor
+ * @param value The value
+ * @param fields The optional fields of the reading
+ * @return True if successful, false otherwise
+ */
+bool WeatherBusLiteHostBus::queryCustom(char queryType, float &value, WeatherBusLiteFields &fields) {
+    char query[3] = {'?', queryType, '\0'};
+    if (!sendQuery(query)) {
+        return false;
+    }
+    char frame[64];
+    if (readFrame(queryType, frame, sizeof(frame)) < 0) {
+        return false;
+    }
+    return weatherBusLiteParseReading(frame, value, fields);
+}
+
+/**
+ * Descriptor of the bus.
+ *
+ * @return The file descriptor
+ */
+int WeatherBusLiteHostBus::fd() const {
+    return _fd;
+}
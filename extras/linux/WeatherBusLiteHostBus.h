@@ -0,0 +1,38 @@
+#ifndef WEATHERBUSLITE_HOST_BUS_H
+#define WEATHERBUSLITE_HOST_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WeatherBusLiteDecoder.h"
+
+// same timing as the Arduino master (WEATHERBUSLITE_RESPONSE_TIMEOUT)
+#define WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT 1000
+
+// bytes read from the descriptor at once
+#define WEATHERBUSLITE_HOST_READ_SIZE 256
+
+// Blocking master for one bus on the Linux host build. Speaks the same
+// plain ?T / T:value exchange as WeatherBusLite::sendQuery and
+// parseResponse, sharing its frame decoder, but reads the descriptor in
+// chunks instead of a byte at a time.
+class WeatherBusLiteHostBus {
+public:
+    explicit WeatherBusLiteHostBus(int fd);
+
+    bool sendQuery(const char *query);
+    int readFrame(char expectedType, char *frame, size_t size, int timeout = WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT);
+    bool queryCustom(char queryType, float &value, WeatherBusLiteFields &fields);
+
+    int fd() const;
+
+private:
+    bool fill(int timeout);
+
+    int _fd;
+    char _buffer[WEATHERBUSLITE_HOST_READ_SIZE];
+    size_t _head;  // First unread byte
+    size_t _tail;  // End of the read bytes
+};
+
+#endif
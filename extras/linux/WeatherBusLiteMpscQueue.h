@@ -0,0 +1,102 @@
+#ifndef WEATHERBUSLITE_MPSC_QUEUE_H
+#define WEATHERBUSLITE_MPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// cache line size, keeps producer and consumer indices apart
+#define WEATHERBUSLITE_CACHE_LINE 64
+
+// Bounded lock-free queue for many producers and one consumer.
+//
+// Each cell carries a sequence number. A producer claims a slot by
+// advancing the tail with a compare-and-swap once the cell's sequence
+// says it is free, writes the item and publishes it by bumping the
+// sequence. The single consumer owns the head outright, so popping needs
+// no read-modify-write at all. Capacity is rounded up to a power of two.
+template <typename T>
+class WeatherBusLiteMpscQueue {
+public:
+    explicit WeatherBusLiteMpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _cells = new Cell[size];
+        for (size_t i = 0; i < size; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        _tail.store(0, std::memory_order_relaxed);
+        _head = 0;
+    }
+
+    ~WeatherBusLiteMpscQueue() {
+        delete[] _cells;
+    }
+
+    WeatherBusLiteMpscQueue(const WeatherBusLiteMpscQueue &) = delete;
+    WeatherBusLiteMpscQueue &operator=(const WeatherBusLiteMpscQueue &) = delete;
+
+    /**
+     * Add an item. Safe from any number of threads.
+     *
+     * @param item The item
+     * @return True if queued, false if the queue is full
+     */
+    bool push(const T &item) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[tail & _mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)tail;
+            if (difference == 0) {
+                if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;  // The consumer has not freed this cell yet
+            } else {
+                tail = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Remove the oldest item. Only the consumer thread may call this.
+     *
+     * @param item The item
+     * @return True if an item was removed, false if the queue is empty
+     */
+    bool pop(T &item) {
+        Cell &cell = _cells[_head & _mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != _head + 1) {
+            return false;  // Empty, or the producer is still writing
+        }
+        item = cell.item;
+        cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Cell *_cells;
+    size_t _mask;
+    alignas(WEATHERBUSLITE_CACHE_LINE) std::atomic<size_t> _tail;
+    alignas(WEATHERBUSLITE_CACHE_LINE) size_t _head;
+};
+
+#endif
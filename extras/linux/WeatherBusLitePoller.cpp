@@ -0,0 +1,167 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLitePoller.h"
+#include "WeatherBusLiteSerial.h"
+
+/**
+ * Constructor of a bus entry.
+ *
+ * @param transport Index of the bus in the transport
+ * @param types Sensor types to sweep
+ * @param sweepInterval ms between sweep starts
+ */
+WeatherBusLitePoller::Bus::Bus(int transport, const char *types, unsigned long sweepInterval)
+    : transport(transport), types(types), sweepInterval(sweepInterval), state(SWEEP_DUE), next(0), deadline(0),
+      sweepStart(0), queried(0), decoder(frame, sizeof(frame)) {}
+
+/**
+ * Constructor.
+ *
+ * @param transport Moves the bytes; used only from the polling thread
+ * @param handler Called from poll() for every reading
+ */
+WeatherBusLitePoller::WeatherBusLitePoller(WeatherBusLiteTransport &transport, Handler handler)
+    : _transport(transport), _handler(handler) {}
+
+/**
+ * Add a bus.
+ *
+ * @param fd Non-blocking descriptor of the bus, see weatherBusLiteOpenSerial
+ * @param types Sensor types to sweep, e.g. "THP"
+ * @param sweepInterval ms between sweep starts, 0 to sweep back to back
+ * @return Index of the bus in readings, -1 on error
+ */
+int WeatherBusLitePoller::addBus(int fd, const char *types, unsigned long sweepInterval) {
+    if (types[0] == '\0') {
+        return -1;
+    }
+    int transport = _transport.add(fd);
+    if (transport < 0) {
+        return -1;
+    }
+    if ((size_t)transport >= _byTransport.size()) {
+        _byTransport.resize(transport + 1, -1);
+    }
+    _byTransport[transport] = _buses.size();
+    _buses.emplace_back(new Bus(transport, types, sweepInterval));
+    return _buses.size() - 1;
+}
+
+/**
+ * Start due sweeps, time out late replies, then wait for bytes and
+ * decode them.
+ *
+ * @param timeout Maximum wait in ms, -1 to wait until something is due
+ * @return True on success, false if the transport failed
+ */
+bool WeatherBusLitePoller::poll(int timeout) {
+    uint64_t now = weatherBusLiteNanos();
+    uint64_t earliest = UINT64_MAX;
+    for (size_t i = 0; i < _buses.size(); i++) {
+        Bus &bus = *_buses[i];
+        if (bus.state == SWEEP_DUE || (bus.state == WAIT_FOR_SWEEP && now >= bus.deadline)) {
+            bus.sweepStart = now;
+            bus.next = 0;
+            sendNext(i, now);
+        } else if (bus.state == WAIT_FOR_REPLY && now >= bus.deadline) {
+            finish(i, false, 0, 0, now);
+        }
+        if (bus.deadline < earliest) {
+            earliest = bus.deadline;
+        }
+    }
+
+    int wait = earliest > now ? (int)((earliest - now + 999999ULL) / 1000000ULL) : 0;
+    if (timeout >= 0 && timeout < wait) {
+        wait = timeout;
+    }
+    int count = _transport.wait(_events, WEATHERBUSLITE_POLLER_EVENTS, wait);
+    if (count < 0) {
+        return false;
+    }
+
+    now = weatherBusLiteNanos();
+    for (int i = 0; i < count; i++) {
+        int index = _byTransport[_events[i].bus];
+        Bus &bus = *_buses[index];
+        for (size_t j = 0; j < _events[i].length && bus.state == WAIT_FOR_REPLY; j++) {
+            if (bus.decoder.feedPlain(_events[i].data[j])) {
+                float value;
+                WeatherBusLiteFields fields;
+                bool ok = weatherBusLiteParseReading(bus.frame, value, fields);
+                finish(index, ok, value, ok ? fields.flags : 0, now);
+                break;  // The rest belongs to no query
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Query the next sensor of the sweep, or end the sweep.
+ *
+ * @param index Index of the bus
+ * @param now weatherBusLiteNanos() time
+ */
+void WeatherBusLitePoller::sendNext(int index, uint64_t now) {
+    Bus &bus = *_buses[index];
+    if (bus.next >= bus.types.size()) {
+        uint64_t elapsed = (now - bus.sweepStart) / 1000000ULL;
+        if (bus.sweepInterval > elapsed) {
+            bus.state = WAIT_FOR_SWEEP;
+            bus.deadline = bus.sweepStart + bus.sweepInterval * 1000000ULL;
+            return;
+        }
+        bus.sweepStart = now;
+        bus.next = 0;
+    }
+
+    char query[4] = {'?', bus.types[bus.next], '\r', '\n'};
+    bus.decoder.begin(query[1]);
+    bus.queried = now;
+    bus.state = WAIT_FOR_REPLY;
+    bus.deadline = now + WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT * 1000000ULL;
+    _transport.write(bus.transport, query, sizeof(query));  // If this fails the timeout moves on
+}
+
+/**
+ * Hand over a reading and move to the next sensor.
+ *
+ * @param index Index of the bus
+ * @param ok True if the node answered
+ * @param value The value
+ * @param flags The quality flags
+ * @param now weatherBusLiteNanos() time
+ */
+void WeatherBusLitePoller::finish(int index, bool ok, float value, uint8_t flags, uint64_t now) {
+    Bus &bus = *_buses[index];
+    WeatherBusLiteHostReading reading;
+    reading.bus = index;
+    reading.type = bus.types[bus.next];
+    reading.ok = ok;
+    reading.value = value;
+    reading.flags = flags;
+    reading.queried = bus.queried;
+    reading.received = now;
+    _handler(reading);
+
+    bus.next++;
+    sendNext(index, now);
+}
@@ -0,0 +1,57 @@
+#ifndef WEATHERBUSLITE_POLLER_H
+#define WEATHERBUSLITE_POLLER_H
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "WeatherBusLiteCollector.h"
+#include "WeatherBusLiteDecoder.h"
+#include "WeatherBusLiteTransport.h"
+
+// transport events handled per poll()
+#define WEATHERBUSLITE_POLLER_EVENTS 256
+
+// Sweeps many buses from one thread over a WeatherBusLiteTransport. The
+// per-bus state machine is the one WeatherBusLiteBusScheduler runs; here it
+// is driven by the transport, so the system calls per reading are the
+// transport's alone.
+class WeatherBusLitePoller {
+public:
+    typedef WeatherBusLiteCollector::Handler Handler;
+
+    WeatherBusLitePoller(WeatherBusLiteTransport &transport, Handler handler);
+
+    int addBus(int fd, const char *types, unsigned long sweepInterval = 0);
+    bool poll(int timeout);
+
+private:
+    enum BusState { SWEEP_DUE, WAIT_FOR_REPLY, WAIT_FOR_SWEEP };
+
+    struct Bus {
+        int transport;     // Index in the transport
+        std::string types;
+        unsigned long sweepInterval;
+        BusState state;
+        size_t next;       // Index into types of the sensor being read
+        uint64_t deadline; // Reply timeout or next sweep, weatherBusLiteNanos()
+        uint64_t sweepStart;
+        uint64_t queried;
+        char frame[64];
+        WeatherBusLiteDecoder decoder;
+
+        Bus(int transport, const char *types, unsigned long sweepInterval);
+    };
+
+    void sendNext(int index, uint64_t now);
+    void finish(int index, bool ok, float value, uint8_t flags, uint64_t now);
+
+    WeatherBusLiteTransport &_transport;
+    Handler _handler;
+    std::vector<std::unique_ptr<Bus>> _buses;  // Stable, the decoders point into them
+    std::vector<int> _byTransport;  // Bus index by transport index
+    WeatherBusLiteTransportEvent _events[WEATHERBUSLITE_POLLER_EVENTS];
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Termios speed constant for a baud rate.
+ *
+ * @param baudRate The baud rate
+ * @return The speed, B0 if the rate is not supported
+ */
+static speed_t speedFor(uint32_t baudRate) {
+    switch (baudRate) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+    }
+    return B0;
+}
+
+/**
+ * Open a serial device.
+ *
+ * @param device Path of the device
+ * @param baudRate The baud rate
+ * @return Non-blocking file descriptor, -1 on error
+ */
+int weatherBusLiteOpenSerial(const char *device, uint32_t baudRate) {
+    int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!weatherBusLiteConfigureSerial(fd, baudRate)) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Configure a terminal for the bus.
+ *
+ * 8N1, no echo, no line editing and no flow control, so frames pass
+ * through byte for byte. VMIN is 1 so that an empty terminal reports
+ * EAGAIN like any other non-blocking descriptor instead of returning 0,
+ * which io_uring and epoll users would take for end of file.
+ *
+ * @param fd The terminal
+ * @param baudRate The baud rate
+ * @return True on success, false with errno set otherwise
+ */
+bool weatherBusLiteConfigureSerial(int fd, uint32_t baudRate) {
+    speed_t speed = speedFor(baudRate);
+    if (speed == B0) {
+        errno = EINVAL;
+        return false;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) < 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+        return false;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+/**
+ * Monotonic time.
+ *
+ * @return Nanoseconds since an arbitrary start
+ */
+uint64_t weatherBusLiteNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Wall-clock time, for timestamps that outlive the process.
+ *
+ * @return Milliseconds since the Unix epoch
+ */
+uint64_t weatherBusLiteEpochMillis() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000ULL + now.tv_nsec / 1000000L;
+}
@@ -0,0 +1,21 @@
+#ifndef WEATHERBUSLITE_SERIAL_H
+#define WEATHERBUSLITE_SERIAL_H
+
+#include <stdint.h>
+
+// Opens a serial device (e.g. /dev/ttyUSB0 on an RS485 adapter that
+// switches direction itself) in raw mode for the Linux host build.
+// Returns a non-blocking file descriptor, or -1 with errno set.
+int weatherBusLiteOpenSerial(const char *device, uint32_t baudRate);
+
+// Puts an already open terminal, such as one end of a pseudo-terminal
+// pair, into raw non-blocking mode.
+bool weatherBusLiteConfigureSerial(int fd, uint32_t baudRate);
+
+// Monotonic time for the host build, in nanoseconds.
+uint64_t weatherBusLiteNanos();
+
+// Wall-clock time for the host build, in milliseconds since the Unix epoch.
+uint64_t weatherBusLiteEpochMillis();
+
+#endif
@@ -0,0 +1,507 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteStore.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// records that fit in a segment after its header
+#define SEGMENT_RECORDS ((WEATHERBUSLITE_STORE_SEGMENT_SIZE - WEATHERBUSLITE_STORE_HEADER_SIZE) / sizeof(uint64_t))
+
+// format version in the segment header
+#define SEGMENT_VERSION 1
+
+// delta of an escape record, whose reading's absolute time is in the next slot
+#define ESCAPE_DELTA (WEATHERBUSLITE_STORE_MAX_DELTA + 1)
+
+// Start of every segment file, padded to WEATHERBUSLITE_STORE_HEADER_SIZE.
+struct SegmentHeader {
+    char magic[4];    // "WBLS"
+    uint16_t version;
+    char type;
+    uint8_t reserved;
+    int32_t station;
+    uint32_t number;
+    uint64_t base;    // Time of the first reading, ms since the Unix epoch
+};
+
+/**
+ * Pack a reading into a record. The delta is stored plus one, so a
+ * record is never zero and zero marks the end of the column.
+ *
+ * @param delta ms since the previous reading, at most WEATHERBUSLITE_STORE_MAX_DELTA,
+ *              or ESCAPE_DELTA if the absolute time follows
+ * @param value The value
+ * @param flags The quality flags
+ * @return The record
+ */
+static uint64_t packRecord(uint32_t delta, float value, uint8_t flags) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return ((uint64_t)bits << 32) | ((uint64_t)(delta + 1) << 8) | flags;
+}
+
+/**
+ * Unpack a record and advance the running time.
+ *
+ * @param records The records of a segment
+ * @param index The record to unpack
+ * @param count Number of records that may be read
+ * @param time Time of the previous reading, becomes the time of this one
+ * @param sample Receives the reading
+ * @return Slots the record takes, 2 for an escape record and its time, 0
+ *         at the end of the column: a zero record or an escape whose time
+ *         is missing
+ */
+static size_t unpackRecord(const uint64_t *records, size_t index, size_t count, uint64_t &time,
+                           WeatherBusLiteStoredReading &sample) {
+    uint64_t record = records[index];
+    if (record == 0) {
+        return 0;
+    }
+    uint32_t delta = ((record >> 8) & 0xffffff) - 1;
+    size_t used = 1;
+    if (delta == ESCAPE_DELTA) {
+        if (index + 1 >= count || records[index + 1] == 0) {
+            return 0;
+        }
+        time = records[index + 1];
+        used = 2;
+    } else {
+        time += delta;
+    }
+    uint32_t bits = record >> 32;
+    sample.time = time;
+    memcpy(&sample.value, &bits, sizeof(bits));
+    sample.flags = record & 0xff;
+    return used;
+}
+
+/**
+ * Read and check the header of a segment file.
+ *
+ * @param path The file
+ * @param header Receives the header
+ * @return True if the file is a segment
+ */
+static bool readHeader(const char *path, SegmentHeader &header) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t length = pread(fd, &header, sizeof(header), 0);
+    close(fd);
+    return length == sizeof(header) && memcmp(header.magic, "WBLS", 4) == 0 && header.version == SEGMENT_VERSION;
+}
+
+/**
+ * Map a segment file.
+ *
+ * @param path The file
+ * @param writable True to append to it
+ * @return The mapping, nullptr on error
+ */
+static char *mapSegment(const char *path, bool writable) {
+    int fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (st.st_size < (off_t)WEATHERBUSLITE_STORE_SEGMENT_SIZE &&
+                               (!writable || ftruncate(fd, WEATHERBUSLITE_STORE_SEGMENT_SIZE) < 0))) {
+        close(fd);  // A short segment can be mapped for reading only up to its end
+        return nullptr;
+    }
+    void *memory = mmap(nullptr, WEATHERBUSLITE_STORE_SEGMENT_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                        MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? nullptr : (char *)memory;
+}
+
+/**
+ * Constructor. Creates the directory if needed, finds the columns in it
+ * and recovers the tail of each; check valid() before use.
+ *
+ * @param directory Where the segment files live
+ */
+WeatherBusLiteStore::WeatherBusLiteStore(const char *directory) : _directory(directory), _valid(false) {
+    if (mkdir(directory, 0755) < 0 && errno != EEXIST) {
+        return;
+    }
+    DIR *dir = opendir(directory);
+    if (dir == nullptr) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        int station;
+        char type;
+        unsigned number;
+        int end = 0;
+        if (sscanf(entry->d_name, "%d-%c-%u.wbl%n", &station, &type, &number, &end) != 3 ||
+            entry->d_name[end] != '\0' || end == 0) {
+            continue;
+        }
+        SegmentHeader header;
+        std::string file = _directory + "/" + entry->d_name;
+        if (!readHeader(file.c_str(), header) || header.station != station || header.type != type ||
+            header.number != number) {
+            continue;  // Created but never written; startSegment() reuses the name
+        }
+        Column *found = column(station, type, true);
+        if (found != nullptr) {
+            Segment segment = {number, header.base};
+            found->segments.push_back(segment);
+        }
+    }
+    closedir(dir);
+
+    for (auto &item : _columns) {
+        Column &found = item.second;
+        std::sort(found.segments.begin(), found.segments.end(),
+                  [](const Segment &a, const Segment &b) { return a.number < b.number; });
+        if (!openLast(found)) {
+            return;
+        }
+    }
+    _valid = true;
+}
+
+/**
+ * Destructor. Unmaps the segments; what was appended stays in the page
+ * cache and reaches the disk without sync(), just not at a known time.
+ */
+WeatherBusLiteStore::~WeatherBusLiteStore() {
+    for (auto &entry : _columns) {
+        closeLast(entry.second);
+    }
+}
+
+/**
+ * Check that the directory could be opened and every column recovered.
+ *
+ * @return True if usable
+ */
+bool WeatherBusLiteStore::valid() const {
+    return _valid;
+}
+
+/**
+ * Append a reading to the column of a sensor. Readings must come in time
+ * order per column; one older than the last is stored at the last time.
+ * A gap longer than WEATHERBUSLITE_STORE_MAX_DELTA costs 8 more bytes for
+ * the absolute time.
+ *
+ * @param station Station number, 0 to 16777215, e.g. the bus index
+ * @param type Sensor type, a letter or digit
+ * @param time ms since the Unix epoch, see weatherBusLiteEpochMillis
+ * @param value The value
+ * @param flags The quality flags
+ * @return True if stored, false if the station or type is invalid or a
+ *         segment could not be created
+ */
+bool WeatherBusLiteStore::append(int station, char type, uint64_t time, float value, uint8_t flags) {
+    Column *found = column(station, type, true);
+    if (found == nullptr) {
+        return false;
+    }
+    Column &column = *found;
+    uint64_t delta = time > column.last ? time - column.last : 0;
+    size_t slots = delta > WEATHERBUSLITE_STORE_MAX_DELTA ? 2 : 1;
+    if (column.records == nullptr || column.count + slots > SEGMENT_RECORDS) {
+        if (column.records != nullptr && column.dirty) {
+            // Start writing the full segment back; sync() waits for it
+            msync((char *)column.records - WEATHERBUSLITE_STORE_HEADER_SIZE, WEATHERBUSLITE_STORE_SEGMENT_SIZE, MS_ASYNC);
+            _unsynced.push_back(path(column, column.segments.back().number));
+        }
+        closeLast(column);
+        if (!startSegment(column, time > column.last ? time : column.last)) {
+            return false;
+        }
+        delta = 0;
+        slots = 1;
+    }
+
+    // One aligned store, so a crash never leaves half a record. The time of
+    // an escape goes first, so the record is zero until its time is there.
+    if (slots == 2) {
+        __atomic_store_n(&column.records[column.count + 1], column.last + delta, __ATOMIC_RELAXED);
+        delta = ESCAPE_DELTA;
+    }
+    __atomic_store_n(&column.records[column.count], packRecord(delta, value, flags), __ATOMIC_RELEASE);
+    column.count += slots;
+    column.last = time > column.last ? time : column.last;
+    column.dirty = true;
+    return true;
+}
+
+/**
+ * Read the readings of a sensor in a time range. Only the segments that
+ * overlap the range are mapped.
+ *
+ * @param station Station number
+ * @param type Sensor type
+ * @param from First time, ms since the Unix epoch
+ * @param to Last time, inclusive
+ * @param samples The readings are appended to it, oldest first
+ * @return True on success, false if a segment could not be mapped
+ */
+bool WeatherBusLiteStore::read(int station, char type, uint64_t from, uint64_t to,
+                               std::vector<WeatherBusLiteStoredReading> &samples) {
+    Column *found = column(station, type, false);
+    if (found == nullptr) {
+        return true;  // Nothing stored yet
+    }
+    Column &column = *found;
+    for (size_t i = 0; i < column.segments.size(); i++) {
+        const Segment &segment = column.segments[i];
+        if (segment.base > to) {
+            break;
+        }
+        if (i + 1 < column.segments.size() && column.segments[i + 1].base < from) {
+            continue;  // Ends before the range
+        }
+
+        bool last = i + 1 == column.segments.size();
+        const uint64_t *records = column.records;
+        size_t count = column.count;
+        char *mapping = nullptr;
+        if (!last || records == nullptr) {
+            mapping = mapSegment(path(column, segment.number).c_str(), false);
+            if (mapping == nullptr) {
+                return false;
+            }
+            records = (const uint64_t *)(mapping + WEATHERBUSLITE_STORE_HEADER_SIZE);
+            count = SEGMENT_RECORDS;
+        }
+
+        uint64_t time = segment.base;
+        WeatherBusLiteStoredReading sample;
+        size_t used;
+        for (size_t j = 0; j < count && (used = unpackRecord(records, j, count, time, sample)) > 0; j += used) {
+            if (time > to) {
+                break;
+            }
+            if (time >= from) {
+                samples.push_back(sample);
+            }
+        }
+        if (mapping != nullptr) {
+            munmap(mapping, WEATHERBUSLITE_STORE_SEGMENT_SIZE);
+        }
+    }
+    return true;
+}
+
+/**
+ * Write everything appended so far to disk, so it survives a power loss.
+ *
+ * @return True on success, false if a segment or the directory could not be synced
+ */
+bool WeatherBusLiteStore::sync() {
+    bool ok = true;
+    for (auto &entry : _columns) {
+        Column &column = entry.second;
+        if (column.records != nullptr && column.dirty) {
+            char *mapping = (char *)column.records - WEATHERBUSLITE_STORE_HEADER_SIZE;
+            ok = msync(mapping, WEATHERBUSLITE_STORE_SEGMENT_SIZE, MS_SYNC) == 0 && ok;
+            column.dirty = false;
+        }
+    }
+    for (size_t i = 0; i < _unsynced.size(); i++) {
+        int fd = open(_unsynced[i].c_str(), O_RDONLY | O_CLOEXEC);
+        ok = fd >= 0 && fdatasync(fd) == 0 && ok;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    _unsynced.clear();
+    int fd = open(_directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);  // New segment names
+    if (fd < 0) {
+        return false;
+    }
+    ok = fsync(fd) == 0 && ok;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Key of a column in _columns.
+ *
+ * @param station Station number
+ * @param type Sensor type
+ * @return The key
+ */
+uint32_t WeatherBusLiteStore::key(int station, char type) {
+    return ((uint32_t)station << 8) | (uint8_t)type;
+}
+
+/**
+ * Path of a segment file.
+ *
+ * @param column The column
+ * @param number Number of the segment
+ * @return The path
+ */
+std::string WeatherBusLiteStore::path(const Column &column, uint32_t number) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%d-%c-%06u.wbl", column.station, column.type, number);
+    return _directory + name;
+}
+
+/**
+ * Find a column.
+ *
+ * @param station Station number
+ * @param type Sensor type
+ * @param create True to add the column if it does not exist
+ * @return The column, nullptr if it does not exist or the station or type is invalid
+ */
+WeatherBusLiteStore::Column *WeatherBusLiteStore::column(int station, char type, bool create) {
+    if (station < 0 || station > 0xffffff || !isalnum((unsigned char)type)) {
+        return nullptr;
+    }
+    auto found = _columns.find(key(station, type));
+    if (found != _columns.end()) {
+        return &found->second;
+    }
+    if (!create) {
+        return nullptr;
+    }
+    Column column = {station, type, std::vector<Segment>(), nullptr, 0, 0, false};
+    return &_columns.emplace(key(station, type), column).first->second;
+}
+
+/**
+ * Map the last segment of a column for appending and find its tail: the
+ * first zero record, or an escape record whose time is missing. Records
+ * behind it are from writes that reached the disk out of order before a
+ * power loss and are cleared, so that later appends cannot run into them.
+ *
+ * @param column The column, with at least one segment
+ * @return True on success, false if the segment could not be mapped
+ */
+bool WeatherBusLiteStore::openLast(Column &column) {
+    const Segment &segment = column.segments.back();
+    char *mapping = mapSegment(path(column, segment.number).c_str(), true);
+    if (mapping == nullptr) {
+        return false;
+    }
+    column.records = (uint64_t *)(mapping + WEATHERBUSLITE_STORE_HEADER_SIZE);
+    column.count = 0;
+    column.last = segment.base;
+    WeatherBusLiteStoredReading sample;
+    size_t used;
+    while (column.count < SEGMENT_RECORDS &&
+           (used = unpackRecord(column.records, column.count, SEGMENT_RECORDS, column.last, sample)) > 0) {
+        column.count += used;
+    }
+
+    // Clear the rest of the tail's page by hand and the pages after it with
+    // FALLOC_FL_ZERO_RANGE, which reads nothing; scan them if the
+    // filesystem cannot do that
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t tailEnd = WEATHERBUSLITE_STORE_HEADER_SIZE + (column.count + 1) * sizeof(uint64_t);
+    size_t pageEnd = (tailEnd + page - 1) / page * page;
+    size_t cleared = (pageEnd - WEATHERBUSLITE_STORE_HEADER_SIZE) / sizeof(uint64_t);
+    if (pageEnd < WEATHERBUSLITE_STORE_SEGMENT_SIZE) {
+        int fd = open(path(column, segment.number).c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0 || fallocate(fd, FALLOC_FL_ZERO_RANGE, pageEnd, WEATHERBUSLITE_STORE_SEGMENT_SIZE - pageEnd) < 0) {
+            cleared = SEGMENT_RECORDS;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    for (size_t i = column.count; i < cleared && i < SEGMENT_RECORDS; i++) {  // An escape without its time too
+        if (column.records[i] != 0) {
+            column.records[i] = 0;
+            column.dirty = true;
+        }
+    }
+    return true;
+}
+
+/**
+ * Create the next segment of a column and map it for appending.
+ *
+ * @param column The column, with no segment mapped
+ * @param time Time of the first reading
+ * @return True on success, false if the file could not be created
+ */
+bool WeatherBusLiteStore::startSegment(Column &column, uint64_t time) {
+    uint32_t number = column.segments.empty() ? 0 : column.segments.back().number + 1;
+    std::string file = path(column, number);
+    int fd = open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // Any earlier contents are from a segment whose header never reached
+    // the disk. Reserving the blocks up front turns a full disk into an
+    // error here rather than SIGBUS on an append.
+    int error = ftruncate(fd, 0) < 0 ? errno : posix_fallocate(fd, 0, WEATHERBUSLITE_STORE_SEGMENT_SIZE);
+    if (error == EOPNOTSUPP || error == EINVAL) {
+        error = ftruncate(fd, WEATHERBUSLITE_STORE_SEGMENT_SIZE) < 0 ? errno : 0;  // Filesystem cannot reserve
+    }
+    close(fd);
+    char *mapping = error == 0 ? mapSegment(file.c_str(), true) : nullptr;
+    if (mapping == nullptr) {
+        unlink(file.c_str());
+        return false;
+    }
+
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "WBLS", 4);
+    header.version = SEGMENT_VERSION;
+    header.type = column.type;
+    header.station = column.station;
+    header.number = number;
+    header.base = time;
+    memcpy(mapping, &header, sizeof(header));
+
+    Segment segment = {number, time};
+    column.segments.push_back(segment);
+    column.records = (uint64_t *)(mapping + WEATHERBUSLITE_STORE_HEADER_SIZE);
+    column.count = 0;
+    column.last = time;
+    column.dirty = true;
+    return true;
+}
+
+/**
+ * Unmap the last segment of a column, if mapped.
+ *
+ * @param column The column
+ */
+void WeatherBusLiteStore::closeLast(Column &column) {
+    if (column.records != nullptr) {
+        munmap((char *)column.records - WEATHERBUSLITE_STORE_HEADER_SIZE, WEATHERBUSLITE_STORE_SEGMENT_SIZE);
+        column.records = nullptr;
+    }
+}
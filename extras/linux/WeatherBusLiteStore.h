@@ -0,0 +1,86 @@
+#ifndef WEATHERBUSLITE_STORE_H
+#define WEATHERBUSLITE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// bytes per segment file, a multiple of the page size; 4 MiB holds about
+// six days of 1 Hz readings for one sensor, and is reserved on disk in full
+// when the segment is created
+#define WEATHERBUSLITE_STORE_SEGMENT_SIZE (4UL << 20)
+
+// bytes at the start of a segment before its first record
+#define WEATHERBUSLITE_STORE_HEADER_SIZE 64
+
+// longest gap between two readings in ms stored as a delta, about 4.7
+// hours; a longer gap takes an escape record followed by the absolute time
+#define WEATHERBUSLITE_STORE_MAX_DELTA 0xfffffdUL
+
+// One stored reading.
+struct WeatherBusLiteStoredReading {
+    uint64_t time;  // ms since the Unix epoch
+    float value;
+    uint8_t flags;  // WEATHERBUSLITE_FLAG_* bits
+};
+
+// Embedded time-series store for a Linux collector. Every sensor of every
+// station is a column of its own, kept as a series of fixed-size segment
+// files named <station>-<type>-<number>.wbl in one directory. A segment
+// has a header with the time of its first reading, followed by 8-byte
+// records of the ms since the previous reading, the flags and the value.
+// After a gap too long for the delta, the record is followed by another 8
+// bytes with the absolute time, so an outage does not start a new segment.
+//
+// Segments are memory-mapped and only ever appended to, so an append is a
+// single store into the page cache. Each record is written with one
+// aligned 64-bit store and is never all zero, and unused space is zero, so
+// after a crash the column ends at the first zero record; on open,
+// anything behind it is cleared. The absolute time of an escape is stored
+// before its record, so a crash between the two leaves the record zero. Readings survive the process crashing;
+// those since the last sync() may be lost if the machine loses power.
+//
+// Not thread-safe; append from one thread, such as the collector's
+// aggregator.
+class WeatherBusLiteStore {
+public:
+    explicit WeatherBusLiteStore(const char *directory);
+    ~WeatherBusLiteStore();
+
+    bool valid() const;
+    bool append(int station, char type, uint64_t time, float value, uint8_t flags = 0);
+    bool read(int station, char type, uint64_t from, uint64_t to, std::vector<WeatherBusLiteStoredReading> &samples);
+    bool sync();
+
+private:
+    struct Segment {
+        uint32_t number;
+        uint64_t base;  // Time of the first reading
+    };
+
+    struct Column {
+        int station;
+        char type;
+        std::vector<Segment> segments;  // Oldest first
+        uint64_t *records;              // Mapping of the last segment, nullptr if none
+        size_t count;                   // Records in the last segment
+        uint64_t last;                  // Time of the last reading
+        bool dirty;                     // Appended to since the last sync()
+    };
+
+    static uint32_t key(int station, char type);
+    std::string path(const Column &column, uint32_t number) const;
+    Column *column(int station, char type, bool create);
+    bool openLast(Column &column);
+    bool startSegment(Column &column, uint64_t time);
+    void closeLast(Column &column);
+
+    std::string _directory;
+    bool _valid;
+    std::unordered_map<uint32_t, Column> _columns;
+    std::vector<std::string> _unsynced;  // Segments closed since the last sync()
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef WEATHERBUSLITE_TASK_H
+#define WEATHERBUSLITE_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+#include <utility>
+
+#include "WeatherBusLiteFramePool.h"
+
+// Lazily started coroutine returning T, for the C++20 host API. It runs
+// when awaited. If it finishes without suspending, the awaiter just
+// carries on; if it suspended, it resumes the awaiter directly when it
+// finishes. Either way a chain of awaits costs no event loop round trips,
+// and the stack stays flat even where the compiler does not turn
+// symmetric transfer into a tail call (sanitizer builds, -O0). Frames
+// come from WeatherBusLiteFramePool.
+//
+//     WeatherBusLiteTask<bool> sweep(WeatherBusLiteAsyncBus &bus) {
+//         float t;
+//         if (co_await bus.queryTemp(t) && t > 30) {
+//             float w;
+//             co_await bus.queryWindSpeed(w);
+//         }
+//         co_return true;
+//     }
+template <typename T>
+class WeatherBusLiteTask;
+
+namespace WeatherBusLiteTaskDetail {
+
+// Resumes whoever awaited the finished task, if it had to suspend
+struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        auto &promise = handle.promise();
+        return promise.suspended ? promise.continuation : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    bool suspended = false;  // The awaiter is suspended waiting for us
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+
+    static void *operator new(size_t size) { return WeatherBusLiteFramePool::allocate(size); }
+    static void operator delete(void *frame, size_t size) { WeatherBusLiteFramePool::release(frame, size); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    T value;
+
+    WeatherBusLiteTask<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T result() { return std::move(value); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    WeatherBusLiteTask<void> get_return_object();
+    void return_void() {}
+    void result() {}
+};
+
+}
+
+template <typename T>
+class WeatherBusLiteTask {
+public:
+    typedef WeatherBusLiteTaskDetail::Promise<T> promise_type;
+
+    explicit WeatherBusLiteTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+    WeatherBusLiteTask(WeatherBusLiteTask &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+    WeatherBusLiteTask(const WeatherBusLiteTask &) = delete;
+    WeatherBusLiteTask &operator=(const WeatherBusLiteTask &) = delete;
+
+    ~WeatherBusLiteTask() {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> awaiter) {
+        _handle.promise().continuation = awaiter;
+        _handle.resume();
+        if (_handle.done()) {
+            return false;  // Finished synchronously, carry on without suspending
+        }
+        _handle.promise().suspended = true;
+        return true;
+    }
+
+    T await_resume() { return _handle.promise().result(); }
+
+    // Hands the coroutine over, e.g. to WeatherBusLiteEventLoop::spawn
+    std::coroutine_handle<promise_type> release() { return std::exchange(_handle, nullptr); }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+namespace WeatherBusLiteTaskDetail {
+
+template <typename T>
+WeatherBusLiteTask<T> Promise<T>::get_return_object() {
+    return WeatherBusLiteTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline WeatherBusLiteTask<void> Promise<void>::get_return_object() {
+    return WeatherBusLiteTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteTransport.h"
+#include "WeatherBusLiteUring.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * Create the best transport the kernel supports.
+ *
+ * @param preferUring False to skip io_uring, e.g. where it is disabled by policy
+ * @return An io_uring transport if available, an epoll transport otherwise,
+ *         nullptr if neither could be set up
+ */
+WeatherBusLiteTransport *WeatherBusLiteTransport::create(bool preferUring) {
+    if (preferUring) {
+        WeatherBusLiteUringTransport *uring = new WeatherBusLiteUringTransport();
+        if (uring->valid()) {
+            return uring;
+        }
+        delete uring;
+    }
+    WeatherBusLiteEpollTransport *epoll = new WeatherBusLiteEpollTransport();
+    if (epoll->valid()) {
+        return epoll;
+    }
+    delete epoll;
+    return nullptr;
+}
+
+/**
+ * Constructor.
+ */
+WeatherBusLiteEpollTransport::WeatherBusLiteEpollTransport() : _epollFd(epoll_create1(EPOLL_CLOEXEC)) {}
+
+/**
+ * Destructor. The bus descriptors stay open.
+ */
+WeatherBusLiteEpollTransport::~WeatherBusLiteEpollTransport() {
+    if (_epollFd >= 0) {
+        close(_epollFd);
+    }
+}
+
+/**
+ * Check that setup succeeded.
+ *
+ * @return True if usable
+ */
+bool WeatherBusLiteEpollTransport::valid() const {
+    return _epollFd >= 0;
+}
+
+/**
+ * Add a bus.
+ *
+ * @param fd Non-blocking descriptor of the bus
+ * @return Index of the bus, -1 on error
+ */
+int WeatherBusLiteEpollTransport::add(int fd) {
+    if (_buses.size() >= WEATHERBUSLITE_TRANSPORT_MAX_BUSES) {
+        return -1;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = _buses.size();
+    _systemCalls++;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        return -1;
+    }
+    _buses.push_back(Bus());
+    _buses.back().fd = fd;
+    return _buses.size() - 1;
+}
+
+/**
+ * Write to a bus at once.
+ *
+ * @param bus Index of the bus
+ * @param data The bytes
+ * @param length Number of bytes
+ * @return True if all bytes were written, false otherwise
+ */
+bool WeatherBusLiteEpollTransport::write(int bus, const char *data, size_t length) {
+    ssize_t written;
+    do {
+        _systemCalls++;
+        written = ::write(_buses[bus].fd, data, length);
+    } while (written < 0 && errno == EINTR);
+    return written == (ssize_t)length;
+}
+
+/**
+ * Wait for bytes and read them, one read() per readable bus.
+ *
+ * @param events Receives the bytes per bus
+ * @param max Size of events
+ * @param timeout Maximum wait in ms, -1 to wait forever
+ * @return Number of events, -1 on error
+ */
+int WeatherBusLiteEpollTransport::wait(WeatherBusLiteTransportEvent *events, int max, int timeout) {
+    struct epoll_event ready[64];
+    _systemCalls++;
+    int count = epoll_wait(_epollFd, ready, max < 64 ? max : 64, timeout);
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        Bus &bus = _buses[ready[i].data.u32];
+        _systemCalls++;
+        ssize_t length = read(bus.fd, bus.buffer, sizeof(bus.buffer));
+        if (length > 0) {
+            events[found].bus = ready[i].data.u32;
+            events[found].data = bus.buffer;
+            events[found].length = length;
+            found++;
+        }
+    }
+    return found;
+}
+
+/**
+ * Name of the transport.
+ *
+ * @return "epoll"
+ */
+const char *WeatherBusLiteEpollTransport::name() const {
+    return "epoll";
+}
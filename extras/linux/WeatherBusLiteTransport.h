@@ -0,0 +1,70 @@
+#ifndef WEATHERBUSLITE_TRANSPORT_H
+#define WEATHERBUSLITE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// most buses a transport serves
+#define WEATHERBUSLITE_TRANSPORT_MAX_BUSES 1024
+
+// bytes of a bus's outgoing query slot
+#define WEATHERBUSLITE_TRANSPORT_SLOT 32
+
+// bytes of one receive buffer
+#define WEATHERBUSLITE_TRANSPORT_BUFFER 256
+
+// Bytes received on a bus. The data stays valid until the next wait().
+struct WeatherBusLiteTransportEvent {
+    int bus;           // Index returned by add
+    const char *data;
+    size_t length;
+};
+
+// Moves bytes for many buses on one thread, which must be the thread
+// that created it. A transport may hold writes back until the next
+// wait() to batch them with its receive system calls. Counts the system
+// calls it makes, for benchmarking.
+class WeatherBusLiteTransport {
+public:
+    virtual ~WeatherBusLiteTransport() {}
+
+    virtual int add(int fd) = 0;
+    virtual bool write(int bus, const char *data, size_t length) = 0;
+    virtual int wait(WeatherBusLiteTransportEvent *events, int max, int timeout) = 0;
+    virtual const char *name() const = 0;
+
+    uint64_t systemCalls() const { return _systemCalls; }
+
+    static WeatherBusLiteTransport *create(bool preferUring = true);
+
+protected:
+    WeatherBusLiteTransport() : _systemCalls(0) {}
+
+    uint64_t _systemCalls;
+};
+
+// Fallback: level-triggered epoll, one read() per readable bus and one
+// write() per query.
+class WeatherBusLiteEpollTransport : public WeatherBusLiteTransport {
+public:
+    WeatherBusLiteEpollTransport();
+    ~WeatherBusLiteEpollTransport();
+
+    bool valid() const;
+    int add(int fd);
+    bool write(int bus, const char *data, size_t length);
+    int wait(WeatherBusLiteTransportEvent *events, int max, int timeout);
+    const char *name() const;
+
+private:
+    struct Bus {
+        int fd;
+        char buffer[WEATHERBUSLITE_TRANSPORT_BUFFER];
+    };
+
+    int _epollFd;
+    std::vector<Bus> _buses;
+};
+
+#endif
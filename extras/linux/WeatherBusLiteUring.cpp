@@ -0,0 +1,362 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteUring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// user_data of a completion: bus index << 1, low bit set for writes
+#define TAG_WRITE 1
+
+// user_data of buffers handed back to the kernel, their completions are dropped
+#define TAG_PROVIDE UINT64_MAX
+
+/**
+ * Map zeroed, pre-faulted memory for buffers the kernel uses.
+ *
+ * @param size Number of bytes
+ * @return The memory, nullptr on error
+ */
+static void *mapAnonymous(size_t size) {
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+/**
+ * Constructor. Sets up the rings and registers the buffers; check
+ * valid() before use.
+ */
+WeatherBusLiteUringTransport::WeatherBusLiteUringTransport()
+    : _ringFd(-1), _multishot(true), _sqRing(nullptr), _sqRingSize(0), _sqes(nullptr), _sqesSize(0), _sqLocalTail(0),
+      _toSubmit(0), _buffers(nullptr), _slots(nullptr) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    _ringFd = syscall(__NR_io_uring_setup, WEATHERBUSLITE_URING_ENTRIES, &params);
+    if (_ringFd < 0 && errno == EINVAL) {
+        memset(&params, 0, sizeof(params));  // Kernels before 6.1
+        _ringFd = syscall(__NR_io_uring_setup, WEATHERBUSLITE_URING_ENTRIES, &params);
+    }
+    if (_ringFd < 0) {
+        return;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        close(_ringFd);  // Older than 5.11
+        _ringFd = -1;
+        return;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    _sqRingSize = sqSize > cqSize ? sqSize : cqSize;
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = (struct io_uring_sqe *)mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+    if (_sqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+        _sqRing = _sqRing == MAP_FAILED ? nullptr : _sqRing;
+        _sqes = _sqes == MAP_FAILED ? nullptr : _sqes;
+        close(_ringFd);
+        _ringFd = -1;
+        return;
+    }
+
+    char *ring = (char *)_sqRing;
+    _sqHead = (unsigned *)(ring + params.sq_off.head);
+    _sqTail = (unsigned *)(ring + params.sq_off.tail);
+    _sqMask = *(unsigned *)(ring + params.sq_off.ring_mask);
+    _sqArray = (unsigned *)(ring + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        _sqArray[i] = i;  // Entries are always used in ring order
+    }
+    _sqLocalTail = *_sqTail;
+    _cqHead = (unsigned *)(ring + params.cq_off.head);
+    _cqTail = (unsigned *)(ring + params.cq_off.tail);
+    _cqMask = *(unsigned *)(ring + params.cq_off.ring_mask);
+    _cqes = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+
+    // Receive buffers, handed to the kernel with provide-buffers entries
+    _buffers = (char *)mapAnonymous(WEATHERBUSLITE_URING_BUFFERS * WEATHERBUSLITE_TRANSPORT_BUFFER);
+
+    // Write slots, registered so fixed writes skip pinning pages per call
+    _slots = (char *)mapAnonymous(WEATHERBUSLITE_TRANSPORT_MAX_BUSES * WEATHERBUSLITE_TRANSPORT_SLOT);
+    struct iovec slots = {_slots, WEATHERBUSLITE_TRANSPORT_MAX_BUSES * WEATHERBUSLITE_TRANSPORT_SLOT};
+
+    if (_buffers == nullptr || _slots == nullptr ||
+        syscall(__NR_io_uring_register, _ringFd, IORING_REGISTER_BUFFERS, &slots, 1) < 0) {
+        close(_ringFd);
+        _ringFd = -1;
+        return;
+    }
+    for (uint16_t i = 0; i < WEATHERBUSLITE_URING_BUFFERS; i++) {
+        _returned.push_back(i);  // Provided on the first wait()
+    }
+}
+
+/**
+ * Destructor. Closing the ring cancels outstanding reads; the bus
+ * descriptors stay open.
+ */
+WeatherBusLiteUringTransport::~WeatherBusLiteUringTransport() {
+    if (_ringFd >= 0) {
+        close(_ringFd);
+    }
+    if (_sqRing != nullptr) {
+        munmap(_sqRing, _sqRingSize);
+    }
+    if (_sqes != nullptr) {
+        munmap(_sqes, _sqesSize);
+    }
+    if (_buffers != nullptr) {
+        munmap(_buffers, WEATHERBUSLITE_URING_BUFFERS * WEATHERBUSLITE_TRANSPORT_BUFFER);
+    }
+    if (_slots != nullptr) {
+        munmap(_slots, WEATHERBUSLITE_TRANSPORT_MAX_BUSES * WEATHERBUSLITE_TRANSPORT_SLOT);
+    }
+}
+
+/**
+ * Check that setup succeeded.
+ *
+ * @return True if usable, false if io_uring or a feature it needs is missing
+ */
+bool WeatherBusLiteUringTransport::valid() const {
+    return _ringFd >= 0;
+}
+
+/**
+ * Check whether reads are multishot. The first read on a kernel without
+ * them fails, after which every read is re-armed after each completion.
+ *
+ * @return True if multishot
+ */
+bool WeatherBusLiteUringTransport::multishot() const {
+    return _multishot;
+}
+
+/**
+ * Add a bus. Its read is armed on the next wait().
+ *
+ * @param fd Non-blocking descriptor of the bus
+ * @return Index of the bus, -1 if the transport is full
+ */
+int WeatherBusLiteUringTransport::add(int fd) {
+    if (_buses.size() >= WEATHERBUSLITE_TRANSPORT_MAX_BUSES) {
+        return -1;
+    }
+    Bus bus = {fd, false, false, false, false};
+    _buses.push_back(bus);
+    return _buses.size() - 1;
+}
+
+/**
+ * Queue a write. It is submitted with the next wait().
+ *
+ * @param bus Index of the bus
+ * @param data The bytes, at most WEATHERBUSLITE_TRANSPORT_SLOT
+ * @param length Number of bytes
+ * @return True if queued, false if too long or the last write is still pending
+ */
+bool WeatherBusLiteUringTransport::write(int bus, const char *data, size_t length) {
+    Bus &entry = _buses[bus];
+    if (entry.writing || length > WEATHERBUSLITE_TRANSPORT_SLOT) {
+        return false;
+    }
+    char *slot = _slots + bus * WEATHERBUSLITE_TRANSPORT_SLOT;
+    memcpy(slot, data, length);
+
+    struct io_uring_sqe *sqe = nextSqe();
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = entry.fd;
+    sqe->off = (uint64_t)-1;  // Stream, no offset
+    sqe->addr = (uint64_t)(uintptr_t)slot;
+    sqe->len = length;
+    sqe->buf_index = 0;
+    sqe->user_data = ((uint64_t)bus << 1) | TAG_WRITE;
+    entry.writing = true;
+    return true;
+}
+
+/**
+ * Submit queued work and collect received bytes.
+ *
+ * @param events Receives the bytes per completion
+ * @param max Size of events
+ * @param timeout Maximum wait in ms, -1 to wait forever
+ * @return Number of events, -1 on error
+ */
+int WeatherBusLiteUringTransport::wait(WeatherBusLiteTransportEvent *events, int max, int timeout) {
+    // Buffers the caller was reading since the last wait() go back to the
+    // kernel, one entry per run of consecutive ids
+    for (size_t i = 0; i < _returned.size();) {
+        size_t run = 1;
+        while (i + run < _returned.size() && _returned[i + run] == _returned[i] + run) {
+            run++;
+        }
+        provide(_returned[i], run);
+        i += run;
+    }
+    _returned.clear();
+
+    for (size_t i = 0; i < _buses.size(); i++) {
+        if (!_buses[i].reading && !_buses[i].closed) {
+            arm(i);
+        }
+    }
+
+    bool ready = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE) != *_cqHead;
+    if (_toSubmit > 0 || !ready) {
+        if (enter(ready ? 0 : 1, timeout) < 0) {
+            return -1;
+        }
+    }
+
+    int found = 0;
+    unsigned head = *_cqHead;
+    unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail && found < max) {
+        struct io_uring_cqe *cqe = &_cqes[head & _cqMask];
+        head++;
+        if (cqe->user_data == TAG_PROVIDE) {
+            continue;
+        }
+        Bus &bus = _buses[cqe->user_data >> 1];
+        if (cqe->user_data & TAG_WRITE) {
+            bus.writing = false;  // A failed write shows up as a timeout
+            continue;
+        }
+
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            uint16_t id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            _returned.push_back(id);
+            if (cqe->res > 0) {
+                events[found].bus = cqe->user_data >> 1;
+                events[found].data = _buffers + id * WEATHERBUSLITE_TRANSPORT_BUFFER;
+                events[found].length = cqe->res;
+                found++;
+            }
+        }
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            bus.reading = false;  // Re-armed on the next wait()
+        }
+        if (cqe->res == -EINVAL && bus.multishot) {
+            _multishot = false;  // Kernel before 6.7
+        } else if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -EAGAIN && cqe->res != -EINTR)) {
+            bus.closed = true;  // Hung up or failed; stop reading it
+        }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    return found;
+}
+
+/**
+ * Name of the transport.
+ *
+ * @return "io_uring", or "io_uring (single reads)" without multishot reads
+ */
+const char *WeatherBusLiteUringTransport::name() const {
+    return _multishot ? "io_uring" : "io_uring (single reads)";
+}
+
+/**
+ * Get a free submission entry, flushing the queue if it is full.
+ *
+ * @return The zeroed entry
+ */
+struct io_uring_sqe *WeatherBusLiteUringTransport::nextSqe() {
+    if (_sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) > _sqMask) {
+        enter(0, 0);
+    }
+    struct io_uring_sqe *sqe = &_sqes[_sqLocalTail & _sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    _sqLocalTail++;
+    _toSubmit++;
+    return sqe;
+}
+
+/**
+ * Queue handing receive buffers to the kernel. The entry goes ahead of
+ * the reads armed after it, so they can use the buffers.
+ *
+ * @param first Id of the first buffer
+ * @param count Number of consecutive buffers
+ */
+void WeatherBusLiteUringTransport::provide(uint16_t first, unsigned count) {
+    struct io_uring_sqe *sqe = nextSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = count;
+    sqe->off = first;
+    sqe->addr = (uint64_t)(uintptr_t)(_buffers + first * WEATHERBUSLITE_TRANSPORT_BUFFER);
+    sqe->len = WEATHERBUSLITE_TRANSPORT_BUFFER;
+    sqe->buf_group = 0;
+    sqe->user_data = TAG_PROVIDE;
+}
+
+/**
+ * Queue the read of a bus into a provided buffer.
+ *
+ * @param bus Index of the bus
+ */
+void WeatherBusLiteUringTransport::arm(int bus) {
+    struct io_uring_sqe *sqe = nextSqe();
+    sqe->opcode = _multishot ? WEATHERBUSLITE_URING_OP_READ_MULTISHOT : IORING_OP_READ;
+    sqe->fd = _buses[bus].fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->off = (uint64_t)-1;
+    sqe->len = _multishot ? 0 : WEATHERBUSLITE_TRANSPORT_BUFFER;  // Multishot takes the buffer's size
+    sqe->user_data = (uint64_t)bus << 1;
+    _buses[bus].reading = true;
+    _buses[bus].multishot = _multishot;
+}
+
+/**
+ * Submit queued entries and optionally wait for completions.
+ *
+ * @param minComplete Completions to wait for
+ * @param timeout Maximum wait in ms, -1 to wait forever
+ * @return 0 on success or timeout, -1 on error
+ */
+int WeatherBusLiteUringTransport::enter(unsigned minComplete, int timeout) {
+    __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+
+    unsigned flags = IORING_ENTER_GETEVENTS;  // Also runs deferred completions
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (minComplete > 0 && timeout >= 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000L;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    _systemCalls++;
+    long submitted = syscall(__NR_io_uring_enter, _ringFd, _toSubmit, minComplete, flags,
+                             (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr, sizeof(arg));
+    if (submitted < 0) {
+        return (errno == ETIME || errno == EINTR || errno == EBUSY) ? 0 : -1;
+    }
+    _toSubmit -= submitted;
+    return 0;
+}
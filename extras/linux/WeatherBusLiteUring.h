@@ -0,0 +1,88 @@
+#ifndef WEATHERBUSLITE_URING_H
+#define WEATHERBUSLITE_URING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "WeatherBusLiteTransport.h"
+
+// submission queue entries, completions get twice as many
+#define WEATHERBUSLITE_URING_ENTRIES 2048
+
+// receive buffers shared by all buses, a power of two
+#define WEATHERBUSLITE_URING_BUFFERS 1024
+
+// IORING_OP_READ_MULTISHOT, added in Linux 6.7 and missing from older
+// uapi headers; the transport falls back to single reads without it
+#define WEATHERBUSLITE_URING_OP_READ_MULTISHOT 49
+
+// io_uring transport, talking to the kernel through the raw system calls.
+//
+// Every bus has one multishot read outstanding that picks receive buffers
+// from a group of provided buffers, so a bus that keeps receiving needs no
+// new submission. Queries are copied into per-bus slots of a registered
+// buffer and sent with fixed writes. Writes, re-armed reads and returned
+// buffers all go to the kernel with the next wait(), in the same
+// io_uring_enter() that collects completions, so one system call serves
+// every bus that had traffic.
+class WeatherBusLiteUringTransport : public WeatherBusLiteTransport {
+public:
+    WeatherBusLiteUringTransport();
+    ~WeatherBusLiteUringTransport();
+
+    bool valid() const;
+    int add(int fd);
+    bool write(int bus, const char *data, size_t length);
+    int wait(WeatherBusLiteTransportEvent *events, int max, int timeout);
+    const char *name() const;
+
+    bool multishot() const;
+
+private:
+    struct Bus {
+        int fd;
+        bool reading;       // A read is outstanding
+        bool multishot;     // The outstanding read is multishot
+        bool writing;       // The slot is still being written
+        bool closed;        // End of file or a hard error
+    };
+
+    struct io_uring_sqe *nextSqe();
+    void provide(uint16_t first, unsigned count);
+    void arm(int bus);
+    int enter(unsigned minComplete, int timeout);
+
+    int _ringFd;
+    bool _multishot;  // Multishot reads work, otherwise single reads
+
+    // Submission ring
+    void *_sqRing;
+    size_t _sqRingSize;
+    unsigned *_sqHead;
+    unsigned *_sqTail;
+    unsigned _sqMask;
+    unsigned *_sqArray;
+    struct io_uring_sqe *_sqes;
+    size_t _sqesSize;
+    unsigned _sqLocalTail;
+    unsigned _toSubmit;
+
+    // Completion ring, shares the submission ring's mapping
+    unsigned *_cqHead;
+    unsigned *_cqTail;
+    unsigned _cqMask;
+    struct io_uring_cqe *_cqes;
+
+    // Provided receive buffers
+    char *_buffers;
+    std::vector<uint16_t> _returned;  // Buffers handed out by the last wait()
+
+    // Registered write slots, one per bus
+    char *_slots;
+
+    std::vector<Bus> _buses;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * WeatherBusLiteAgro against the FAO-56 worked examples.
+ *
+ * The accumulator computes ET0 from the day's readings only, with solar
+ * radiation estimated from the temperature range, so its intermediate
+ * values are not visible. This harness carries a plain double precision
+ * implementation of the FAO-56 equations, checks that against the
+ * published examples (Allen et al. 1998, examples 2, 3, 8, 14 and 18),
+ * then checks the accumulator against it on synthetic days at several
+ * latitudes and seasons. The means, degree days and UV dose are checked
+ * against their exact integrals, at one reading a minute and at 1 Hz.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "HostTest.h"
+#include "WeatherBusLiteAgro.h"
+
+static double saturation(double t) {
+    return 0.6108 * exp(17.27 * t / (t + 237.3));  // eq. 11
+}
+
+static double pressureAt(double altitude) {
+    return 101.3 * pow((293.0 - 0.0065 * altitude) / 293.0, 5.26);  // eq. 7
+}
+
+static double extraterrestrial(double latitudeDegrees, int dayOfYear) {
+    double latitude = latitudeDegrees * M_PI / 180.0;
+    double inverseDistance = 1 + 0.033 * cos(2 * M_PI * dayOfYear / 365);  // eq. 23
+    double declination = 0.409 * sin(2 * M_PI * dayOfYear / 365 - 1.39);   // eq. 24
+    double sunset = acos(fmax(-1.0, fmin(1.0, -tan(latitude) * tan(declination))));
+    return 24 * 60 / M_PI * 0.0820 * inverseDistance
+           * (sunset * sin(latitude) * sin(declination) + cos(latitude) * cos(declination) * sin(sunset));  // eq. 21
+}
+
+/**
+ * Daily ET0, FAO-56 eq. 6, from solar radiation rs in MJ/m2/day.
+ */
+static double referenceEt0(double latitude, double altitude, int dayOfYear, double minTemp, double maxTemp,
+                           double ea, double u2, double rs) {
+    double ra = extraterrestrial(latitude, dayOfYear);
+    double rso = (0.75 + 2e-5 * altitude) * ra;  // eq. 37
+    double minK = minTemp + 273.16, maxK = maxTemp + 273.16;
+    double rnl = 4.903e-9 * (pow(minK, 4) + pow(maxK, 4)) / 2 * (0.34 - 0.14 * sqrt(ea))
+                 * (1.35 * fmin(rs / rso, 1.0) - 0.35);  // eq. 39
+    double rn = (1 - 0.23) * rs - rnl;
+    double meanTemp = (minTemp + maxTemp) / 2;
+    double delta = 4098 * saturation(meanTemp) / pow(meanTemp + 237.3, 2);  // eq. 13
+    double gamma = 0.665e-3 * pressureAt(altitude);                          // eq. 8
+    double es = (saturation(minTemp) + saturation(maxTemp)) / 2;
+    return (0.408 * delta * rn + gamma * 900 / (meanTemp + 273) * u2 * (es - ea)) / (delta + gamma * (1 + 0.34 * u2));
+}
+
+static bool near(double value, double expected, double tolerance) {
+    return fabs(value - expected) <= tolerance;
+}
+
+/**
+ * Feed one day: temperature swings from minTemp at 05:00 to maxTemp at
+ * 15:00, the other readings are constant, one reading a minute.
+ */
+static bool feedDay(WeatherBusLiteAgro &agro, unsigned long &now, uint16_t dayOfYear, float minTemp, float maxTemp,
+                    float humidity, float wind, WeatherBusLiteDailyRecord &record) {
+    for (int minute = 0; minute <= 24 * 60; minute++, now += 60000) {
+        double hour = minute / 60.0;
+        double phase = hour >= 5 && hour < 15 ? (hour - 5) / 10 : (hour < 5 ? (hour + 9) / 14 : (hour - 15) / 14);
+        double swing = hour >= 5 && hour < 15 ? (1 - cos(M_PI * phase)) / 2 : (1 + cos(M_PI * phase)) / 2;
+        float temperature = minTemp + (maxTemp - minTemp) * swing;
+        agro.update(temperature, humidity, wind, 0.0f, temperature, now);
+    }
+    return agro.closeDay(dayOfYear, record);
+}
+
+int main() {
+    // The reference against the published examples
+    double p1800 = pressureAt(1800);
+    printf("example 2:  P(1800 m) = %.1f kPa (81.8), gamma = %.4f kPa/C (0.054)\n", p1800, 0.665e-3 * p1800);
+    hostCheck(near(p1800, 81.8, 0.05) && near(0.665e-3 * p1800, 0.054, 0.0005), "example 2");
+    double es = (saturation(24.5) + saturation(15)) / 2;
+    printf("example 3:  es(15, 24.5 C) = %.2f kPa (2.39)\n", es);
+    hostCheck(near(es, 2.39, 0.005), "example 3");
+    double ra = extraterrestrial(-20, 246);
+    printf("example 8:  Ra(20 S, 3 Sep) = %.1f MJ/m2/day (32.2)\n", ra);
+    hostCheck(near(ra, 32.2, 0.05), "example 8");
+    double u2 = 3.2 * 4.87 / log(67.8 * 10 - 5.42);
+    printf("example 14: u2 from 3.2 m/s at 10 m = %.1f m/s (2.4)\n", u2);
+    hostCheck(near(u2, 2.4, 0.05), "example 14");
+    double brusselsEa = (saturation(12.3) * 0.84 + saturation(21.5) * 0.63) / 2;
+    double brussels = referenceEt0(50.8, 100, 187, 12.3, 21.5, brusselsEa, 2.078, 22.07);
+    printf("example 18: ET0 Brussels 6 July = %.2f mm/day (3.9)\n", brussels);
+    hostCheck(near(brussels, 3.9, 0.05), "example 18");
+
+    // The accumulator against the reference, Hargreaves radiation (eq. 50)
+    struct {
+        float latitude, altitude;
+        uint16_t day;
+        float minTemp, maxTemp, humidity, wind;
+    } days[] = {
+        {50.8f, 100, 187, 12.3f, 21.5f, 73.5f, 2.078f},  // Brussels, example 18
+        {-20.0f, 0, 246, 14.0f, 29.0f, 55.0f, 3.0f},
+        {13.7f, 2, 105, 25.0f, 34.8f, 65.0f, 2.0f},
+        {45.7f, 200, 15, -4.0f, 3.0f, 85.0f, 4.0f},
+        {67.0f, 300, 172, 8.0f, 19.0f, 60.0f, 1.5f},    // Polar day
+        {36.0f, 1800, 200, 16.0f, 33.0f, 25.0f, 5.0f},
+    };
+    double worstEt0 = 0;
+    unsigned long now = 0;
+    for (auto &d : days) {
+        WeatherBusLiteAgro agro(d.latitude, d.altitude);
+        WeatherBusLiteDailyRecord record;
+        bool valid = feedDay(agro, now, d.day, d.minTemp, d.maxTemp, d.humidity, d.wind, record);
+        double rs = 0.16 * sqrt(d.maxTemp - d.minTemp) * extraterrestrial(d.latitude, d.day);
+        double ea = (saturation(d.minTemp) + saturation(d.maxTemp)) / 2 * d.humidity / 100;
+        double expected = fmax(0.0, referenceEt0(d.latitude, d.altitude, d.day, d.minTemp, d.maxTemp, ea,
+                                                 d.wind * 4.87 / log(67.8 * 2 - 5.42), rs));
+        double error = fabs(record.evapotranspiration - expected);
+        worstEt0 = error > worstEt0 ? error : worstEt0;
+        printf("lat %5.1f day %3u: ET0 %.3f mm/day, reference %.3f\n", d.latitude, d.day, record.evapotranspiration,
+               expected);
+        hostCheck(valid && near(record.minTemp, d.minTemp, 1e-3) && near(record.maxTemp, d.maxTemp, 1e-3),
+                  "daily min and max");
+    }
+    hostCheck(worstEt0 < 0.01, "ET0 within 0.01 mm/day of the FAO-56 reference");
+
+    // Means, degree days and UV dose against exact integrals: 0 to 20 C over
+    // the first half of the day, back down over the second, UV index 4 for 6 h
+    WeatherBusLiteAgro agro(45.0f, 0.0f);
+    for (unsigned long minute = 0; minute <= 24 * 60; minute++) {
+        float temperature = minute <= 720 ? minute / 36.0f : (1440 - minute) / 36.0f;
+        float uv = minute >= 540 && minute < 900 ? 4.0f : 0.0f;
+        agro.update(temperature, 50.0f, 2.0f, uv, temperature + 1.5f, minute * 60000UL);
+    }
+    WeatherBusLiteDailyRecord record;
+    agro.closeDay(100, record);
+    printf("triangle day: mean %.4f C (10), degree days %.4f (2.5), UV dose %.0f J/m2 (2160), "
+           "canopy delta %.4f (1.5)\n",
+           record.meanTemp, record.degreeDays, record.uvDose, record.meanCanopyDelta);
+    hostCheck(near(record.meanTemp, 10.0, 1e-3), "mean temperature is the time integral");
+    hostCheck(near(record.degreeDays, 2.5, 1e-3), "degree days clip at the base temperature");
+    hostCheck(near(record.uvDose, 4 * 0.025 * 6 * 3600, 1.0), "UV dose integrates the UV index");
+    hostCheck(near(record.meanCanopyDelta, 1.5, 1e-4), "canopy delta");
+
+    // The same day at 1 Hz, past where a 16 bit sample count wraps
+    WeatherBusLiteAgro fast(45.0f, 0.0f);
+    for (unsigned long second = 0; second <= 86400; second++) {
+        float temperature = second <= 43200 ? second / 2160.0f : (86400 - second) / 2160.0f;
+        fast.update(temperature, 50.0f, 2.0f, 0.0f, temperature + 1.5f, second * 1000UL);
+    }
+    fast.closeDay(101, record);
+    printf("triangle day at 1 Hz: %lu samples, mean %.4f C (10)\n", (unsigned long)record.samples,
+           record.meanTemp);
+    hostCheck(record.samples == 86401, "a day at 1 Hz counts every sample");
+    hostCheck(near(record.meanTemp, 10.0, 1e-2), "a day at 1 Hz integrates every interval");
+    return hostResult();
+}
@@ -0,0 +1,223 @@
+/*
+ * WeatherBusLiteAirQuality against a naive raw-sample ring.
+ *
+ * The ring keeps every reading of the last day and recomputes the
+ * means by scanning it, which is what the windows replace. Both get a week
+ * of PM2.5 readings every 10 s, with dropped readings and a 7 hour outage,
+ * and are compared after every reading; the 8 and 24 hour means must
+ * agree to float rounding and be valid at the same times. The same
+ * readings given as US EPA indices through updateIndex() must give the
+ * same means. Then both are
+ * timed on the same readings with all four means read after each update,
+ * and their memory is printed.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "WeatherBusLiteAirQuality.h"
+
+#define READING_MS 10000UL
+#define RING_SIZE (25 * 3600000UL / READING_MS)  // 24 complete hours and the current one
+
+// Every reading of the last 25 hours, bucketed like the windows: minute
+// and hour numbers count from the first reading.
+class NaiveRing {
+public:
+    NaiveRing() : _values(RING_SIZE), _minutes(RING_SIZE), _head(0), _count(0), _started(false), _start(0), _now(0) {}
+
+    void update(float value, unsigned long now) {
+        if (!_started) {
+            _started = true;
+            _start = now;
+        }
+        _now = now;
+        if (isnan(value)) {
+            return;
+        }
+        _values[_head] = value;
+        _minutes[_head] = (now - _start) / 60000UL;
+        _head = (_head + 1) % RING_SIZE;
+        _count = _count < RING_SIZE ? _count + 1 : RING_SIZE;
+    }
+
+    bool hourlyMean(float &mean) const {
+        unsigned long minute = (_now - _start) / 60000UL;
+        double sum = 0;
+        unsigned n = 0;
+        for (size_t i = 0; i < _count; i++) {
+            if (_minutes[i] + 60 > minute) {
+                sum += _values[i];
+                n++;
+            }
+        }
+        mean = n > 0 ? sum / n : 0;
+        return n > 0;
+    }
+
+    // Mean of the hourly means of the last `hours` complete hours
+    bool hoursMean(unsigned hours, float &mean) const {
+        long complete = (_now - _start) / 3600000UL;
+        double hourSum[24] = {0};
+        unsigned hourCount[24] = {0};
+        for (size_t i = 0; i < _count; i++) {
+            long age = complete - 1 - (long)(_minutes[i] / 60);
+            if (age >= 0 && age < (long)hours) {
+                hourSum[age] += _values[i];
+                hourCount[age]++;
+            }
+        }
+        double sum = 0;
+        unsigned valid = 0;
+        for (unsigned h = 0; h < hours; h++) {
+            if (hourCount[h] > 0) {
+                sum += (float)(hourSum[h] / hourCount[h]);
+                valid++;
+            }
+        }
+        mean = valid > 0 ? sum / valid : 0;
+        return valid > 0 && valid * 100 >= hours * WEATHERBUSLITE_AQI_COMPLETENESS;
+    }
+
+    size_t bytes() const {
+        return RING_SIZE * (sizeof(float) + sizeof(unsigned long));
+    }
+
+private:
+    std::vector<float> _values;
+    std::vector<unsigned long> _minutes;
+    size_t _head;
+    size_t _count;
+    bool _started;
+    unsigned long _start;
+    unsigned long _now;
+};
+
+/**
+ * A week of readings: a daily cycle with spikes and noise, every 50th
+ * reading dropped, nothing at all on day 3 from 10:00 to 17:00.
+ */
+static std::vector<float> readings() {
+    std::vector<float> values;
+    srand(54);
+    for (unsigned long t = 0; t < 7 * 86400000UL; t += READING_MS) {
+        double hour = fmod(t / 3600000.0, 24.0);
+        double value = 12 + 8 * sin(hour / 24 * 2 * M_PI) + 4.0 * rand() / RAND_MAX;
+        if (rand() % 2000 == 0) {
+            value += 150;
+        }
+        bool outage = t >= 2 * 86400000UL + 10 * 3600000UL && t < 2 * 86400000UL + 17 * 3600000UL;
+        values.push_back(outage || rand() % 50 == 0 ? NAN : (float)value);
+    }
+    return values;
+}
+
+/**
+ * US EPA PM2.5 index of a concentration, 2024 breakpoints.
+ */
+static float indexOf(float concentration) {
+    static const double table[][2] = {{0, 0}, {9.0, 50}, {35.4, 100}, {55.4, 150}, {125.4, 200}, {225.4, 300},
+                                      {325.4, 500}};
+    for (int i = 1; i < 7; i++) {
+        if (concentration <= table[i][0]) {
+            return (float)(table[i - 1][1] + (concentration - table[i - 1][0]) * (table[i][1] - table[i - 1][1])
+                                                 / (table[i][0] - table[i - 1][0]));
+        }
+    }
+    return 500.0f;
+}
+
+static double relative(float a, float b) {
+    return fabs(a - b) / fmax(fabs(b), 1e-6);
+}
+
+int main() {
+    std::vector<float> values = readings();
+
+    WeatherBusLiteAirQuality windows, fromIndex;
+    NaiveRing ring;
+    double worstIndex = 0;
+    double worst1 = 0, worst8 = 0, worst24 = 0;
+    bool sameValidity = true;
+    unsigned long valid24 = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        unsigned long now = i * READING_MS;
+        windows.update(values[i], now);
+        fromIndex.updateIndex(isnan(values[i]) ? NAN : indexOf(values[i]), now);
+        ring.update(values[i], now);
+        float a, b;
+        bool okA = windows.hourlyMean(a), okB = ring.hourlyMean(b);
+        sameValidity = sameValidity && okA == okB;
+        if (okA && okB && relative(a, b) > worst1) {
+            worst1 = relative(a, b);
+        }
+        okA = windows.eightHourMean(a);
+        okB = ring.hoursMean(8, b);
+        sameValidity = sameValidity && okA == okB;
+        if (okA && okB && relative(a, b) > worst8) {
+            worst8 = relative(a, b);
+        }
+        okA = windows.dailyMean(a);
+        okB = ring.hoursMean(24, b);
+        sameValidity = sameValidity && okA == okB;
+        if (okA && okB && relative(a, b) > worst24) {
+            worst24 = relative(a, b);
+        }
+        valid24 += okA;
+        float c;
+        if (okA && fromIndex.dailyMean(c) && relative(c, a) > worstIndex) {
+            worstIndex = relative(c, a);
+        }
+    }
+    printf("%zu readings over 7 days: max relative difference 1 h %.1e, 8 h %.1e, 24 h %.1e; 24 h mean valid "
+           "for %lu readings\n",
+           values.size(), worst1, worst8, worst24, valid24);
+    hostCheck(sameValidity, "windows and ring agree on when each mean is valid");
+    hostCheck(worst1 < 1e-5 && worst8 < 1e-5 && worst24 < 1e-5, "means agree to float rounding");
+    // Valid from hour 18 on, less the day the outage leaves under 75% complete
+    hostCheck(valid24 < values.size() - 18 * 360, "the outage invalidates the 24 hour mean");
+    printf("index readings: max relative difference of the 24 h mean %.1e\n", worstIndex);
+    hostCheck(worstIndex < 1e-4, "queryAirQuality index readings give the same means");
+
+    // Speed: update and read all four values after every reading
+    volatile float sink = 0;
+    uint64_t start = hostNanos();
+    WeatherBusLiteAirQuality timedWindows;
+    for (size_t i = 0; i < values.size(); i++) {
+        float mean, aqi;
+        timedWindows.update(values[i], i * READING_MS);
+        timedWindows.hourlyMean(mean);
+        sink = mean;
+        timedWindows.eightHourMean(mean);
+        sink = mean;
+        timedWindows.dailyMean(mean);
+        sink = mean;
+        timedWindows.index(aqi);
+        sink = aqi;
+    }
+    double windowNs = (double)(hostNanos() - start) / values.size();
+
+    const size_t ringReadings = 20000;  // A scan per read makes the ring too slow for the whole week
+    start = hostNanos();
+    NaiveRing timedRing;
+    for (size_t i = 0; i < ringReadings; i++) {
+        float mean;
+        timedRing.update(values[i], i * READING_MS);
+        timedRing.hourlyMean(mean);
+        sink = mean;
+        timedRing.hoursMean(8, mean);
+        sink = mean;
+        timedRing.hoursMean(24, mean);
+        sink = mean;
+    }
+    double ringNs = (double)(hostNanos() - start) / ringReadings;
+    (void)sink;
+
+    printf("windows:    %5zu bytes, %8.1f ns per reading\n", sizeof(WeatherBusLiteAirQuality), windowNs);
+    printf("naive ring: %5zu bytes, %8.1f ns per reading (%zu bytes for 24 h of float values alone)\n", ring.bytes(),
+           ringNs, 24 * 3600000UL / READING_MS * sizeof(float));
+    return hostResult();
+}
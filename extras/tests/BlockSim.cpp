@@ -0,0 +1,99 @@
+/*
+ * Block transfer throughput over the simulated bus.
+ *
+ * Sends 16 KB to a node with WeatherBusLiteBlockSender at 9600 baud for
+ * windows of 1 to 32 blocks, and again at window 8 with 5% of the frames
+ * in either direction lost. Prints the payload rate as a share of the raw
+ * wire rate (base64 caps it at 75%) and checks that the node ends up with
+ * the whole transfer intact.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteBlock.h"
+
+#define LENGTH 16384
+#define BAUD 9600
+
+class BlockNode : public HostNode {
+public:
+    BlockNode(unsigned lossPercent)
+        : sink(buffer, sizeof(buffer)), receiver('T', sink, sizeof(buffer)), _lossPercent(lossPercent) {}
+
+    void receive(const char *line) {
+        if (lost()) {
+            return;  // Corrupted on the way to the node
+        }
+        HostBuffer reply;
+        if (receiver.handle(line, reply) && reply.length() > 0 && !lost()) {
+            reply.reply(3000);
+        }
+    }
+
+    uint8_t buffer[LENGTH];
+    WeatherBusLiteBufferSink sink;
+    WeatherBusLiteBlockReceiver receiver;
+
+private:
+    bool lost() {
+        return rand() % 100 < (int)_lossPercent;
+    }
+
+    unsigned _lossPercent;
+};
+
+/**
+ * Send the payload and return the payload rate as a share of the wire rate.
+ */
+static double run(const uint8_t *payload, uint8_t window, unsigned lossPercent, bool &intact, uint32_t &blocks) {
+    hostDetachAll();
+    srand(61);
+    BlockNode *node = new BlockNode(lossPercent);
+    hostAttach(node);
+    WeatherBusLite bus;
+    bus.begin(BAUD);
+    WeatherBusLiteBlockSender sender(bus, 'T', window);
+
+    uint64_t start = hostMicros();
+    bool sent = sender.send(payload, LENGTH);
+    double seconds = (hostMicros() - start) / 1e6;
+    intact = sent && node->receiver.complete() && node->receiver.length() == LENGTH
+             && memcmp(node->buffer, payload, LENGTH) == 0;
+    blocks = sender.blocksSent();
+    delete node;
+    return LENGTH * 10.0 / BAUD / seconds;
+}
+
+int main() {
+    static uint8_t payload[LENGTH];
+    srand(16);
+    for (int i = 0; i < LENGTH; i++) {
+        payload[i] = rand();
+    }
+
+    const uint8_t windows[] = {1, 2, 4, 8, 16, 32};
+    double efficiency[sizeof(windows)];
+    for (size_t i = 0; i < sizeof(windows); i++) {
+        bool intact;
+        uint32_t blocks;
+        efficiency[i] = run(payload, windows[i], 0, intact, blocks);
+        printf("window %2u:          %.1f%% of wire speed, %lu blocks sent\n", windows[i], efficiency[i] * 100,
+               (unsigned long)blocks);
+        hostCheck(intact, "transfer arrives intact");
+    }
+    hostCheck(efficiency[3] > efficiency[0], "a window beats stop and wait");
+    hostCheck(efficiency[5] < 0.75, "payload rate under the base64 ceiling");
+
+    bool intact;
+    uint32_t blocks;
+    double lossy = run(payload, 8, 5, intact, blocks);
+    printf("window  8, 5%% loss: %.1f%% of wire speed, %lu blocks sent for %u\n", lossy * 100, (unsigned long)blocks,
+           (LENGTH + WEATHERBUSLITE_BLOCK_SIZE - 1) / WEATHERBUSLITE_BLOCK_SIZE);
+    hostCheck(intact, "a lossy transfer arrives intact");
+    hostCheck(lossy > efficiency[3] * 0.75, "5% loss costs less than a quarter of the throughput");
+    return hostResult();
+}
@@ -0,0 +1,123 @@
+/*
+ * weatherBusLiteCalibrate accuracy and speed.
+ *
+ * Evaluates a linear, a cubic and a piecewise linear calibration over
+ * -20..120 in 0.001 steps and compares each with the same calibration in
+ * double precision from the unrounded coefficients. Then times the fixed
+ * point evaluation against the same polynomials in float. On the host both
+ * run on an FPU and a 64 bit multiplier, so the timings only compare the
+ * instruction counts; on an AVR or Cortex-M0 the float version is a
+ * software library call per operation. Finally a calibration passed to
+ * begin() is checked end to end on the simulated bus.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteCalibration.h"
+
+// A thermistor-style linearisation and its double reference
+static const double LINEAR[] = {-1.25, 1.0125};
+static const double CUBIC[] = {0.35, 0.987, 1.2e-4, -3.5e-7};
+static const double PIECEWISE[] = {-20, -19.6, 0, 0.3, 25, 25.1, 60, 59.2, 120, 118.5};
+
+static const int32_t linear[] = {WEATHERBUSLITE_COEFFICIENT(-1.25, 0), WEATHERBUSLITE_COEFFICIENT(1.0125, 1)};
+static const int32_t cubic[] = {WEATHERBUSLITE_COEFFICIENT(0.35, 0), WEATHERBUSLITE_COEFFICIENT(0.987, 1),
+                                WEATHERBUSLITE_COEFFICIENT(1.2e-4, 2), WEATHERBUSLITE_COEFFICIENT(-3.5e-7, 3)};
+static const int32_t piecewise[] = {
+    WEATHERBUSLITE_FIXED(-20), WEATHERBUSLITE_FIXED(-19.6), WEATHERBUSLITE_FIXED(0),   WEATHERBUSLITE_FIXED(0.3),
+    WEATHERBUSLITE_FIXED(25),  WEATHERBUSLITE_FIXED(25.1),  WEATHERBUSLITE_FIXED(60),  WEATHERBUSLITE_FIXED(59.2),
+    WEATHERBUSLITE_FIXED(120), WEATHERBUSLITE_FIXED(118.5)};
+
+static const WeatherBusLiteCalibration calibrations[] = {
+    {'T', WEATHERBUSLITE_CALIBRATION_LINEAR, 2, linear},
+    {'H', WEATHERBUSLITE_CALIBRATION_CUBIC, 4, cubic},
+    {'C', WEATHERBUSLITE_CALIBRATION_PIECEWISE, 5, piecewise},
+};
+
+static double reference(uint8_t kind, double x) {
+    switch (kind) {
+        case WEATHERBUSLITE_CALIBRATION_LINEAR:
+            return LINEAR[0] + LINEAR[1] * x;
+        case WEATHERBUSLITE_CALIBRATION_CUBIC:
+            return CUBIC[0] + x * (CUBIC[1] + x * (CUBIC[2] + x * CUBIC[3]));
+        default: {
+            int i = 1;
+            while (i < 4 && x > PIECEWISE[2 * i]) {
+                i++;
+            }
+            double x0 = PIECEWISE[2 * i - 2], y0 = PIECEWISE[2 * i - 1];
+            double x1 = PIECEWISE[2 * i], y1 = PIECEWISE[2 * i + 1];
+            return y0 + (y1 - y0) * (x - x0) / (x1 - x0);
+        }
+    }
+}
+
+static float floatCalibrate(uint8_t kind, float x) {
+    switch (kind) {
+        case WEATHERBUSLITE_CALIBRATION_LINEAR:
+            return -1.25f + 1.0125f * x;
+        case WEATHERBUSLITE_CALIBRATION_CUBIC:
+            return 0.35f + x * (0.987f + x * (1.2e-4f + x * -3.5e-7f));
+        default: {
+            static const float p[] = {-20, -19.6f, 0, 0.3f, 25, 25.1f, 60, 59.2f, 120, 118.5f};
+            int i = 1;
+            while (i < 4 && x > p[2 * i]) {
+                i++;
+            }
+            return p[2 * i - 1] + (p[2 * i + 1] - p[2 * i - 1]) * (x - p[2 * i - 2]) / (p[2 * i] - p[2 * i - 2]);
+        }
+    }
+}
+
+int main() {
+    const char *names[] = {"linear", "cubic", "piecewise"};
+    for (int k = 0; k < 3; k++) {
+        double worst = 0;
+        for (int i = -20000; i <= 120000; i++) {
+            float x = i / 1000.0f;
+            double error = fabs(weatherBusLiteCalibrate(calibrations[k], x) - reference(calibrations[k].kind, x));
+            worst = error > worst ? error : worst;
+        }
+
+        enum { ROUNDS = 200 };
+        volatile float sink = 0;
+        float sum = 0;
+        uint64_t start = hostNanos();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = -2000; i <= 12000; i++) {
+                sum += weatherBusLiteCalibrate(calibrations[k], i * 0.01f);
+            }
+        }
+        double fixedNs = (double)(hostNanos() - start) / (ROUNDS * 14001.0);
+        start = hostNanos();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = -2000; i <= 12000; i++) {
+                sum += floatCalibrate(calibrations[k].kind, i * 0.01f);
+            }
+        }
+        double floatNs = (double)(hostNanos() - start) / (ROUNDS * 14001.0);
+        sink = sum;
+        (void)sink;
+
+        printf("%-10s max error %.1e over -20..120, fixed point %.1f ns/call, float %.1f ns/call\n", names[k], worst,
+               fixedNs, floatNs);
+        hostCheck(worst < 1e-4, "calibration within 1e-4 of the double reference");
+    }
+
+    // End to end: raw 25.000 from the node comes back calibrated
+    HostSensor node("THC", [](char) { return 25.0f; });
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin(9600, calibrations, 3);
+    float t, h, c;
+    bool ok = bus.queryTemp(t) && bus.queryHumidity(h) && bus.queryCanopyTemperature(c);
+    printf("raw 25 through begin(): T %.4f, H %.4f, C %.4f\n", t, h, c);
+    hostCheck(ok && fabs(t - reference(WEATHERBUSLITE_CALIBRATION_LINEAR, 25)) < 1e-4
+                  && fabs(h - reference(WEATHERBUSLITE_CALIBRATION_CUBIC, 25)) < 1e-4
+                  && fabs(c - reference(WEATHERBUSLITE_CALIBRATION_PIECEWISE, 25)) < 1e-4,
+              "queries apply the calibration from begin()");
+    return hostResult();
+}
@@ -0,0 +1,118 @@
+/*
+ * Node clocks disciplined by the master's time sync broadcast.
+ *
+ * 100 nodes with crystals off by up to +-100 ppm and arbitrary millis()
+ * offsets hear WeatherBusLite::broadcastTime() every 5 minutes, each
+ * reading its own clock 0-3 ms late as an interrupt or busy loop would.
+ * After the first hour, every 10 s, each node's WeatherBusLiteClock is
+ * compared with the master's millis(), and so is a clock that only steps
+ * to each sync without compensating the drift. The mean and worst error
+ * of both are printed. Finally a sample taken just before a sync is
+ * stamped, which must not wrap.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteClock.h"
+
+#define NODES 100
+#define SYNC_MS 300000UL
+#define HOURS 3
+
+class ClockNode : public HostNode {
+public:
+    ClockNode() : stepMaster(0), stepLocal(0) {
+        _ppm = (rand() / (double)RAND_MAX * 2.0 - 1.0) * 100.0;
+        _offset = (unsigned long)rand() * 7919UL;
+    }
+
+    void receive(const char *line) {
+        unsigned long now = localMillis((uint64_t)(rand() % 3001));
+        if (clock.handle(line, now)) {
+            stepMaster = strtoul(line + 3, nullptr, 10);
+            stepLocal = now;
+        }
+    }
+
+    /**
+     * This node's millis(), lateUs after the current simulated time.
+     */
+    unsigned long localMillis(uint64_t lateUs = 0) const {
+        return _offset + (unsigned long)(llround((hostMicros() + lateUs) * (1.0 + _ppm * 1e-6)) / 1000);
+    }
+
+    WeatherBusLiteClock clock;
+    unsigned long stepMaster;  // Last sync, for a clock without drift compensation
+    unsigned long stepLocal;
+
+private:
+    double _ppm;
+    unsigned long _offset;
+};
+
+int main() {
+    srand(62);
+    ClockNode *nodes[NODES];
+    for (int i = 0; i < NODES; i++) {
+        nodes[i] = new ClockNode();
+        hostAttach(nodes[i]);
+    }
+    WeatherBusLite bus;
+    bus.begin();
+
+    uint64_t start = hostMicros();
+    uint64_t end = start + HOURS * 3600000000ULL;
+    uint64_t measureFrom = start + 3600000000ULL;
+    uint64_t nextSync = start;
+    double sum = 0, stepSum = 0;
+    long worst = 0, stepWorst = 0;
+    unsigned long samples = 0;
+    for (uint64_t t = start; t < end; t += 10000000ULL) {
+        if (hostMicros() < t) {
+            hostAdvance(t - hostMicros());
+        }
+        if (hostMicros() >= nextSync) {
+            bus.broadcastTime();
+            nextSync += SYNC_MS * 1000ULL;
+        }
+        if (hostMicros() < measureFrom) {
+            continue;
+        }
+        unsigned long master = millis();
+        for (int i = 0; i < NODES; i++) {
+            unsigned long local = nodes[i]->localMillis();
+            long error = labs((long)(nodes[i]->clock.masterTime(local) - master));
+            long stepError = labs((long)(nodes[i]->stepMaster + (local - nodes[i]->stepLocal) - master));
+            sum += error;
+            stepSum += stepError;
+            worst = error > worst ? error : worst;
+            stepWorst = stepError > stepWorst ? stepError : stepWorst;
+            samples++;
+        }
+    }
+
+    printf("drift compensated:     mean error %.1f ms, worst %ld ms\n", sum / samples, worst);
+    printf("stepped at each sync:  mean error %.1f ms, worst %ld ms\n", stepSum / samples, stepWorst);
+    hostCheck(worst <= 6, "compensated clocks within 6 ms of the master");
+    hostCheck(worst < stepWorst / 3, "drift compensation cuts the worst error");
+
+    // A sample taken a second before the sync that follows it
+    ClockNode *node = nodes[0];
+    unsigned long sampled = node->localMillis();
+    unsigned long sampledMaster = millis();
+    hostAdvance(1000000);
+    bus.broadcastTime();
+    long error = (long)(node->clock.masterTime(sampled) - sampledMaster);
+    printf("sample taken 1 s before the latest sync: %ld ms off\n", error);
+    hostCheck(labs(error) <= 6, "samples before the latest sync are stamped correctly");
+
+    hostDetachAll();
+    for (int i = 0; i < NODES; i++) {
+        delete nodes[i];
+    }
+    return hostResult();
+}
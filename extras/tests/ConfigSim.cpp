@@ -0,0 +1,107 @@
+/*
+ * Configuring a fleet over the simulated bus.
+ *
+ * 100 nodes, configured one after another, each get four settings (sample
+ * interval, deadband and two calibration coefficients) through
+ * WeatherBusLiteConfigWriter at 9600 baud. Prints the frames, bytes and
+ * time this takes without loss and with 2% of the frames in either
+ * direction lost, and checks that every node applied the whole batch.
+ * Finally an out-of-range value must be rejected and leave the old value
+ * in place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteConfig.h"
+
+#define NODES 100
+
+class ConfigNode : public HostNode {
+public:
+    ConfigNode(unsigned lossPercent)
+        : interval(60000), deadband(10), gain(1000000), offset(0), config('T', settings, 4),
+          _lossPercent(lossPercent) {
+        WeatherBusLiteSetting defaults[4] = {{'I', &interval, 1000, 3600000},
+                                             {'D', &deadband, 0, 1000},
+                                             {'G', &gain, 500000, 2000000},
+                                             {'O', &offset, -100000, 100000}};
+        for (int i = 0; i < 4; i++) {
+            settings[i] = defaults[i];
+        }
+    }
+
+    void receive(const char *line) {
+        if (lost()) {
+            return;  // Corrupted on the way to the node
+        }
+        HostBuffer reply;
+        if (config.handle(line, reply) && reply.length() > 0 && !lost()) {
+            reply.reply(3000);
+        }
+    }
+
+    int32_t interval, deadband, gain, offset;
+    WeatherBusLiteSetting settings[4];
+    WeatherBusLiteConfig config;
+
+private:
+    bool lost() {
+        return rand() % 100 < (int)_lossPercent;
+    }
+
+    unsigned _lossPercent;
+};
+
+static void run(unsigned lossPercent) {
+    srand(65);
+    WeatherBusLite bus;
+    bus.begin();
+    hostResetCounters();
+    uint64_t start = hostMicros();
+    unsigned applied = 0;
+    for (int i = 0; i < NODES; i++) {
+        hostDetachAll();
+        ConfigNode node(lossPercent);
+        hostAttach(&node);
+        WeatherBusLiteConfigWriter writer(bus, 'T');
+        writer.set('I', 30000 + i);
+        writer.set('D', 5);
+        writer.set('G', 1012345);
+        writer.set('O', -250 - i);
+        bool ok = writer.commit();
+        applied += ok && node.config.changed() && node.interval == 30000 + i && node.deadband == 5
+                   && node.gain == 1012345 && node.offset == -250 - i;
+    }
+    hostDetachAll();
+    const HostCounters &counters = hostCounters();
+    printf("%u%% loss: %lu frames from the master, %.1f kB on the wire, %.1f s, %u/%d nodes applied\n", lossPercent,
+           counters.linesSent, (counters.bytesSent + counters.bytesReceived) / 1000.0, (hostMicros() - start) / 1e6,
+           applied, NODES);
+    hostCheck(applied == NODES, "every node applies its batch");
+}
+
+int main() {
+    run(0);
+    run(2);
+
+    // A value outside the node's range fails the whole batch
+    ConfigNode node(0);
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    WeatherBusLiteConfigWriter writer(bus, 'T');
+    writer.set('D', 20);
+    writer.set('I', 10);
+    bool rejected = !writer.commit();
+    int32_t interval = 0, deadband = 0;
+    bool read = writer.read('I', interval) && writer.read('D', deadband);
+    printf("out of range: commit %s, read back I%ld D%ld\n", rejected ? "rejected" : "applied", (long)interval,
+           (long)deadband);
+    hostCheck(rejected && read && interval == 60000 && deadband == 10,
+              "an out-of-range value is rejected with its batch and the old values stay");
+    hostDetachAll();
+    return hostResult();
+}
@@ -0,0 +1,106 @@
+/*
+ * Echo suppression with a transceiver whose receiver cannot be gated.
+ *
+ * 200 temperature and humidity queries and a 1000 byte block transfer are
+ * run three ways: a gated transceiver without echo, an ungated one that
+ * hears the master's own frames with the master still toggling the
+ * receiver, and the ungated one with setEchoSuppression(true). Prints the
+ * queries answered, whether the transfer arrived and the receiver
+ * toggles. Then a reply that arrives after the master gave up is left in
+ * the receive buffer, and the next query must still succeed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteBlock.h"
+
+#define QUERIES 200
+#define TRANSFER 1000
+
+class EchoNode : public HostNode {
+public:
+    EchoNode() : sink(buffer, sizeof(buffer)), receiver('X', sink, sizeof(buffer)), turnaround(3000) {}
+
+    void receive(const char *line) {
+        HostBuffer reply;
+        if (receiver.handle(line, reply)) {
+            if (reply.length() > 0) {
+                reply.reply(3000);
+            }
+        } else if (line[0] == '?' && (line[1] == 'T' || line[1] == 'H') && line[2] == '\0') {
+            reply.print(line[1]);
+            reply.println(line[1] == 'T' ? ":21.50" : ":64.20");
+            reply.reply(turnaround);
+        }
+    }
+
+    uint8_t buffer[TRANSFER];
+    WeatherBusLiteBufferSink sink;
+    WeatherBusLiteBlockReceiver receiver;
+    uint64_t turnaround;
+};
+
+static void run(const char *name, bool echo, bool suppression, const uint8_t *payload) {
+    hostDetachAll();
+    hostSetEcho(echo);
+    EchoNode node;
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    bus.setEchoSuppression(suppression);
+    hostResetCounters();
+
+    unsigned answered = 0;
+    for (int i = 0; i < QUERIES; i++) {
+        float value;
+        answered += i % 2 == 0 ? bus.queryTemp(value) && value == 21.5f : bus.queryHumidity(value) && value == 64.2f;
+    }
+    WeatherBusLiteBlockSender sender(bus, 'X');
+    bool transferred = sender.send(payload, TRANSFER) && node.receiver.complete()
+                       && memcmp(node.buffer, payload, TRANSFER) == 0;
+    unsigned long toggles = hostCounters().toggles;
+    printf("%-20s %3u/%d answered, transfer %s, %lu receiver toggles\n", name, answered, QUERIES,
+           transferred ? "ok" : "failed", toggles);
+    if (!echo || suppression) {
+        hostCheck(answered == QUERIES && transferred, "every query answered and the transfer arrives");
+    } else {
+        hostCheck(answered == 0, "an unsuppressed echo is taken for the reply");
+    }
+    if (suppression) {
+        hostCheck(toggles == 0, "the receiver is left on with echo suppression");
+    }
+}
+
+int main() {
+    static uint8_t payload[TRANSFER];
+    for (int i = 0; i < TRANSFER; i++) {
+        payload[i] = rand();
+    }
+    run("no echo, gated:", false, false, payload);
+    run("echo, gated:", true, false, payload);
+    run("echo, suppression:", true, true, payload);
+
+    // A reply that comes after the timeout sits in the receive buffer
+    hostDetachAll();
+    hostSetEcho(true);
+    EchoNode node;
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    bus.setEchoSuppression(true);
+    float value;
+    node.turnaround = (WEATHERBUSLITE_RESPONSE_TIMEOUT + 200) * 1000UL;
+    bool late = bus.queryTemp(value);
+    hostAdvance(500000);
+    node.turnaround = 3000;
+    bool next = bus.queryHumidity(value) && value == 64.2f;
+    printf("after a late reply:  query %s\n", next ? "answered" : "failed");
+    hostCheck(!late && next, "a stale reply in the receive buffer is drained before the next query");
+    hostSetEcho(false);
+    hostDetachAll();
+    return hostResult();
+}
@@ -0,0 +1,142 @@
+/*
+ * WeatherBusLiteFilter on a temperature trace with corrupted readings.
+ *
+ * A million readings 10 s apart: 20 C with a +-3 C daily swing and 0.1 C
+ * of noise, and 1% of them corrupted the way a flaky link or node firmware
+ * corrupts them: decimal point lost (21.53 -> 2153), decimal point shifted
+ * (2.153) or leading digit lost (1.53). Runs the Hampel stage alone and
+ * all three stages together, and counts the corrupted readings that got
+ * through and the clean ones that were flagged. Time per apply() is
+ * printed. Then a rain gauge reading a flat 0 mm until rain sets in at one
+ * 0.2 mm tip per minute: no genuine reading may be replaced, while a lost
+ * decimal point during the rain still is.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "WeatherBusLiteFilter.h"
+
+#define READINGS 1000000
+#define READING_MS 10000UL
+
+struct Reading {
+    float value;
+    bool corrupted;
+};
+
+static double normal() {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static std::vector<Reading> trace() {
+    std::vector<Reading> readings(READINGS);
+    srand(58);
+    for (int i = 0; i < READINGS; i++) {
+        double t = i * (READING_MS / 1000.0);
+        float value = (float)(20.0 + 3.0 * sin(t / 86400.0 * 2 * M_PI) + 0.1 * normal());
+        bool corrupted = rand() % 100 == 0;
+        if (corrupted) {
+            switch (rand() % 3) {
+                case 0:
+                    value = roundf(value * 100.0f);  // 21.53 -> 2153
+                    break;
+                case 1:
+                    value /= 10.0f;  // 21.53 -> 2.153
+                    break;
+                default:
+                    value -= 10.0f * floorf(value / 10.0f);  // 21.53 -> 1.53
+                    break;
+            }
+        }
+        readings[i].value = value;
+        readings[i].corrupted = corrupted;
+    }
+    return readings;
+}
+
+static void run(const char *name, WeatherBusLiteFilter &filter, const std::vector<Reading> &readings,
+                unsigned long &missed, unsigned long &falsePositives) {
+    unsigned long corrupted = 0, clean = 0;
+    missed = 0;
+    falsePositives = 0;
+    uint64_t start = hostNanos();
+    for (int i = 0; i < READINGS; i++) {
+        uint16_t rejected = filter.rejected(), replaced = filter.replaced();
+        float value = readings[i].value;
+        filter.apply(value, i * READING_MS);
+        bool flagged = filter.rejected() != rejected || filter.replaced() != replaced;
+        if (readings[i].corrupted) {
+            corrupted++;
+            missed += !flagged;
+        } else {
+            clean++;
+            falsePositives += flagged;
+        }
+    }
+    double ns = (double)(hostNanos() - start) / READINGS;
+    printf("%-12s %lu of %lu corrupted readings missed, %lu of %lu clean readings flagged (%.4f%%), %.1f ns/reading\n",
+           name, missed, corrupted, falsePositives, clean, 100.0 * falsePositives / clean, ns);
+}
+
+int main() {
+    std::vector<Reading> readings = trace();
+    unsigned long missed, falsePositives;
+
+    WeatherBusLiteFilter hampel;
+    hampel.setHampel(9, 3.0f, 0.2f);
+    run("Hampel", hampel, readings, missed, falsePositives);
+    hostCheck(missed == 0, "Hampel flags every corrupted reading");
+    hostCheck(falsePositives < READINGS / 1000, "Hampel flags under 0.1% of clean readings");
+
+    WeatherBusLiteFilter all;
+    all.setRange(-40.0f, 60.0f);
+    all.setRateLimit(0.5f);
+    all.setHampel(9, 3.0f, 0.2f);
+    run("all stages", all, readings, missed, falsePositives);
+    hostCheck(missed == 0, "all stages flag every corrupted reading");
+    hostCheck(falsePositives < READINGS / 1000, "all stages flag under 0.1% of clean readings");
+
+    // A genuine 5 C step is followed after half a window
+    WeatherBusLiteFilter step;
+    step.setHampel(9, 3.0f, 0.2f);
+    int followed = -1;
+    for (int i = 0; i < 20; i++) {
+        float value = i < 10 ? 20.0f + 0.01f * (i % 3) : 25.0f + 0.01f * (i % 3);
+        step.apply(value, i * READING_MS);
+        if (i >= 10 && followed < 0 && fabsf(value - 25.0f) < 0.1f) {
+            followed = i - 10;
+        }
+    }
+    printf("a 5 C step is followed after %d readings\n", followed);
+    hostCheck(followed >= 0 && followed <= 5, "a genuine step is followed within half a window");
+
+    // Rain onset from a zero baseline, in the gauge's units
+    WeatherBusLiteFilter rain;
+    rain.setRange(0.0f, 500.0f);
+    rain.setHampel(9, 3.0f, 0.5f);
+    int replacedGenuine = 0, firstReplaced = -1;
+    bool spikeCaught = false;
+    for (int i = 0; i < 200; i++) {
+        float genuine = i < 100 ? 0.0f : 0.2f * (i - 99);
+        float value = i == 150 ? genuine * 100.0f : genuine;  // 10.2 mm -> 1020
+        uint16_t replaced = rain.replaced(), rejected = rain.rejected();
+        rain.apply(value, i * 60000UL);
+        bool flagged = rain.replaced() != replaced || rain.rejected() != rejected;
+        if (i == 150) {
+            spikeCaught = flagged;
+        } else if (flagged) {
+            replacedGenuine++;
+            firstReplaced = firstReplaced < 0 ? i : firstReplaced;
+        }
+    }
+    printf("rain onset: %d genuine readings replaced (first %.1f mm), lost decimal point %s\n", replacedGenuine,
+           firstReplaced < 0 ? 0.0f : 0.2f * (firstReplaced - 99), spikeCaught ? "caught" : "missed");
+    hostCheck(replacedGenuine == 0, "rain onset from 0 mm is followed");
+    hostCheck(spikeCaught, "a corrupted rain reading is still caught");
+    return hostResult();
+}
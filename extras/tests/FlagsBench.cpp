@@ -0,0 +1,86 @@
+/*
+ * Cost of the ",!<flags>" field.
+ *
+ * Times weatherBusLiteParseReading on "T:23.40" and "T:23.40,!5", and a
+ * whole queryTemp() against a node on the simulated bus answering either
+ * frame, 200k times each. The full query includes the simulated bus, so
+ * only the difference between the two is meaningful. Also prints what the
+ * field costs on the wire at 9600 baud.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteDecoder.h"
+
+#define ITERATIONS 200000
+
+class FlagNode : public HostNode {
+public:
+    FlagNode(const char *reply) : _reply(reply) {}
+
+    void receive(const char *line) {
+        if (line[0] == '?' && line[1] == 'T' && line[2] == '\0') {
+            hostReply(_reply, 3000);
+        }
+    }
+
+private:
+    const char *_reply;
+};
+
+static double parseNs(const char *frame, bool &ok) {
+    volatile float sink = 0;
+    float value;
+    WeatherBusLiteFields fields;
+    ok = true;
+    uint64_t start = hostNanos();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok = weatherBusLiteParseReading(frame, value, fields) && ok;
+        sink = value + fields.flags;
+    }
+    (void)sink;
+    return (double)(hostNanos() - start) / ITERATIONS;
+}
+
+static double queryNs(const char *reply, uint8_t &flags, float &value, uint64_t &busMicros) {
+    hostDetachAll();
+    FlagNode node(reply);
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    bool ok = true;
+    hostResetCounters();
+    uint64_t start = hostNanos();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok = bus.queryTemp(value, flags) && ok;
+    }
+    double ns = (double)(hostNanos() - start) / ITERATIONS;
+    busMicros = hostCounters().busyMicros / ITERATIONS;
+    hostCheck(ok, "every query answered");
+    return ns;
+}
+
+int main() {
+    bool plainOk, flaggedOk;
+    double plainParse = parseNs("T:23.40", plainOk);
+    double flaggedParse = parseNs("T:23.40,!5", flaggedOk);
+    hostCheck(plainOk && flaggedOk, "both frames parse");
+
+    uint8_t plainFlags, flags;
+    float plainValue, value;
+    uint64_t plainBus, flaggedBus;
+    double plainQuery = queryNs("T:23.40\r\n", plainFlags, plainValue, plainBus);
+    double flaggedQuery = queryNs("T:23.40,!5\r\n", flags, value, flaggedBus);
+
+    printf("T:23.40     parse %5.1f ns, query %6.1f ns, bus busy %lu us\n", plainParse, plainQuery,
+           (unsigned long)plainBus);
+    printf("T:23.40,!5  parse %5.1f ns, query %6.1f ns, bus busy %lu us\n", flaggedParse, flaggedQuery,
+           (unsigned long)flaggedBus);
+    hostCheck(plainFlags == 0 && flags == 5, "flags reported through the query overload");
+    hostCheck(fabsf(plainValue - 23.4f) < 1e-4f && fabsf(value - 23.4f) < 1e-4f, "flags leave the value alone");
+    hostCheck(flaggedBus - plainBus < 3500, "the field costs about 3 ms on the wire");
+    return hostResult();
+}
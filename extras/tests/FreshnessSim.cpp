@@ -0,0 +1,145 @@
+/*
+ * Queries saved by sample age and next-sample hints.
+ *
+ * Three nodes sample every 60 s, 60 s and 300 s with staggered phases and
+ * answer with ",~<age>" and ",+<next>". One hour is run three ways: a
+ * naive loop querying every sensor every 10 s, the same loop calling
+ * queryFresh() with a 10 s maximum age, and a loop that queries each
+ * sensor when nextSampleDue() says a new sample is ready. Each value
+ * carries its sample number, so the harness checks that the last two
+ * runs see every sample, and how long after sampling the third delivers
+ * it.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+
+#define LOOP_MS 10000UL
+#define RUN_MS 3600000UL
+
+static uint64_t _runStart;  // hostMicros() when the current run started
+
+// A node that samples on its own schedule and reports the sample number.
+class SamplingNode : public HostNode {
+public:
+    SamplingNode(char type, unsigned long periodMs, unsigned long phaseMs)
+        : type(type), _period(periodMs * 1000ULL), _phase(phaseMs * 1000ULL), answered(0) {}
+
+    void receive(const char *line) {
+        if (line[0] != '?' || line[1] != type || line[2] != '\0') {
+            return;
+        }
+        // Sample 0 was taken before the run started, sample k at phase + (k - 1) * period
+        int64_t now = (int64_t)(hostMicros() - _runStart);
+        int64_t sample = now < _phase ? 0 : (now - _phase) / _period + 1;
+        int64_t sampled = sampleOffset(sample);
+        char reply[48];
+        snprintf(reply, sizeof(reply), "%c:%lu,~%lu,+%lu\r\n", type, (unsigned long)sample,
+                 (unsigned long)((now - sampled) / 1000), (unsigned long)((sampled + _period - now) / 1000));
+        hostReply(reply, 3000);
+        answered++;
+    }
+
+    /**
+     * Time in microseconds from the start of the run when a sample was taken.
+     */
+    int64_t sampleOffset(int64_t sample) const {
+        return _phase + (sample - 1) * _period;
+    }
+
+    char type;
+
+private:
+    int64_t _period;
+    int64_t _phase;
+
+public:
+    unsigned long answered;
+};
+
+enum Mode { NAIVE, FRESH, NEXT_DUE };
+
+struct Run {
+    unsigned long queries;
+    unsigned long missed;    // Samples never seen
+    uint64_t worstDelivery;  // Longest time from sampling to the master, us
+};
+
+static Run simulate(Mode mode) {
+    hostDetachAll();
+    SamplingNode nodes[3] = {SamplingNode('T', 60000, 0), SamplingNode('H', 60000, 20000),
+                             SamplingNode('P', 300000, 45000)};
+    for (int i = 0; i < 3; i++) {
+        hostAttach(&nodes[i]);
+    }
+    WeatherBusLite bus;
+    bus.begin();
+    _runStart = hostMicros();
+    unsigned long start = millis();
+
+    long seen[3] = {-1, -1, -1};  // Highest sample number seen
+    unsigned long missed = 0;
+    uint64_t worstDelivery = 0;
+    unsigned long nextLoop = start;
+    while (millis() - start < RUN_MS) {
+        bool queried = false;
+        for (int i = 0; i < 3; i++) {
+            unsigned long due;
+            if (mode == NEXT_DUE && bus.nextSampleDue(nodes[i].type, due) && (long)(millis() - due) < 0) {
+                continue;
+            }
+            if (mode != NEXT_DUE && (long)(millis() - nextLoop) < 0) {
+                continue;
+            }
+            float value;
+            // queryFresh also gives the sensor the entry that remembers its schedule
+            bool ok = mode == NAIVE ? bus.queryCustom(nodes[i].type, value)
+                                    : bus.queryFresh(nodes[i].type, value, mode == FRESH ? LOOP_MS : 0);
+            queried = true;
+            if (!ok) {
+                continue;
+            }
+            long sample = lroundf(value);
+            if (sample > seen[i]) {
+                missed += seen[i] >= 0 ? sample - seen[i] - 1 : 0;
+                seen[i] = sample;
+                if (sample > 0) {
+                    uint64_t delivery = hostMicros() - _runStart - nodes[i].sampleOffset(sample);
+                    worstDelivery = delivery > worstDelivery ? delivery : worstDelivery;
+                }
+            }
+        }
+        if (mode != NEXT_DUE && (long)(millis() - nextLoop) >= 0) {
+            nextLoop += LOOP_MS;
+        }
+        if (!queried) {
+            hostAdvance(1000);
+        }
+    }
+
+    Run run;
+    run.queries = nodes[0].answered + nodes[1].answered + nodes[2].answered;
+    run.missed = missed;
+    run.worstDelivery = worstDelivery;
+    return run;
+}
+
+int main() {
+    const char *names[] = {"every 10 s", "queryFresh", "nextSampleDue"};
+    Run runs[3];
+    for (int mode = NAIVE; mode <= NEXT_DUE; mode++) {
+        runs[mode] = simulate((Mode)mode);
+        printf("%-14s %5lu queries, %lu samples missed, worst delivery %.0f ms after sampling\n", names[mode],
+               runs[mode].queries, runs[mode].missed, runs[mode].worstDelivery / 1e3);
+    }
+    hostCheck(runs[NAIVE].queries == 1080, "the naive loop queries every sensor every 10 s");
+    hostCheck(runs[FRESH].queries < 150 && runs[FRESH].missed == 0, "queryFresh queries once per new sample");
+    hostCheck(runs[NEXT_DUE].queries < 150 && runs[NEXT_DUE].missed == 0,
+              "polling at nextSampleDue queries once per new sample");
+    hostCheck(runs[NEXT_DUE].worstDelivery <= 50000, "nextSampleDue delivers each sample within 50 ms");
+    return hostResult();
+}
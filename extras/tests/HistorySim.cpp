@@ -0,0 +1,135 @@
+/*
+ * Bulk download of a node's history buffer over the simulated bus.
+ *
+ * A node has buffered one hour of 1 Hz temperature readings while the
+ * master was away. The master calls queryHistory() until it returns no
+ * samples; the harness prints the frames, bytes and bus time this took at
+ * 9600 baud and checks that every sample arrived once, in order, with its
+ * time converted to the master's millis(). The run is repeated with 5% of
+ * the node's replies lost on the wire: samples may then arrive twice, but
+ * none may be lost.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+
+#define SAMPLES 3600
+#define NODE_CLOCK_OFFSET 12345678UL  // The node's millis() runs ahead of the master's
+
+class HistoryNode : public HostNode {
+public:
+    HistoryNode(unsigned lossPercent) : history(buffer, SAMPLES), _lossPercent(lossPercent) {}
+
+    void receive(const char *line) {
+        char type;
+        uint8_t max, acked;
+        if (!WeatherBusLiteHistory::parseRequest(line, type, max, acked)) {
+            return;
+        }
+        HostBuffer reply;
+        history.respond(reply, type, max, acked, nodeMillis());
+        if (rand() % 100 < (int)_lossPercent) {
+            return;  // Corrupted on the wire; the master never sees a frame
+        }
+        reply.reply(3000);
+    }
+
+    static unsigned long nodeMillis() {
+        return millis() + NODE_CLOCK_OFFSET;
+    }
+
+    WeatherBusLiteSample buffer[SAMPLES];
+    WeatherBusLiteHistory history;
+
+private:
+    unsigned _lossPercent;
+};
+
+static float reading(unsigned i) {
+    return 18.0f + (i % 600) * 0.01f;
+}
+
+static void run(unsigned lossPercent) {
+    hostDetachAll();
+    srand(60);
+    HistoryNode *node = new HistoryNode(lossPercent);
+    hostAttach(node);
+
+    // An hour of readings the master missed
+    unsigned long firstSample = millis();
+    for (unsigned i = 0; i < SAMPLES; i++) {
+        node->history.push(reading(i), HistoryNode::nodeMillis());
+        hostAdvance(1000000);
+    }
+
+    WeatherBusLite bus;
+    bus.begin();
+    hostResetCounters();
+    uint64_t start = hostMicros();
+    std::vector<WeatherBusLiteSample> received;
+    unsigned long calls = 0, failures = 0;
+    for (;;) {
+        WeatherBusLiteSample batch[WEATHERBUSLITE_HISTORY_BATCH];
+        uint8_t count;
+        calls++;
+        if (!bus.queryHistory('T', batch, WEATHERBUSLITE_HISTORY_BATCH, count)) {
+            failures++;
+            continue;
+        }
+        if (count == 0) {
+            break;
+        }
+        received.insert(received.end(), batch, batch + count);
+    }
+    const HostCounters &counters = hostCounters();
+
+    // Match every sample by value and time; a resent batch repeats samples
+    std::vector<unsigned> seen(SAMPLES, 0);
+    bool inOrder = true, timesRight = true;
+    long last = -1, minLag = LONG_MAX, maxLag = LONG_MIN;
+    for (size_t i = 0; i < received.size(); i++) {
+        long index = lround((received[i].time - firstSample) / 1000.0);
+        if (index < 0 || index >= SAMPLES || fabsf(received[i].value - reading(index)) > 0.005f) {
+            timesRight = false;
+            continue;
+        }
+        // The node stamps its ages when the query arrives and answers 3 ms later,
+        // and both sides count whole milliseconds
+        long lag = (long)(received[i].time - firstSample) - index * 1000L;
+        minLag = lag < minLag ? lag : minLag;
+        maxLag = lag > maxLag ? lag : maxLag;
+        inOrder = inOrder && index >= last - WEATHERBUSLITE_HISTORY_BATCH;
+        last = index;
+        seen[index]++;
+    }
+    unsigned missing = 0, duplicates = 0;
+    for (unsigned i = 0; i < SAMPLES; i++) {
+        missing += seen[i] == 0;
+        duplicates += seen[i] > 1 ? seen[i] - 1 : 0;
+    }
+
+    printf("%u%% replies lost: %lu requests (%lu failed), %lu bytes on the wire, bus busy %.1f s, %.1f s elapsed; "
+           "%u samples missing, %u duplicated, times %ld to %ld ms late\n",
+           lossPercent, calls, failures, counters.bytesSent + counters.bytesReceived, counters.busyMicros / 1e6,
+           (hostMicros() - start) / 1e6, missing, duplicates, minLag, maxLag);
+    hostCheck(missing == 0, "no sample lost");
+    timesRight = timesRight && minLag >= 0 && maxLag <= 4;
+    hostCheck(timesRight, "times converted to the master's millis() to the node's turnaround");
+    hostCheck(inOrder, "samples arrive oldest first");
+    if (lossPercent == 0) {
+        hostCheck(duplicates == 0 && failures == 0, "a clean bus delivers every sample once");
+    }
+    delete node;
+}
+
+int main() {
+    run(0);
+    run(5);
+    return hostResult();
+}
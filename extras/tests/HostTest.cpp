@@ -0,0 +1,351 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "HostTest.h"
+
+#include <ArduinoRS485.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// microseconds the master spends on one poll of an empty receiver
+#define HOST_POLL_COST 10
+
+struct HostByte {
+    uint8_t value;
+    uint64_t arrival;
+};
+
+static unsigned _checks = 0;
+static unsigned _failures = 0;
+
+static uint64_t _now = 0;
+static unsigned long _baudRate = 9600;
+static std::vector<HostNode *> _nodes;
+static std::vector<HostByte> _inFlight;  // Towards the master, by arrival
+static std::vector<uint8_t> _received;   // In the master's receive buffer
+static bool _receiving = false;
+static bool _echo = false;
+static uint64_t _lineFree = 0;  // When the last queued byte has arrived
+static std::string _sending;
+static HostCounters _counters;
+
+RS485Class RS485;
+
+/**
+ * Time one byte takes on the wire, 8N1.
+ */
+static uint64_t byteTime() {
+    return (10000000ULL + _baudRate / 2) / _baudRate;
+}
+
+/**
+ * Queue a byte towards the master, keeping arrival order.
+ */
+static void queueByte(uint8_t value, uint64_t arrival) {
+    size_t i = _inFlight.size();
+    while (i > 0 && _inFlight[i - 1].arrival > arrival) {
+        i--;
+    }
+    HostByte byte = {value, arrival};
+    _inFlight.insert(_inFlight.begin() + i, byte);
+}
+
+/**
+ * Move bytes that have arrived into the receive buffer if the receiver is
+ * on or ungated; bytes that arrive while it is off are lost.
+ */
+static void settle() {
+    size_t arrived = 0;
+    while (arrived < _inFlight.size() && _inFlight[arrived].arrival <= _now) {
+        if (_receiving || _echo) {
+            _received.push_back(_inFlight[arrived].value);
+        }
+        arrived++;
+    }
+    _inFlight.erase(_inFlight.begin(), _inFlight.begin() + arrived);
+}
+
+void hostCheck(bool ok, const char *what) {
+    _checks++;
+    if (!ok) {
+        _failures++;
+        printf("FAILED: %s\n", what);
+    }
+}
+
+int hostResult() {
+    printf("%u checks, %u failed\n", _checks, _failures);
+    return _failures == 0 ? 0 : 1;
+}
+
+uint64_t hostNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint64_t hostMicros() {
+    return _now;
+}
+
+void hostAdvance(uint64_t us) {
+    _now += us;
+}
+
+void hostAttach(HostNode *node) {
+    _nodes.push_back(node);
+}
+
+void hostDetachAll() {
+    _nodes.clear();
+    _inFlight.clear();
+    _received.clear();
+    _sending.clear();
+}
+
+void hostReply(const char *bytes, size_t length, uint64_t delayUs) {
+    uint64_t start = _now + delayUs > _lineFree ? _now + delayUs : _lineFree;
+    for (size_t i = 0; i < length; i++) {
+        queueByte(bytes[i], start + (i + 1) * byteTime());
+    }
+    _lineFree = start + length * byteTime();
+    _counters.busyMicros += length * byteTime();
+}
+
+void hostReply(const char *text, uint64_t delayUs) {
+    hostReply(text, strlen(text), delayUs);
+}
+
+void hostSetEcho(bool echo) {
+    _echo = echo;
+}
+
+const HostCounters &hostCounters() {
+    return _counters;
+}
+
+void hostResetCounters() {
+    memset(&_counters, 0, sizeof(_counters));
+}
+
+HostBuffer::HostBuffer() : _length(0) {}
+
+size_t HostBuffer::write(uint8_t c) {
+    if (_length + 1 >= sizeof(_text)) {
+        return 0;
+    }
+    _text[_length++] = c;
+    _text[_length] = '\0';
+    return 1;
+}
+
+const char *HostBuffer::text() const {
+    return _length > 0 ? _text : "";
+}
+
+size_t HostBuffer::length() const {
+    return _length;
+}
+
+void HostBuffer::clear() {
+    _length = 0;
+}
+
+void HostBuffer::reply(uint64_t delayUs) {
+    hostReply(_text, _length, delayUs);
+    _length = 0;
+}
+
+HostSensor::HostSensor(const char *types, std::function<float(char type)> reading, uint64_t turnaroundUs)
+    : _types(types), _reading(reading), _turnaround(turnaroundUs), _silent(false), _answered(0) {}
+
+void HostSensor::receive(const char *line) {
+    if (_silent || line[0] != '?' || line[1] == '\0' || line[2] != '\0' || _types.find(line[1]) == std::string::npos) {
+        return;
+    }
+    char reply[32];
+    snprintf(reply, sizeof(reply), "%c:%.3f\r\n", line[1], _reading(line[1]));
+    hostReply(reply, _turnaround);
+    _answered++;
+}
+
+void HostSensor::setSilent(bool silent) {
+    _silent = silent;
+}
+
+unsigned long HostSensor::answered() const {
+    return _answered;
+}
+
+// Arduino core
+
+unsigned long millis() {
+    return (unsigned long)(_now / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)_now;
+}
+
+void delay(unsigned long ms) {
+    _now += ms * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int us) {
+    _now += us;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (size--) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::write(const char *text) {
+    return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+}
+
+size_t Print::print(const char *text) {
+    return write(text);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base != DEC) {
+        return print((unsigned long)value, base);
+    }
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::println(const char *text) {
+    return print(text) + println();
+}
+
+// RS485 on the simulated bus
+
+void RS485Class::begin(unsigned long baudRate) {
+    _baudRate = baudRate;
+}
+
+void RS485Class::end() {}
+
+int RS485Class::available() {
+    settle();
+    if (_received.empty()) {
+        _now += HOST_POLL_COST;
+    }
+    return _received.size();
+}
+
+int RS485Class::read() {
+    settle();
+    if (_received.empty()) {
+        return -1;
+    }
+    uint8_t value = _received.front();
+    _received.erase(_received.begin());
+    _counters.bytesReceived++;
+    return value;
+}
+
+int RS485Class::peek() {
+    settle();
+    return _received.empty() ? -1 : _received.front();
+}
+
+size_t RS485Class::write(uint8_t c) {
+    uint64_t start = _now > _lineFree ? _now : _lineFree;  // Wait for the bus
+    _now = start + byteTime();
+    _lineFree = _now;
+    if (_echo) {
+        queueByte(c, _now);
+    }
+    _sending += (char)c;
+    _counters.bytesSent++;
+    _counters.busyMicros += byteTime();
+    return 1;
+}
+
+void RS485Class::flush() {}
+
+void RS485Class::beginTransmission() {}
+
+void RS485Class::endTransmission() {
+    size_t end;
+    while ((end = _sending.find('\n')) != std::string::npos) {
+        std::string line = _sending.substr(0, end);
+        _sending.erase(0, end + 1);
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        _counters.linesSent++;
+        std::vector<HostNode *> nodes = _nodes;  // A node may detach others
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i]->receive(line.c_str());
+        }
+    }
+}
+
+void RS485Class::receive() {
+    settle();  // Bytes that arrived while the receiver was off are lost
+    _receiving = true;
+    _counters.toggles++;
+}
+
+void RS485Class::noReceive() {
+    settle();
+    _receiving = false;
+    _counters.toggles++;
+}
@@ -0,0 +1,95 @@
+#ifndef WEATHERBUSLITE_HOST_TEST_H
+#define WEATHERBUSLITE_HOST_TEST_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+// Support for the host tests: checks, simulated time and a simulated
+// RS485 bus that the library's RS485 calls talk to.
+
+// Record a check; failures are printed and make hostResult() fail.
+void hostCheck(bool ok, const char *what);
+
+// Exit status for main(): 0 if every check passed.
+int hostResult();
+
+// Real monotonic time in nanoseconds, for benchmarks.
+uint64_t hostNanos();
+
+// Simulated time in microseconds. millis(), micros() and delay() use it;
+// it also advances while the master polls an empty receiver.
+uint64_t hostMicros();
+void hostAdvance(uint64_t us);
+
+// A node on the simulated bus. Every line the master sends, without its
+// CRLF, goes to every attached node once the master has sent it.
+class HostNode {
+public:
+    virtual ~HostNode() {}
+    virtual void receive(const char *line) = 0;
+};
+
+void hostAttach(HostNode *node);
+void hostDetachAll();
+
+// A sensor node answering "?<type>" for the given types with "<type>:<value>"
+// after a turnaround delay. The reading function gets the type and returns
+// the value at the current simulated time.
+class HostSensor : public HostNode {
+public:
+    HostSensor(const char *types, std::function<float(char type)> reading, uint64_t turnaroundUs = 3000);
+    void receive(const char *line);
+    // Stop answering, e.g. to simulate a dead node.
+    void setSilent(bool silent);
+    // Queries answered since construction.
+    unsigned long answered() const;
+
+private:
+    std::string _types;
+    std::function<float(char type)> _reading;
+    uint64_t _turnaround;
+    bool _silent;
+    unsigned long _answered;
+};
+
+// Put bytes on the bus towards the master, starting delayUs from now or
+// after the bytes already queued, paced at the baud rate.
+void hostReply(const char *bytes, size_t length, uint64_t delayUs);
+void hostReply(const char *text, uint64_t delayUs = 0);
+
+// Ungated transceiver: the receiver stays enabled whatever receive() and
+// noReceive() say, and hears the master's own bytes.
+void hostSetEcho(bool echo);
+
+// Bus counters since the last hostResetCounters().
+struct HostCounters {
+    unsigned long linesSent;      // Lines from the master
+    unsigned long bytesSent;      // Bytes from the master
+    unsigned long bytesReceived;  // Bytes the master read
+    uint64_t busyMicros;          // Time either side was transmitting
+    unsigned long toggles;        // receive() and noReceive() calls
+};
+const HostCounters &hostCounters();
+void hostResetCounters();
+
+// Print that collects a node's reply, e.g. for WeatherBusLiteHistory::respond.
+class HostBuffer : public Print {
+public:
+    HostBuffer();
+    size_t write(uint8_t c);
+    using Print::write;
+    const char *text() const;
+    size_t length() const;
+    void clear();
+    // Send the collected bytes to the master and clear them.
+    void reply(uint64_t delayUs = 0);
+
+private:
+    char _text[4096];
+    size_t _length;
+};
+
+#endif
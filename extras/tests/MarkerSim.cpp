@@ -0,0 +1,87 @@
+/*
+ * Start-of-frame marker against line noise and stale partial replies.
+ *
+ * 2000 temperature queries to a node whose every reply is preceded by
+ * either 1-12 bytes of line noise drawn from "T:0-9.,\n\r THPx?" or a
+ * stale partial reply "T:1". The caller retries a failed read. Run once
+ * with plain replies, where only the type letter starts a frame, and once
+ * with the node printing through WeatherBusLiteFramedPrint and the master
+ * requiring the STX marker. Prints the replies read correctly first time,
+ * the ones silently read wrong, and the failed reads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteFrame.h"
+
+#define QUERIES 2000
+
+static const char NOISE[] = "T:0123456789.,\n\r THPx?";
+
+class NoisyNode : public HostNode {
+public:
+    NoisyNode(bool framed) : _framed(framed) {}
+
+    void receive(const char *line) {
+        if (line[0] != '?' || line[1] != 'T' || line[2] != '\0') {
+            return;
+        }
+        HostBuffer reply;
+        if (rand() % 2 == 0) {
+            for (int i = rand() % 12; i >= 0; i--) {
+                reply.write(NOISE[rand() % (sizeof(NOISE) - 1)]);
+            }
+        } else {
+            reply.print("T:1");  // What is left of an earlier reply
+        }
+        if (_framed) {
+            WeatherBusLiteFramedPrint framed(reply);
+            framed.println("T:21.50");
+        } else {
+            reply.println("T:21.50");
+        }
+        reply.reply(3000);
+    }
+
+private:
+    bool _framed;
+};
+
+static void run(const char *name, bool framed, unsigned &correct, unsigned &wrong, unsigned &failed) {
+    hostDetachAll();
+    srand(68);
+    NoisyNode node(framed);
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    if (framed) {
+        bus.setFrameStart(WEATHERBUSLITE_FRAME_START);
+    }
+    correct = wrong = failed = 0;
+    for (int i = 0; i < QUERIES; i++) {
+        float value;
+        bool first = true;
+        while (!bus.queryTemp(value)) {
+            failed++;
+            first = false;
+        }
+        if (value != 21.5f) {
+            wrong++;
+        } else if (first) {
+            correct++;
+        }
+    }
+    printf("%-18s %4u correct first time, %4u silently wrong, %3u failed reads\n", name, correct, wrong, failed);
+}
+
+int main() {
+    unsigned correct, wrong, failed;
+    run("type letter only:", false, correct, wrong, failed);
+    hostCheck(wrong > 0, "noise is taken for replies without a marker");
+    run("STX framing:", true, correct, wrong, failed);
+    hostCheck(correct == QUERIES && wrong == 0 && failed == 0, "the marker resynchronises within the reply");
+    return hostResult();
+}
@@ -0,0 +1,89 @@
+/*
+ * Polls saved by WeatherBusLitePredictor on a day of pressure.
+ *
+ * A node on the simulated bus reports a synthetic day-long pressure trace
+ * (a front passing through plus the semidiurnal tide and sensor noise).
+ * The master ticks every 10 s and calls WeatherBusLitePredictor::poll with
+ * a 0.3 hPa tolerance, which queries the node only when the prediction has
+ * become too uncertain. Prints how many ticks went to the bus, the bus
+ * time used against polling every tick, and the RMS and worst error of
+ * the values the master saw against the true trace.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLitePredictor.h"
+
+#define TICK_MS 10000UL
+#define TICKS 8640  // One day
+
+/**
+ * True pressure at a time: 1012 hPa, a 9 hPa drop and recovery as a front
+ * passes around noon, and the +-0.8 hPa semidiurnal tide.
+ */
+static double pressure(double seconds) {
+    double hours = seconds / 3600.0;
+    double front = -9.0 / (1.0 + exp(-(hours - 10.0) * 1.2)) + 9.0 / (1.0 + exp(-(hours - 16.0) * 0.8));
+    return 1012.0 + front + 0.8 * sin(hours / 12.0 * 2.0 * M_PI);
+}
+
+static double noise() {
+    return 0.05 * ((double)rand() / RAND_MAX * 2.0 - 1.0) * sqrt(3.0);  // 0.05 hPa RMS
+}
+
+/**
+ * Run a day and return the RMS error of what the master saw.
+ */
+static double run(bool predict, unsigned long &queries, uint64_t &busMicros, double &worst, bool &allOk) {
+    hostDetachAll();
+    HostSensor node("P", [](char) { return (float)(pressure(hostMicros() / 1e6) + noise()); });
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    WeatherBusLitePredictor predictor(0.3f, 1e-9f, 0.0025f);
+    hostResetCounters();
+
+    double squares = 0;
+    worst = 0;
+    allOk = true;
+    uint64_t start = hostMicros();
+    for (unsigned long tick = 0; tick < TICKS; tick++) {
+        uint64_t due = start + (uint64_t)tick * TICK_MS * 1000;
+        if (hostMicros() < due) {
+            hostAdvance(due - hostMicros());
+        }
+        float value;
+        bool ok = predict ? predictor.poll(bus, 'P', value, millis()) : bus.queryPressure(value);
+        allOk = allOk && ok;
+        double error = value - pressure(hostMicros() / 1e6);
+        squares += error * error;
+        worst = fabs(error) > worst ? fabs(error) : worst;
+    }
+    queries = node.answered();
+    busMicros = hostCounters().busyMicros;
+    return sqrt(squares / TICKS);
+}
+
+int main() {
+    srand(56);
+    unsigned long everyTick, predicted;
+    uint64_t everyTickBus, predictedBus;
+    double everyTickWorst, predictedWorst;
+    bool everyTickOk, predictedOk;
+    double everyTickRms = run(false, everyTick, everyTickBus, everyTickWorst, everyTickOk);
+    double predictedRms = run(true, predicted, predictedBus, predictedWorst, predictedOk);
+
+    printf("every tick: %5lu queries, bus busy %6.1f s, RMS error %.3f hPa, worst %.3f hPa\n", everyTick,
+           everyTickBus / 1e6, everyTickRms, everyTickWorst);
+    printf("predictor:  %5lu queries, bus busy %6.1f s, RMS error %.3f hPa, worst %.3f hPa\n", predicted,
+           predictedBus / 1e6, predictedRms, predictedWorst);
+    hostCheck(everyTickOk && predictedOk, "a value on every tick");
+    hostCheck(everyTick == TICKS, "polling every tick queries every tick");
+    hostCheck(predicted < TICKS / 10, "predictor skips at least 90% of the polls");
+    hostCheck(predictedRms < 0.3, "predictor RMS error within the tolerance");
+    return hostResult();
+}
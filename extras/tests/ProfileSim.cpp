@@ -0,0 +1,150 @@
+/*
+ * Mixed fleet of legacy and checksumming nodes.
+ *
+ * Ten nodes, five still on legacy firmware, answer at 9600 baud; 5% of
+ * the replies have one digit corrupted on the wire. 1000 sweeps over all
+ * ten are run with every node on the legacy profile, then again after
+ * upgradeProfile() has probed each node. Prints the wire time per sweep,
+ * the wrong values accepted and the corrupted replies rejected by the
+ * checksum.
+ *
+ * The upgrade targets the checksummed profile rather than the cheaper
+ * marked one, which only adds a start marker, because only the CRC turns
+ * the corrupted replies into rejections. The price shows in the wire
+ * time: each upgraded node's exchange grows by two markers and up to 5
+ * CRC characters, about half again, so the migrated sweep is slower than
+ * the legacy one.
+ * A node whose probe fails keeps its previous setting, so a node left on
+ * the default profile still follows setFrameStart afterwards.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteFrame.h"
+
+#define NODES 10
+#define SWEEPS 1000
+
+static const char TYPES[] = "ABCDEFGHIJ";
+
+static float truth(int node) {
+    return 10.25f + node;
+}
+
+class ProfileNode : public HostNode {
+public:
+    ProfileNode(int index, bool checksums) : _index(index), _checksums(checksums) {}
+
+    void receive(const char *line) {
+        // New firmware also answers queries that start with the marker
+        bool marked = _checksums && line[0] == WEATHERBUSLITE_FRAME_START;
+        const char *query = marked ? line + 1 : line;
+        if (query[0] != '?' || query[1] != TYPES[_index] || query[2] != '\0') {
+            return;
+        }
+        HostBuffer buffer;
+        WeatherBusLiteFramedPrint framed(buffer, WEATHERBUSLITE_FRAME_START, true);
+        Print &out = marked ? (Print &)framed : (Print &)buffer;
+        out.print(TYPES[_index]);
+        out.print(':');
+        out.print(truth(_index), 2);
+        out.println();
+
+        std::string reply(buffer.text(), buffer.length());
+        if (rand() % 100 < 5) {
+            size_t digit;
+            do {
+                digit = reply.find(':') + 1 + rand() % 5;
+            } while (reply[digit] < '0' || reply[digit] > '9');
+            reply[digit] = '0' + (reply[digit] - '0' + 1 + rand() % 9) % 10;
+        }
+        hostReply(reply.data(), reply.size(), 3000);
+    }
+
+private:
+    int _index;
+    bool _checksums;
+};
+
+struct Run {
+    unsigned long wrong;     // Corrupted values accepted
+    unsigned long wrongNew;  // Of those, from new firmware nodes
+    unsigned long rejected;  // Queries that failed
+    double wireMs;           // Per sweep
+};
+
+static Run sweep(WeatherBusLite &bus) {
+    Run run = {0, 0, 0, 0};
+    hostResetCounters();
+    for (int s = 0; s < SWEEPS; s++) {
+        for (int i = 0; i < NODES; i++) {
+            float value;
+            if (!bus.queryCustom(TYPES[i], value)) {
+                run.rejected++;
+            } else if (value != truth(i)) {
+                run.wrong++;
+                run.wrongNew += i % 2 == 1;
+            }
+        }
+    }
+    run.wireMs = hostCounters().busyMicros / 1e3 / SWEEPS;
+    return run;
+}
+
+int main() {
+    srand(69);
+    ProfileNode *nodes[NODES];
+    for (int i = 0; i < NODES; i++) {
+        nodes[i] = new ProfileNode(i, i % 2 == 1);
+        hostAttach(nodes[i]);
+    }
+    WeatherBusLite bus;
+    bus.begin();
+    for (int i = 1; i < NODES; i++) {
+        bus.setProfile(TYPES[i], WEATHERBUSLITE_PROFILE_LEGACY);
+    }
+    bus.setProfile(TYPES[0], WEATHERBUSLITE_PROFILE_DEFAULT);  // Legacy through setFrameStart(0)
+    bus.setFrameStart(0);
+    Run legacy = sweep(bus);
+    printf("all legacy: %.0f ms wire per sweep, %lu/%d wrong values accepted, %lu rejected\n", legacy.wireMs,
+           legacy.wrong, SWEEPS * NODES, legacy.rejected);
+
+    int upgraded = 0;
+    uint64_t start = hostMicros();
+    for (int i = 0; i < NODES; i++) {
+        upgraded += bus.upgradeProfile(TYPES[i]);
+    }
+    double probeSeconds = (hostMicros() - start) / 1e6;
+    bool profilesRight = true;
+    for (int i = 0; i < NODES; i++) {
+        uint8_t expected = i % 2 == 1 ? WEATHERBUSLITE_PROFILE_CHECKSUMMED : WEATHERBUSLITE_PROFILE_LEGACY;
+        profilesRight = profilesRight && bus.profile(TYPES[i]) == expected;
+    }
+    bus.setFrameStart(WEATHERBUSLITE_FRAME_START);
+    bool followsDefault = bus.profile(TYPES[0]) == WEATHERBUSLITE_PROFILE_MARKED;
+    bus.setFrameStart(0);
+    followsDefault = followsDefault && bus.profile(TYPES[0]) == WEATHERBUSLITE_PROFILE_LEGACY;
+    Run migrated = sweep(bus);
+    printf("migrated:   %d/%d upgraded in %.1f s, %.0f ms wire per sweep, %lu/%d wrong values accepted "
+           "(%lu from upgraded nodes), %lu rejected\n",
+           upgraded, NODES, probeSeconds, migrated.wireMs, migrated.wrong, SWEEPS * NODES, migrated.wrongNew,
+           migrated.rejected);
+    // Half the nodes were upgraded
+    printf("checksums cost %.0f%% more wire time per exchange with an upgraded node\n",
+           (migrated.wireMs - legacy.wireMs) / (legacy.wireMs / 2) * 100);
+
+    hostCheck(upgraded == NODES / 2 && profilesRight, "only the new firmware nodes are upgraded");
+    hostCheck(followsDefault, "a failed probe keeps a node on the default profile");
+    hostCheck(migrated.wrongNew == 0, "checksums reject the corrupted replies of upgraded nodes");
+    hostCheck(migrated.rejected > 0, "corrupted checksummed replies are rejected");
+
+    hostDetachAll();
+    for (int i = 0; i < NODES; i++) {
+        delete nodes[i];
+    }
+    return hostResult();
+}
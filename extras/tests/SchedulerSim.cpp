@@ -0,0 +1,147 @@
+/*
+ * WeatherBusLiteScheduler on bursty traces.
+ *
+ * Three nodes on the simulated bus: wind that turns gusty for two spells,
+ * rain that is zero apart from one storm, and a slowly drifting
+ * temperature. Six hours are run twice: once with the adaptive scheduler
+ * and once polling every sensor at a fixed interval chosen to spend the
+ * same number of queries. Each second the last reading the master holds
+ * is compared with the true value; the RMS errors of both runs are
+ * printed per sensor. A third run with a tight bus cap checks that the
+ * time spent in queries stays under it.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteScheduler.h"
+
+#define HOURS 6
+#define LOOP_MS 50  // Main loop period when nothing is due
+
+static const char TYPES[] = "WRT";
+static uint64_t _runStart;  // hostMicros() when the current run started
+
+/**
+ * True value of a sensor at a time in seconds.
+ */
+static double truth(char type, double t) {
+    double hours = t / 3600.0;
+    switch (type) {
+        case 'W': {
+            bool gusty = (hours >= 1.0 && hours < 2.0) || (hours >= 4.0 && hours < 4.5);
+            return 3.0 + 0.2 * sin(t / 600.0) + (gusty ? 2.5 * sin(t / 9.0) + 1.5 * sin(t / 3.7) : 0.0);
+        }
+        case 'R': {
+            if (hours < 2.5 || hours >= 3.0) {
+                return 0.0;
+            }
+            double storm = sin((hours - 2.5) / 0.5 * M_PI);
+            return 40.0 * storm * storm * (1.0 + 0.3 * sin(t / 20.0));
+        }
+        default:
+            return 15.0 + 3.0 * sin(hours / 24.0 * 2.0 * M_PI);
+    }
+}
+
+struct Run {
+    unsigned long queries;
+    double rms[3];
+    double busShare;  // Share of the time spent in queries
+};
+
+/**
+ * Run six hours. fixedInterval 0 uses the scheduler, otherwise every
+ * sensor is polled round robin with that period per sensor.
+ */
+static Run simulate(unsigned long fixedInterval, float busCap) {
+    hostDetachAll();
+    HostSensor node(TYPES, [](char type) { return (float)truth(type, (hostMicros() - _runStart) / 1e6); });
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+    WeatherBusLiteScheduler scheduler(bus, busCap);
+    scheduler.add('W', 1000, 60000, 0.5f);
+    scheduler.add('R', 2000, 120000, 0.2f);
+    scheduler.add('T', 10000, 300000, 0.001f);
+    hostResetCounters();
+
+    double held[3] = {0, 0, 0};
+    double squares[3] = {0, 0, 0};
+    unsigned long samples = 0;
+    uint64_t start = _runStart = hostMicros();
+    unsigned long nextPoll[3] = {millis(), millis(), millis()};
+    uint64_t queryMicros = 0;
+    uint64_t nextSample = start + 1000000;  // Every sensor has been read once by then
+    uint64_t end = start + HOURS * 3600000000ULL;
+
+    while (hostMicros() < end) {
+        bool polled = false;
+        uint64_t before = hostMicros();
+        if (fixedInterval == 0) {
+            char type;
+            float value;
+            polled = scheduler.run(millis(), type, value);
+            if (polled) {
+                held[strchr(TYPES, type) - TYPES] = value;
+            }
+        } else {
+            for (int i = 0; i < 3 && !polled; i++) {
+                if (millis() >= nextPoll[i]) {
+                    float value;
+                    if (bus.queryCustom(TYPES[i], value)) {
+                        held[i] = value;
+                    }
+                    nextPoll[i] += fixedInterval;
+                    polled = true;
+                }
+            }
+        }
+        if (polled) {
+            queryMicros += hostMicros() - before;
+        } else {
+            hostAdvance(LOOP_MS * 1000);
+        }
+        while (nextSample <= hostMicros() && nextSample < end) {
+            for (int i = 0; i < 3; i++) {
+                double error = held[i] - truth(TYPES[i], (nextSample - start) / 1e6);
+                squares[i] += error * error;
+            }
+            samples++;
+            nextSample += 1000000;
+        }
+    }
+
+    Run run;
+    run.queries = node.answered();
+    for (int i = 0; i < 3; i++) {
+        run.rms[i] = sqrt(squares[i] / samples);
+    }
+    run.busShare = queryMicros / (HOURS * 3600e6);
+    return run;
+}
+
+int main() {
+    Run adaptive = simulate(0, 0.5f);
+    unsigned long fixedInterval = HOURS * 3600000UL * 3 / adaptive.queries;
+    Run fixed = simulate(fixedInterval, 0.5f);
+
+    printf("adaptive:  %6lu queries, RMS error wind %.3f m/s, rain %.3f mm/h, temperature %.4f C\n", adaptive.queries,
+           adaptive.rms[0], adaptive.rms[1], adaptive.rms[2]);
+    printf("fixed:     %6lu queries, RMS error wind %.3f m/s, rain %.3f mm/h, temperature %.4f C "
+           "(every sensor every %lu ms)\n",
+           fixed.queries, fixed.rms[0], fixed.rms[1], fixed.rms[2], fixedInterval);
+    hostCheck(fixed.queries <= adaptive.queries + 3, "both runs spend the same queries");
+    hostCheck(adaptive.rms[0] < fixed.rms[0] && adaptive.rms[1] < fixed.rms[1],
+              "adaptive polling tracks the bursty sensors better");
+
+    // A cap well under what the sensors would like
+    Run capped = simulate(0, 0.001f);
+    printf("cap 50%%:   %.2f%% of the time in queries\n", adaptive.busShare * 100);
+    printf("cap 0.1%%:   %6lu queries, %.2f%% of the time in queries\n", capped.queries, capped.busShare * 100);
+    hostCheck(capped.busShare <= 0.001 * 1.05, "query time stays under the cap");
+    return hostResult();
+}
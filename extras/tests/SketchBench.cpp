@@ -0,0 +1,129 @@
+/*
+ * WeatherBusLiteSketch accuracy, merging and speed.
+ *
+ * Adds 100k values from three distributions (log-normal query latencies,
+ * temperatures around zero and a bimodal wind speed) and compares p50,
+ * p95 and p99 with the exact quantiles of the sorted values; the error
+ * must stay within the configured relative accuracy. The same values are
+ * then split over ten sketches, sent through serialize()/deserialize()
+ * and merged, which must give the same answers, and a gateway-sized merge
+ * checks that bins hold more than 65535 values. Time per add() is printed.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "WeatherBusLiteSketch.h"
+
+#define VALUES 100000
+
+static double uniform() {
+    return (rand() + 1.0) / (RAND_MAX + 2.0);
+}
+
+static double normal() {
+    return sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+}
+
+/**
+ * Same rank as WeatherBusLiteSketch::quantile, from the sorted values.
+ */
+static float exactQuantile(const std::vector<float> &sorted, float q) {
+    return sorted[(uint32_t)(q * (sorted.size() - 1))];
+}
+
+static double error(float estimate, float exact) {
+    return fabs(estimate - exact) / fabs(exact);
+}
+
+int main() {
+    srand(55);
+    struct {
+        const char *name;
+        std::vector<float> values;
+    } cases[3] = {{"latency ms"}, {"temperature C"}, {"wind m/s"}};
+    for (int i = 0; i < VALUES; i++) {
+        cases[0].values.push_back((float)exp(log(40.0) + 0.6 * normal()));
+        cases[1].values.push_back((float)(2.0 + 6.0 * normal()));
+        cases[2].values.push_back((float)(uniform() < 0.7 ? 2.0 + 0.8 * normal() : 9.0 + 2.0 * normal()));
+    }
+
+    const float quantiles[] = {0.5f, 0.95f, 0.99f};
+    double worst = 0;
+    uint64_t addNanos = 0;
+    for (auto &c : cases) {
+        WeatherBusLiteSketch sketch;
+        uint64_t start = hostNanos();
+        for (float v : c.values) {
+            sketch.add(v);
+        }
+        addNanos += hostNanos() - start;
+
+        std::vector<float> sorted = c.values;
+        std::sort(sorted.begin(), sorted.end());
+        printf("%-14s", c.name);
+        for (float q : quantiles) {
+            float estimate;
+            sketch.quantile(q, estimate);
+            float exact = exactQuantile(sorted, q);
+            double e = fabs(exact) < WEATHERBUSLITE_SKETCH_MIN_VALUE ? 0 : error(estimate, exact);
+            worst = e > worst ? e : worst;
+            printf("  p%-2.0f %8.3f (exact %8.3f, %.2f%%)", q * 100, estimate, exact, e * 100);
+        }
+        printf("\n");
+        hostCheck(sketch.count() == VALUES, "every value counted");
+
+        // Split over ten stations, shipped to a gateway and merged
+        WeatherBusLiteSketch gateway;
+        for (int s = 0; s < 10; s++) {
+            WeatherBusLiteSketch station;
+            for (int i = s; i < VALUES; i += 10) {
+                station.add(c.values[i]);
+            }
+            uint8_t buffer[1024];
+            size_t size = station.serialize(buffer, sizeof(buffer));
+            WeatherBusLiteSketch received;
+            hostCheck(size > 0 && received.deserialize(buffer, size), "sketch round trips");
+            gateway.merge(received);
+        }
+        bool same = gateway.count() == sketch.count();
+        for (float q : quantiles) {
+            float a, b;
+            same = same && gateway.quantile(q, a) && sketch.quantile(q, b) && a == b;
+        }
+        hostCheck(same, "merged sketches answer like one sketch");
+    }
+    printf("max relative error %.2f%% (bound %.0f%%), %.1f ns per add\n", worst * 100,
+           WEATHERBUSLITE_SKETCH_ACCURACY * 100, (double)addNanos / (3.0 * VALUES));
+    hostCheck(worst <= WEATHERBUSLITE_SKETCH_ACCURACY, "quantiles within the relative accuracy");
+
+    // A gateway merging a day of 1 Hz readings from 10 stations: most of
+    // them fall into a few bins
+    WeatherBusLiteSketch day;
+    for (int i = 0; i < 86400; i++) {
+        day.add(20.0f + (i % 3) * 0.01f);
+    }
+    uint8_t buffer[1024];
+    size_t size = day.serialize(buffer, sizeof(buffer));
+    WeatherBusLiteSketch gateway;
+    for (int s = 0; s < 10; s++) {
+        WeatherBusLiteSketch received;
+        received.deserialize(buffer, size);
+        gateway.merge(received);
+    }
+    gateway.add(100.0f);
+    float p99, max;
+    gateway.quantile(0.99f, p99);
+    gateway.quantile(1.0f, max);
+    printf("10 stations x 86400 readings: %u values, p99 %.2f, max %.2f, %zu bytes serialized per station\n",
+           gateway.count(), p99, max, size);
+    hostCheck(gateway.count() == 864001 && error(p99, 20.0f) <= WEATHERBUSLITE_SKETCH_ACCURACY
+                  && error(max, 100.0f) <= WEATHERBUSLITE_SKETCH_ACCURACY,
+              "bins count past 65535");
+    printf("state: %zu bytes\n", sizeof(WeatherBusLiteSketch));
+    return hostResult();
+}
@@ -0,0 +1,123 @@
+/*
+ * WeatherBusLiteSweep ordering on heterogeneous nodes.
+ *
+ * Nine nodes answer after 15-300 ms with +-20% jitter, some fail up to 10%
+ * of the time (costing the response timeout), and carry weights 0.5-4;
+ * the wind sensors W and D carry the largest weights but are listed last.
+ * 500 sweeps are run in the listed order and 500 with WeatherBusLiteSweep.
+ * A sensor's staleness in a sweep is the time from the start of the sweep
+ * until the master moves on from it; the weighted mean over the sensors is
+ * averaged over the sweeps. Then W slows to 500 ms and the harness counts
+ * the sweeps until it has moved behind T and H.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteSweep.h"
+
+#define SWEEPS 500
+
+static const char TYPES[] = "THPAURWDC";
+static unsigned long _latencies[] = {40, 60, 30, 300, 150, 20, 15, 25, 200};  // ms
+static const unsigned FAILURES[] = {0, 2, 0, 10, 5, 0, 0, 1, 5};              // Percent
+static const float WEIGHTS[] = {1, 1, 0.5f, 0.5f, 0.5f, 1, 4, 2, 1};
+
+static std::vector<uint64_t> _queries;  // hostMicros() of every query a node heard
+
+class SlowNode : public HostNode {
+public:
+    void receive(const char *line) {
+        const char *type = line[0] == '?' && line[1] != '\0' && line[2] == '\0' ? strchr(TYPES, line[1]) : nullptr;
+        if (type == nullptr) {
+            return;
+        }
+        _queries.push_back(hostMicros());
+        int i = type - TYPES;
+        if (rand() % 100 < (int)FAILURES[i]) {
+            return;
+        }
+        uint64_t latency = _latencies[i] * 1000ULL;
+        latency = latency * (80 + rand() % 41) / 100;
+        char reply[16];
+        snprintf(reply, sizeof(reply), "%c:1.00\r\n", line[1]);
+        hostReply(reply, latency);
+    }
+};
+
+/**
+ * Weighted staleness of one sweep in ms, from the query times the nodes saw.
+ */
+static double staleness(const char *order, uint64_t start, uint64_t end) {
+    double sum = 0, weights = 0;
+    for (size_t k = 0; k < _queries.size(); k++) {
+        uint64_t done = k + 1 < _queries.size() ? _queries[k + 1] : end;
+        float weight = WEIGHTS[strchr(TYPES, order[k]) - TYPES];
+        sum += weight * (done - start) / 1e3;
+        weights += weight;
+    }
+    return sum / weights;
+}
+
+int main() {
+    srand(70);
+    SlowNode node;
+    hostAttach(&node);
+    WeatherBusLite bus;
+    bus.begin();
+
+    double listed = 0;
+    for (int s = 0; s < SWEEPS; s++) {
+        _queries.clear();
+        uint64_t start = hostMicros();
+        for (int i = 0; TYPES[i] != '\0'; i++) {
+            float value;
+            bus.queryCustom(TYPES[i], value);
+        }
+        listed += staleness(TYPES, start, hostMicros());
+    }
+
+    WeatherBusLiteSweep sweep(bus);
+    for (int i = 0; TYPES[i] != '\0'; i++) {
+        sweep.add(TYPES[i], WEIGHTS[i]);
+    }
+    double learned = 0;
+    char order[sizeof(TYPES)];
+    for (int s = 0; s < SWEEPS; s++) {
+        for (int i = 0; TYPES[i] != '\0'; i++) {
+            order[i] = sweep.order(i);
+        }
+        order[sizeof(TYPES) - 1] = '\0';
+        _queries.clear();
+        uint64_t start = hostMicros();
+        sweep.run();
+        learned += staleness(order, start, hostMicros());
+    }
+    printf("listed order %s:  weighted staleness %.0f ms\n", TYPES, listed / SWEEPS);
+    printf("learned order %s: weighted staleness %.0f ms\n", order, learned / SWEEPS);
+    hostCheck(learned * 2 < listed, "the learned order halves the weighted staleness");
+    hostCheck(order[0] == 'W', "the heavy, fast wind sensor goes first");
+
+    // W slows down and must give way to T and H
+    _latencies[6] = 500;
+    int sweeps = 0;
+    const char *t, *h, *w;
+    do {
+        sweep.run();
+        sweeps++;
+        for (int i = 0; TYPES[i] != '\0'; i++) {
+            order[i] = sweep.order(i);
+        }
+        t = strchr(order, 'T');
+        h = strchr(order, 'H');
+        w = strchr(order, 'W');
+    } while ((w < t || w < h) && sweeps < 100);
+    printf("W slowed to 500 ms: behind T and H after %d sweeps (order %s)\n", sweeps, order);
+    hostCheck(w > t && w > h && sweeps <= 30, "a slowed sensor moves back within 30 sweeps");
+    hostDetachAll();
+    return hostResult();
+}
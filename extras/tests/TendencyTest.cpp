@@ -0,0 +1,148 @@
+/*
+ * WeatherBusLiteTendency against a least squares fit of the raw readings.
+ *
+ * Feeds a month of pressure readings (a slow swing plus noise) every 10,
+ * 180, 240 and 270 s, and after every reading compares the tracker's 3 hour
+ * change with a double precision least squares fit over the raw readings of
+ * the last 3 hours, refitted from scratch. Poll periods that do not divide
+ * the 5 minute interval must not stretch the intervals, and the tracker's
+ * integer sums must not drift over the month. Also checks a 3 hPa ramp at
+ * each period, the trend thresholds, the Zambretti ranges and the restart
+ * after a gap.
+ */
+
+#include <deque>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "WeatherBusLiteTendency.h"
+
+struct Reading {
+    double time;  // ms
+    double pressure;
+};
+
+/**
+ * Least squares change over 3 hours of the readings, in hPa.
+ */
+static double referenceChange(const std::deque<Reading> &readings) {
+    double n = readings.size(), meanX = 0, meanY = 0;
+    for (const Reading &r : readings) {
+        meanX += r.time / n;
+        meanY += r.pressure / n;
+    }
+    double covariance = 0, variance = 0;
+    for (const Reading &r : readings) {
+        covariance += (r.time - meanX) * (r.pressure - meanY);
+        variance += (r.time - meanX) * (r.time - meanX);
+    }
+    return covariance / variance * 10800000.0;
+}
+
+/**
+ * Feed a steady ramp for 3 hours, polled every period ms, and return the trend.
+ */
+static WeatherBusLiteTrend trendFor(float hPaPer3h, WeatherBusLiteTendency &tracker, unsigned long period = 10000,
+                                    float *change = NULL) {
+    tracker.reset();
+    for (unsigned long t = 0; t <= 3 * 3600000UL; t += period) {
+        tracker.update(1013.0f + hPaPer3h * t / 10800000.0f, t);
+    }
+    if (change != NULL && !tracker.tendency(*change)) {
+        *change = NAN;
+    }
+    return tracker.trend();
+}
+
+/**
+ * A month of readings every step ms against the raw reading fit.
+ */
+static void month(unsigned long step) {
+    WeatherBusLiteTendency tracker;
+    std::deque<Reading> window;
+    double worst = 0, squares = 0, squaresFirstDay = 0, squaresLastDay = 0;
+    unsigned long compared = 0, comparedFirstDay = 0, comparedLastDay = 0;
+    bool readyWhenHalfFull = true;
+    const unsigned long days = 30;
+    srand(52);
+
+    for (unsigned long t = 0; t < days * 86400000UL; t += step) {
+        float pressure = 1010.0f + 12.0f * sinf(t / 86400000.0f * 2.0f * 3.14159265f / 2.0f)
+                         + 0.3f * ((float)rand() / RAND_MAX - 0.5f);
+        tracker.update(pressure, t);
+        window.push_back({(double)t, pressure});
+        while (window.front().time < (double)t - 10800000.0) {
+            window.pop_front();
+        }
+
+        float change;
+        bool ready = tracker.tendency(change);
+        readyWhenHalfFull = readyWhenHalfFull
+                            && ready == (t >= WEATHERBUSLITE_TENDENCY_SAMPLES / 2 * WEATHERBUSLITE_TENDENCY_INTERVAL);
+        if (ready && t >= 10800000UL) {
+            double error = fabs(change - referenceChange(window));
+            worst = error > worst ? error : worst;
+            squares += error * error;
+            compared++;
+            if (t < 86400000UL) {
+                squaresFirstDay += error * error;
+                comparedFirstDay++;
+            } else if (t >= (days - 1) * 86400000UL) {
+                squaresLastDay += error * error;
+                comparedLastDay++;
+            }
+        }
+    }
+    double rms = sqrt(squares / compared), rmsFirstDay = sqrt(squaresFirstDay / comparedFirstDay),
+           rmsLastDay = sqrt(squaresLastDay / comparedLastDay);
+    printf("every %3lu s: %lu comparisons, |change - fit| max %.3f hPa, rms %.3f, %.3f on the first day, %.3f on "
+           "the last\n",
+           step / 1000, compared, worst, rms, rmsFirstDay, rmsLastDay);
+    hostCheck(readyWhenHalfFull, "tendency available once the window is half full");
+    hostCheck(worst < 0.2 && rms < 0.06, "change matches the fit of the raw readings");
+    hostCheck(rmsLastDay < 1.5 * rmsFirstDay, "no drift after a month");
+}
+
+int main() {
+    const unsigned long periods[] = {10000, 180000, 240000, 270000};
+    for (unsigned long period : periods) {
+        month(period);
+    }
+
+    // A true 3 hPa in 3 hours at every poll period
+    WeatherBusLiteTendency tracker;
+    for (unsigned long period : periods) {
+        float change;
+        trendFor(3.0f, tracker, period, &change);
+        printf("3.00 hPa/3h polled every %3lu s: %.2f\n", period / 1000, change);
+        hostCheck(fabsf(change - 3.0f) < 0.1f, "ramp reads its true change");
+    }
+
+    // Thresholds: 1.6 hPa per 3 hours
+    hostCheck(trendFor(3.0f, tracker) == WEATHERBUSLITE_TREND_RISING, "3 hPa/3h is rising");
+    hostCheck(trendFor(-3.0f, tracker) == WEATHERBUSLITE_TREND_FALLING, "-3 hPa/3h is falling");
+    hostCheck(trendFor(1.0f, tracker) == WEATHERBUSLITE_TREND_STEADY, "1 hPa/3h is steady");
+    hostCheck(trendFor(-1.0f, tracker) == WEATHERBUSLITE_TREND_STEADY, "-1 hPa/3h is steady");
+
+    // Zambretti ranges
+    trendFor(-3.0f, tracker);
+    uint8_t falling = tracker.forecast(1000.0f);
+    trendFor(0.0f, tracker);
+    uint8_t steady = tracker.forecast(1030.0f);
+    trendFor(3.0f, tracker);
+    uint8_t rising = tracker.forecast(1050.0f);
+    printf("forecast: falling at 1000 hPa %u, steady at 1030 hPa %u, rising at 1050 hPa %u\n", falling, steady,
+           rising);
+    hostCheck(falling >= 1 && falling <= 9 && steady >= 10 && steady <= 19 && rising >= 20 && rising <= 32,
+              "forecast numbers within their Zambretti range");
+
+    // A gap of more than three intervals restarts the window
+    trendFor(3.0f, tracker);
+    tracker.update(1013.0f, 3 * 3600000UL + 4 * WEATHERBUSLITE_TENDENCY_INTERVAL);
+    hostCheck(tracker.trend() == WEATHERBUSLITE_TREND_UNKNOWN, "gap restarts the window");
+
+    printf("state: %u bytes\n", (unsigned)sizeof(WeatherBusLiteTendency));
+    return hostResult();
+}
@@ -0,0 +1,209 @@
+/*
+ * Firmware update of a fleet: broadcast and repair against unicast.
+ *
+ * 50 nodes stage a 64 KiB image in a NOR flash stand-in, where
+ * programming can only clear bits, so a block written twice with
+ * different data is corrupted rather than replaced. Each node loses 1% of
+ * the frames it hears and of the replies it sends. At four baud rates the
+ * fleet is updated once with WeatherBusLiteUpdater::broadcast followed by
+ * update() per node, and once with update() alone; the harness prints the
+ * time and blocks sent and checks that every node verified its image and
+ * agreed to swap. Then a fleet that already holds an image is updated to a
+ * second one, which only works if the staging area is erased for the new
+ * transfer, and a node whose flash corrupts a block must fail verification
+ * once and take the whole image again on the next update().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteUpdate.h"
+
+#define NODES 50
+#define IMAGE 65536
+#define BLOCKS ((IMAGE + WEATHERBUSLITE_BLOCK_SIZE - 1) / WEATHERBUSLITE_BLOCK_SIZE)
+
+static const char TYPES[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwx";
+
+// Erased NOR flash: programming ANDs the data into what is there.
+class NorSink : public WeatherBusLiteBlockSink {
+public:
+    NorSink() : erases(0), corruptAt(-1) {
+        memset(_flash, 0xFF, sizeof(_flash));
+    }
+
+    bool begin(uint32_t length) override {
+        if (length > sizeof(_flash)) {
+            return false;
+        }
+        memset(_flash, 0xFF, length);
+        erases++;
+        return true;
+    }
+
+    bool write(uint32_t offset, const uint8_t *data, size_t length) override {
+        if (offset + length > sizeof(_flash)) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+            _flash[offset + i] &= data[i];
+        }
+        if (corruptAt >= (long)offset && corruptAt < (long)(offset + length)) {
+            _flash[corruptAt] &= 0x7F;  // A weak cell, once
+            corruptAt = -1;
+        }
+        return true;
+    }
+
+    bool matches(const uint8_t *image) const {
+        return memcmp(_flash, image, sizeof(_flash)) == 0;
+    }
+
+    int erases;
+    long corruptAt;  // Offset of a byte whose top bit the next write there clears
+
+    bool read(uint32_t offset, uint8_t *data, size_t length) override {
+        if (offset + length > sizeof(_flash)) {
+            return false;
+        }
+        memcpy(data, _flash + offset, length);
+        return true;
+    }
+
+private:
+    uint8_t _flash[IMAGE];
+};
+
+class UpdateNode : public HostNode {
+public:
+    UpdateNode(char type) : update(type, sink, IMAGE, map, sizeof(map)) {}
+
+    void receive(const char *line) {
+        if (lost()) {
+            return;  // Corrupted on the way to the node
+        }
+        HostBuffer reply;
+        if (update.handle(line, reply) && reply.length() > 0 && !lost()) {
+            reply.reply(3000);
+        }
+    }
+
+    NorSink sink;
+    uint8_t map[(BLOCKS + 7) / 8];
+    WeatherBusLiteUpdate update;
+
+private:
+    static bool lost() {
+        return rand() % 100 == 0;
+    }
+};
+
+/**
+ * Update every node and return the simulated time it took in seconds.
+ */
+static double update(UpdateNode **nodes, const uint8_t *image, unsigned long baud, bool broadcast, uint32_t &blocks,
+                     int &swapped) {
+    WeatherBusLite bus;
+    bus.begin(baud);
+    WeatherBusLiteUpdater updater(bus);
+
+    uint64_t start = hostMicros();
+    if (broadcast) {
+        updater.broadcast(image, IMAGE);
+    }
+    swapped = 0;
+    for (int i = 0; i < NODES; i++) {
+        swapped += updater.update(TYPES[i], image, IMAGE) && nodes[i]->update.swapPending()
+                   && nodes[i]->sink.matches(image);
+    }
+    blocks = updater.blocksSent();
+    return (hostMicros() - start) / 1e6;
+}
+
+static void attach(UpdateNode **nodes) {
+    hostDetachAll();
+    srand(66);
+    for (int i = 0; i < NODES; i++) {
+        nodes[i] = new UpdateNode(TYPES[i]);
+        hostAttach(nodes[i]);
+    }
+}
+
+static void detach(UpdateNode **nodes) {
+    hostDetachAll();
+    for (int i = 0; i < NODES; i++) {
+        delete nodes[i];
+    }
+}
+
+/**
+ * Update a fresh fleet and return the simulated time it took in seconds.
+ */
+static double run(const uint8_t *image, unsigned long baud, bool broadcast, uint32_t &blocks, int &swapped) {
+    UpdateNode *nodes[NODES];
+    attach(nodes);
+    double seconds = update(nodes, image, baud, broadcast, blocks, swapped);
+    detach(nodes);
+    return seconds;
+}
+
+int main() {
+    static uint8_t image[IMAGE];
+    srand(64);
+    for (int i = 0; i < IMAGE; i++) {
+        image[i] = rand();
+    }
+
+    const unsigned long bauds[] = {9600, 19200, 57600, 115200};
+    printf("baud     broadcast+repair          unicast each node\n");
+    for (int b = 0; b < 4; b++) {
+        uint32_t broadcastBlocks, unicastBlocks;
+        int broadcastSwapped, unicastSwapped;
+        double broadcastTime = run(image, bauds[b], true, broadcastBlocks, broadcastSwapped);
+        double unicastTime = run(image, bauds[b], false, unicastBlocks, unicastSwapped);
+        printf("%-6lu   %5.0f s, %5lu blocks       %5.0f s, %5lu blocks\n", bauds[b], broadcastTime,
+               (unsigned long)broadcastBlocks, unicastTime, (unsigned long)unicastBlocks);
+        hostCheck(broadcastSwapped == NODES && unicastSwapped == NODES, "every node verifies and swaps");
+        hostCheck(broadcastTime * 10 < unicastTime, "broadcast is over ten times faster");
+    }
+
+    // A second image over the first, then a block corrupted in one node's flash
+    static uint8_t second[IMAGE];
+    for (int i = 0; i < IMAGE; i++) {
+        second[i] = rand();
+    }
+    UpdateNode *nodes[NODES];
+    attach(nodes);
+    uint32_t firstBlocks, secondBlocks;
+    int firstSwapped, secondSwapped;
+    update(nodes, image, 115200, true, firstBlocks, firstSwapped);
+    update(nodes, second, 115200, true, secondBlocks, secondSwapped);
+    int erases = 0;
+    for (int i = 0; i < NODES; i++) {
+        erases += nodes[i]->sink.erases;
+    }
+    printf("second image: %d/%d nodes swapped, %d erases\n", secondSwapped, NODES, erases);
+    hostCheck(firstSwapped == NODES && secondSwapped == NODES, "a new image replaces the staged one");
+
+    WeatherBusLite bus;
+    bus.begin(115200);
+    WeatherBusLiteUpdater updater(bus);
+    UpdateNode *weak = nodes[NODES / 2];
+    for (int i = 0; i < IMAGE; i++) {
+        image[i] = ~image[i];
+    }
+    weak->sink.corruptAt = IMAGE / 2;
+    image[IMAGE / 2] |= 0x80;  // So the stuck bit changes it
+    bool first = updater.update(TYPES[NODES / 2], image, IMAGE);
+    uint32_t before = updater.blocksSent();
+    bool repaired = updater.update(TYPES[NODES / 2], image, IMAGE) && weak->sink.matches(image);
+    printf("corrupted block: first update %s, second %s after %lu blocks\n", first ? "swapped" : "refused",
+           repaired ? "swapped" : "refused", (unsigned long)(updater.blocksSent() - before));
+    hostCheck(!first, "a corrupted image is refused");
+    hostCheck(repaired && updater.blocksSent() - before >= BLOCKS, "the next update sends the whole image again");
+    detach(nodes);
+    return hostResult();
+}
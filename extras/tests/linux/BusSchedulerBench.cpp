@@ -0,0 +1,167 @@
+/*
+ * WeatherBusLiteBusScheduler against a thread per bus.
+ *
+ * Nodes on pseudo-terminals answer each query after 10 ms and every bus
+ * sweeps four sensors back to back. For 1, 16, 64 and 256 buses, runs
+ * the scheduler with 4 workers and the thread-per-bus collector for 2 s
+ * each and prints readings per second, process CPU (including the node
+ * thread) and the sweep duration percentiles. Then stops and restarts a
+ * scheduler five times, which must carry on sweeping every time. Finally
+ * a bus that refuses every write must fail its queries at once.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <sys/resource.h>
+
+#include "PtyTest.h"
+#include "WeatherBusLiteBusScheduler.h"
+#include "WeatherBusLiteCollector.h"
+
+#define SECONDS 2
+#define DELAY_US 10000
+#define WORKERS 4
+
+struct Run {
+    double readingsPerSecond;
+    double cpuShare;
+    double sweepP50;  // ms
+    double sweepP99;
+    uint64_t failed;
+};
+
+static Run run(bool threaded, int buses) {
+    PtyNodes nodes(buses, DELAY_US);
+    std::mutex mutex;
+    std::vector<double> sweeps;
+    std::atomic<uint64_t> ok(0), failed(0);
+    std::vector<uint64_t> sweepStart(buses, 0);
+    auto onReading = [&](const WeatherBusLiteHostReading &reading) {
+        if (reading.ok) {
+            ok++;
+        } else {
+            failed++;
+        }
+        // The collector has no sweep handler; the aggregator thread times the sweeps
+        if (threaded && reading.type == 'T') {
+            sweepStart[reading.bus] = reading.queried;
+        } else if (threaded && reading.type == 'W' && sweepStart[reading.bus] != 0) {
+            sweeps.push_back((reading.received - sweepStart[reading.bus]) / 1e6);
+        }
+    };
+
+    double cpu = ptyCpuSeconds();
+    uint64_t start = weatherBusLiteNanos();
+    if (threaded) {
+        WeatherBusLiteCollector collector(onReading);
+        for (int i = 0; i < buses; i++) {
+            collector.addBus(nodes.slaves[i], "THPW");
+        }
+        collector.start();
+        usleep(SECONDS * 1000000);
+        collector.stop();
+    } else {
+        WeatherBusLiteBusScheduler scheduler(onReading, WORKERS);
+        scheduler.setSweepHandler([&](int, uint64_t begin, uint64_t end) {
+            std::lock_guard<std::mutex> lock(mutex);
+            sweeps.push_back((end - begin) / 1e6);
+        });
+        for (int i = 0; i < buses; i++) {
+            scheduler.addBus(nodes.slaves[i], "THPW");
+        }
+        scheduler.start();
+        usleep(SECONDS * 1000000);
+        scheduler.stop();
+    }
+    double elapsed = (weatherBusLiteNanos() - start) / 1e9;
+
+    std::sort(sweeps.begin(), sweeps.end());
+    auto percentile = [&](double p) {
+        return sweeps.empty() ? 0.0 : sweeps[std::min(sweeps.size() - 1, (size_t)(p * sweeps.size()))];
+    };
+    Run result;
+    result.readingsPerSecond = ok / elapsed;
+    result.cpuShare = (ptyCpuSeconds() - cpu) / elapsed;
+    result.sweepP50 = percentile(0.5);
+    result.sweepP99 = percentile(0.99);
+    result.failed = failed;
+    return result;
+}
+
+int main() {
+    // 256 buses take two pty descriptors and a timerfd each
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < 4096) {
+        limit.rlim_cur = std::min<rlim_t>(4096, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    const int sizes[] = {1, 16, 64, 256};
+    for (int buses : sizes) {
+        Run scheduler = run(false, buses);
+        Run threads = run(true, buses);
+        printf("%3d buses  scheduler (%d workers): %6.0f readings/s, %4.1f%% CPU, sweep p50 %.1f ms, p99 %.1f ms\n",
+               buses, WORKERS, scheduler.readingsPerSecond, scheduler.cpuShare * 100, scheduler.sweepP50,
+               scheduler.sweepP99);
+        printf("%3d buses  thread per bus:        %6.0f readings/s, %4.1f%% CPU, sweep p50 %.1f ms, p99 %.1f ms\n",
+               buses, threads.readingsPerSecond, threads.cpuShare * 100, threads.sweepP50, threads.sweepP99);
+        ptyCheck(scheduler.failed == 0 && threads.failed == 0, "no query fails");
+        // Four replies at 10 ms each, plus scheduling
+        ptyCheck(scheduler.sweepP50 >= 40 && scheduler.sweepP50 < 60, "scheduler sweeps take about 4 replies");
+    }
+
+    // Restarts carry on from the start of a sweep
+    PtyNodes nodes(8, 2000);
+    std::atomic<uint64_t> ok(0), failed(0);
+    WeatherBusLiteBusScheduler scheduler(
+        [&](const WeatherBusLiteHostReading &reading) {
+            if (reading.ok) {
+                ok++;
+            } else {
+                failed++;
+            }
+        },
+        2);
+    for (int i = 0; i < 8; i++) {
+        scheduler.addBus(nodes.slaves[i], "THPW");
+    }
+    bool restarted = true;
+    uint64_t fewest = UINT64_MAX;
+    for (int round = 0; round < 5; round++) {
+        uint64_t before = ok;
+        restarted = scheduler.start() && restarted;
+        usleep(200000);
+        scheduler.stop();
+        fewest = std::min(fewest, ok - before);
+    }
+    printf("5 restarts: at least %llu readings per 200 ms round, %llu failed\n", (unsigned long long)fewest,
+           (unsigned long long)failed.load());
+    ptyCheck(restarted && fewest > 100 && failed == 0, "the scheduler sweeps again after every restart");
+
+    // Writes to the read end of a pipe fail with EBADF
+    int pipeFds[2];
+    ptyCheck(pipe(pipeFds) == 0, "pipe created");
+    std::mutex mutex;
+    std::vector<WeatherBusLiteHostReading> refused;
+    {
+        WeatherBusLiteBusScheduler dead(
+            [&](const WeatherBusLiteHostReading &reading) {
+                std::lock_guard<std::mutex> lock(mutex);
+                refused.push_back(reading);
+            },
+            1);
+        dead.addBus(pipeFds[0], "TH");
+        dead.start();
+        usleep(200000);
+        dead.stop();
+    }
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    bool immediate = refused.size() == 2;
+    for (size_t i = 0; immediate && i < refused.size(); i++) {
+        immediate = !refused[i].ok && refused[i].received - refused[i].queried < 10000000ULL;
+    }
+    printf("refused writes: %zu failed readings in 200 ms\n", refused.size());
+    ptyCheck(immediate, "a query the bus does not take fails at once, and the next sweep waits");
+    return ptyResult();
+}
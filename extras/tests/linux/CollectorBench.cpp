@@ -0,0 +1,95 @@
+/*
+ * WeatherBusLiteCollector throughput and latency on pseudo-terminals.
+ *
+ * 64 buses sweep four sensors back to back for 2 s against one thread
+ * answering as every node at once. Prints the readings per second and the
+ * query-to-handler latency percentiles, and checks that nothing failed or
+ * was dropped and that every answered query reached the handler after
+ * stop(). Then checks WeatherBusLiteHostBus on its own: a query to a bus
+ * whose output has filled up gives up within the response timeout, and a
+ * stale reply waiting in the receive queue is not taken for the answer.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "PtyTest.h"
+#include "WeatherBusLiteCollector.h"
+
+#define BUSES 64
+#define SECONDS 2
+
+int main() {
+    PtyNodes nodes(BUSES, 0);
+    std::vector<uint64_t> latency;
+    latency.reserve(2000000);
+    uint64_t ok = 0, failed = 0;
+    WeatherBusLiteCollector collector([&](const WeatherBusLiteHostReading &reading) {
+        if (reading.ok) {
+            ok++;
+            latency.push_back(weatherBusLiteNanos() - reading.queried);
+        } else {
+            failed++;
+        }
+    });
+    for (int i = 0; i < BUSES; i++) {
+        collector.addBus(nodes.slaves[i], "THPW");
+    }
+    double cpu = ptyCpuSeconds();
+    uint64_t start = weatherBusLiteNanos();
+    collector.start();
+    usleep(SECONDS * 1000000);
+    collector.stop();
+    double elapsed = (weatherBusLiteNanos() - start) / 1e9;
+    cpu = ptyCpuSeconds() - cpu;
+
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](double p) {
+        return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, (size_t)(p * latency.size()))] / 1e3;
+    };
+    printf("%d buses: %.0f readings/s, %llu failed, %llu dropped, latency p50 %.0f us, p99 %.0f us, p99.9 %.0f us, "
+           "max %.0f us, CPU %.0f%%\n",
+           BUSES, ok / elapsed, (unsigned long long)failed, (unsigned long long)collector.dropped(), percentile(0.5),
+           percentile(0.99), percentile(0.999), percentile(1.0), 100 * cpu / elapsed);
+    ptyCheck(ok > 0 && failed == 0 && collector.dropped() == 0, "every reading arrives, none dropped");
+    ptyCheck(ok + BUSES >= nodes.answered() && ok <= nodes.answered(),
+             "readings published before stop() reach the handler");
+
+    // A bus nobody reads: writes stop with EAGAIN once the buffers are full
+    {
+        PtyNodes silent(1, 0);
+        silent.setSilent(true);
+        usleep(10000);
+        WeatherBusLiteHostBus bus(silent.slaves[0]);
+        char query[24];  // Fits the query line buffer
+        memset(query, 'x', sizeof(query) - 1);
+        query[0] = '?';
+        query[sizeof(query) - 1] = '\0';
+        uint64_t slowest = 0;
+        bool sent = true;
+        for (int i = 0; i < 100000 && sent; i++) {
+            uint64_t before = weatherBusLiteNanos();
+            sent = bus.sendQuery(query);
+            slowest = std::max(slowest, weatherBusLiteNanos() - before);
+        }
+        printf("full output buffer: query %s after %.0f ms\n", sent ? "still sent" : "given up", slowest / 1e6);
+        ptyCheck(!sent && slowest <= (WEATHERBUSLITE_HOST_RESPONSE_TIMEOUT + 100) * 1000000ULL,
+                 "a blocked query gives up within the response timeout");
+    }
+
+    // A late reply from an earlier query is already waiting
+    {
+        PtyNodes late(1, 0);
+        usleep(10000);
+        WeatherBusLiteHostBus bus(late.slaves[0]);
+        const char stale[] = "T:99.00\r\n";
+        ptyCheck(write(late.masters[0], stale, sizeof(stale) - 1) == sizeof(stale) - 1, "stale reply written");
+        usleep(10000);
+        float value = 0;
+        WeatherBusLiteFields fields;
+        bool answered = bus.queryCustom('T', value, fields);
+        printf("stale reply queued: query read %.2f\n", value);
+        ptyCheck(answered && value == 21.5f, "a stale reply is flushed before the query");
+    }
+    return ptyResult();
+}
@@ -0,0 +1,165 @@
+/*
+ * Cost of the coroutine query API.
+ *
+ * First the bare cost of a nested co_await over two frames, the shape of
+ * every query, against a plain call. Then 20000 temperature queries on
+ * one pseudo-terminal bus whose node answers at once, with the blocking
+ * WeatherBusLiteHostBus and with WeatherBusLiteAsyncBus, checking that
+ * the coroutine version allocates nothing from the heap after warm-up.
+ * Then 64 buses swept by coroutines on a single thread. Finally a stale
+ * reply waiting in the receive queue must not be taken for the answer.
+ */
+
+#include <memory>
+
+#include "PtyTest.h"
+#include "WeatherBusLiteAsyncBus.h"
+#include "WeatherBusLiteHostBus.h"
+
+#define AWAITS 2000000
+#define QUERIES 20000
+#define BUSES 64
+#define PER_BUS 1000
+
+static long _sink;
+static uint64_t _awaitStart;
+
+static WeatherBusLiteTask<int> leaf(int x) {
+    co_return x + 1;
+}
+
+static WeatherBusLiteTask<int> nested(int x) {
+    co_return co_await leaf(x);
+}
+
+__attribute__((noinline)) static int plain(int x) {
+    asm volatile("");
+    return x + 1;
+}
+
+static WeatherBusLiteTask<void> awaitMany(int count) {
+    for (int i = 0; i < 1000; i++) {
+        _sink += co_await nested(i);  // Warm up the frame pool
+    }
+    _awaitStart = weatherBusLiteNanos();
+    for (int i = 0; i < count; i++) {
+        _sink += co_await nested(i);
+    }
+}
+
+static WeatherBusLiteTask<void> queryOne(WeatherBusLiteAsyncBus *bus, int *ok, uint64_t *heapAfterWarmUp) {
+    float value;
+    for (int i = 0; i < QUERIES; i++) {
+        if (i == 100) {
+            *heapAfterWarmUp = WeatherBusLiteFramePool::heapAllocations();
+        }
+        *ok += co_await bus->queryTemp(value);
+    }
+    *heapAfterWarmUp = WeatherBusLiteFramePool::heapAllocations() - *heapAfterWarmUp;
+}
+
+static WeatherBusLiteTask<void> sweepBus(WeatherBusLiteAsyncBus *bus, int *ok) {
+    float value;
+    for (int i = 0; i < PER_BUS; i++) {
+        *ok += co_await bus->queryCustom("THPW"[i % 4], value);
+    }
+}
+
+static WeatherBusLiteTask<void> queryStale(WeatherBusLiteAsyncBus *bus, bool *answered, float *value) {
+    *answered = co_await bus->queryTemp(*value);
+}
+
+int main() {
+    {
+        WeatherBusLiteEventLoop loop;
+        uint64_t heap = WeatherBusLiteFramePool::heapAllocations();
+        loop.spawn(awaitMany(AWAITS));
+        loop.run();
+        double awaitNs = (weatherBusLiteNanos() - _awaitStart) / (double)AWAITS;
+        uint64_t start = weatherBusLiteNanos();
+        for (int i = 0; i < AWAITS; i++) {
+            _sink += plain(i);
+        }
+        double plainNs = (weatherBusLiteNanos() - start) / (double)AWAITS;
+        heap = WeatherBusLiteFramePool::heapAllocations() - heap;
+        printf("no I/O:     nested co_await %.1f ns, plain call %.1f ns, %llu pool heap allocations\n", awaitNs,
+               plainNs, (unsigned long long)heap);
+        ptyCheck(heap <= 4, "the frame pool serves nested awaits without the heap");
+    }
+
+    {
+        PtyNodes nodes(1, 0);
+        usleep(10000);
+        WeatherBusLiteHostBus bus(nodes.slaves[0]);
+        float value;
+        WeatherBusLiteFields fields;
+        int ok = 0;
+        double cpu = ptyCpuSeconds();
+        uint64_t start = weatherBusLiteNanos();
+        for (int i = 0; i < QUERIES; i++) {
+            ok += bus.queryCustom('T', value, fields);
+        }
+        double wall = (weatherBusLiteNanos() - start) / 1e3 / QUERIES;
+        cpu = (ptyCpuSeconds() - cpu) * 1e6 / QUERIES;
+        printf("blocking:   %d/%d answered, %.1f us wall, %.1f us CPU per query (with the node thread)\n", ok,
+               QUERIES, wall, cpu);
+        ptyCheck(ok == QUERIES, "every blocking query answered");
+    }
+
+    {
+        PtyNodes nodes(1, 0);
+        usleep(10000);
+        WeatherBusLiteEventLoop loop;
+        WeatherBusLiteAsyncBus bus(loop, nodes.slaves[0]);
+        int ok = 0;
+        uint64_t heap = 0;
+        double cpu = ptyCpuSeconds();
+        uint64_t start = weatherBusLiteNanos();
+        loop.spawn(queryOne(&bus, &ok, &heap));
+        loop.run();
+        double wall = (weatherBusLiteNanos() - start) / 1e3 / QUERIES;
+        cpu = (ptyCpuSeconds() - cpu) * 1e6 / QUERIES;
+        printf("coroutine:  %d/%d answered, %.1f us wall, %.1f us CPU per query, %llu heap allocations after "
+               "warm-up\n",
+               ok, QUERIES, wall, cpu, (unsigned long long)heap);
+        ptyCheck(ok == QUERIES, "every coroutine query answered");
+        ptyCheck(heap == 0, "no heap allocations per query after warm-up");
+    }
+
+    {
+        PtyNodes nodes(BUSES, 0);
+        usleep(10000);
+        WeatherBusLiteEventLoop loop;
+        std::vector<std::unique_ptr<WeatherBusLiteAsyncBus>> buses;
+        int ok = 0;
+        for (int i = 0; i < BUSES; i++) {
+            buses.emplace_back(new WeatherBusLiteAsyncBus(loop, nodes.slaves[i]));
+            loop.spawn(sweepBus(buses.back().get(), &ok));
+        }
+        double cpu = ptyCpuSeconds();
+        uint64_t start = weatherBusLiteNanos();
+        loop.run();
+        double elapsed = (weatherBusLiteNanos() - start) / 1e9;
+        printf("%d buses on one thread: %d/%d answered, %.0f readings/s, %.1f us CPU per reading\n", BUSES, ok,
+               BUSES * PER_BUS, ok / elapsed, (ptyCpuSeconds() - cpu) * 1e6 / ok);
+        ptyCheck(ok == BUSES * PER_BUS, "every bus swept to the end");
+    }
+
+    // A late reply from an earlier query is already waiting
+    {
+        PtyNodes late(1, 0);
+        usleep(10000);
+        WeatherBusLiteEventLoop loop;
+        WeatherBusLiteAsyncBus bus(loop, late.slaves[0]);
+        const char stale[] = "T:99.00\r\n";
+        ptyCheck(write(late.masters[0], stale, sizeof(stale) - 1) == sizeof(stale) - 1, "stale reply written");
+        usleep(10000);
+        bool answered = false;
+        float value = 0;
+        loop.spawn(queryStale(&bus, &answered, &value));
+        loop.run();
+        printf("stale reply queued: query read %.2f\n", value);
+        ptyCheck(answered && value == 21.5f, "a stale reply is flushed before the query");
+    }
+    return ptyResult();
+}
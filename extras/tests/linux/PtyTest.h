@@ -0,0 +1,162 @@
+#ifndef WEATHERBUSLITE_PTY_TEST_H
+#define WEATHERBUSLITE_PTY_TEST_H
+
+#include <pty.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WeatherBusLiteSerial.h"
+
+// Support for the Linux host harnesses: checks, CPU time and simulated
+// nodes on pseudo-terminals. Header only, since the harnesses link
+// against the Linux host build and nothing else.
+
+inline unsigned &ptyChecks() {
+    static unsigned checks = 0;
+    return checks;
+}
+
+inline unsigned &ptyFailures() {
+    static unsigned failures = 0;
+    return failures;
+}
+
+// Record a check; failures are printed and make ptyResult() fail.
+inline void ptyCheck(bool ok, const char *what) {
+    ptyChecks()++;
+    if (!ok) {
+        ptyFailures()++;
+        printf("FAILED: %s\n", what);
+    }
+}
+
+// Exit status for main(): 0 if every check passed.
+inline int ptyResult() {
+    printf("%u checks, %u failed\n", ptyChecks(), ptyFailures());
+    return ptyFailures() == 0 ? 0 : 1;
+}
+
+// User and system CPU time of the whole process, in seconds.
+inline double ptyCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// A pseudo-terminal per bus, with one thread answering as every node on
+// the master sides: "?X" gets "X:21.50,!0" after delayUs. The library
+// under test talks to slaves[i].
+class PtyNodes {
+public:
+    PtyNodes(int buses, unsigned delayUs) : _delayUs(delayUs), _running(true), _silent(false), _answered(0) {
+        for (int i = 0; i < buses; i++) {
+            int master, slave;
+            if (openpty(&master, &slave, nullptr, nullptr, nullptr) < 0) {
+                perror("openpty");
+                exit(1);
+            }
+            weatherBusLiteConfigureSerial(master, 115200);
+            weatherBusLiteConfigureSerial(slave, 115200);
+            masters.push_back(master);
+            slaves.push_back(slave);
+        }
+        _thread = std::thread([this] { answer(); });
+    }
+
+    ~PtyNodes() {
+        _running = false;
+        _thread.join();
+        for (size_t i = 0; i < masters.size(); i++) {
+            close(masters[i]);
+            close(slaves[i]);
+        }
+    }
+
+    // Stop answering and reading, e.g. to let a bus's buffers fill up.
+    void setSilent(bool silent) {
+        _silent = silent;
+    }
+
+    // Queries answered since construction.
+    uint64_t answered() const {
+        return _answered;
+    }
+
+    std::vector<int> masters;
+    std::vector<int> slaves;
+
+private:
+    typedef std::pair<uint64_t, std::pair<int, char>> Due;  // Reply time, bus and type
+
+    void answer() {
+        int epollFd = epoll_create1(0);
+        for (size_t i = 0; i < masters.size(); i++) {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = i;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, masters[i], &event);
+        }
+        std::vector<std::string> pending(masters.size());
+        std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+        epoll_event events[256];
+        while (_running) {
+            if (_silent) {
+                usleep(1000);
+                continue;
+            }
+            int timeout = 50;
+            if (!due.empty()) {
+                uint64_t now = weatherBusLiteNanos();
+                timeout = due.top().first > now ? (int)((due.top().first - now + 999999) / 1000000) : 0;
+            }
+            int count = epoll_wait(epollFd, events, 256, timeout);
+            uint64_t now = weatherBusLiteNanos();
+            for (int k = 0; k < count; k++) {
+                int i = events[k].data.u32;
+                char buffer[256];
+                ssize_t length = read(masters[i], buffer, sizeof(buffer));
+                if (length <= 0) {
+                    continue;
+                }
+                pending[i].append(buffer, length);
+                size_t end;
+                while ((end = pending[i].find('\n')) != std::string::npos) {
+                    std::string line = pending[i].substr(0, end);
+                    pending[i].erase(0, end + 1);
+                    if (line.size() >= 2 && line[0] == '?') {
+                        due.push(Due(now + _delayUs * 1000ULL, std::make_pair(i, line[1])));
+                    }
+                }
+            }
+            now = weatherBusLiteNanos();
+            while (!due.empty() && due.top().first <= now) {
+                Due next = due.top();
+                due.pop();
+                char reply[32];
+                int length = snprintf(reply, sizeof(reply), "%c:21.50,!0\r\n", next.second.second);
+                if (write(masters[next.second.first], reply, length) == length) {
+                    _answered++;
+                }
+            }
+        }
+        close(epollFd);
+    }
+
+    unsigned _delayUs;
+    std::atomic<bool> _running;
+    std::atomic<bool> _silent;
+    std::atomic<uint64_t> _answered;
+    std::thread _thread;
+};
+
+#endif
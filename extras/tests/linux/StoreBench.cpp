@@ -0,0 +1,259 @@
+/*
+ * WeatherBusLiteStore against CSV, and crash recovery.
+ *
+ * 50 stations x 3 sensors x 6 hours at 1 Hz are written to a store and,
+ * for comparison, to a CSV file with fprintf; both are synced. Then one
+ * sensor of one station is read back over 1 hour and over the whole run,
+ * from the store and by parsing the CSV, and the store's samples are
+ * checked. Then readings after outages of 5 hours to 30 days must stay
+ * in one segment and read back exactly, before and after a reopen.
+ * Finally a child process that appends without syncing, with a 6 hour
+ * outage every 1000 readings, is killed with SIGKILL five times at random
+ * moments; each reopen must recover a contiguous prefix that the next
+ * child continues.
+ */
+
+#include <algorithm>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "PtyTest.h"
+#include "WeatherBusLiteStore.h"
+
+#define STATIONS 50
+#define SECONDS 21600
+#define START 1760000000000ULL
+
+static const char TYPES[] = "THP";
+
+static float valueFor(int station, int sensor, uint64_t second) {
+    return (float)(station * 0.01 + sensor * 10 + (second % 1000) * 0.001);
+}
+
+/**
+ * Time of the crash test's reading i: 1 Hz with a 6 hour outage every 1000 readings.
+ */
+static uint64_t crashTime(uint64_t i) {
+    return START + i * 1000 + (i / 1000) * 6 * 3600000ULL;
+}
+
+static uint64_t crashIndex(uint64_t time) {
+    uint64_t block = 1000 * 1000 + 6 * 3600000ULL;
+    return (time - START) / block * 1000 + (time - START) % block / 1000;
+}
+
+/**
+ * Value of the crash test's reading i, exact in a float.
+ */
+static float crashValue(uint64_t i) {
+    return (float)(i % 1000000);
+}
+
+static double seconds() {
+    return weatherBusLiteNanos() / 1e9;
+}
+
+/**
+ * One sensor of the middle station over span seconds around the middle of the run.
+ */
+static void scan(const std::string &directory, const std::string &csv, int span) {
+    uint64_t from = START + (SECONDS / 2 - span / 2) * 1000ULL, to = from + span * 1000ULL - 1;
+    int station = STATIONS / 2;
+
+    WeatherBusLiteStore store(directory.c_str());
+    std::vector<WeatherBusLiteStoredReading> samples;
+    double best = 1e9;
+    for (int round = 0; round < 10; round++) {
+        samples.clear();
+        double start = seconds();
+        store.read(station, 'H', from, to, samples);
+        best = std::min(best, seconds() - start);
+    }
+    bool correct = samples.size() == (size_t)span;
+    for (size_t i = 0; correct && i < samples.size(); i++) {
+        correct = samples[i].time == from + i * 1000
+                  && samples[i].value == valueFor(station, 1, (samples[i].time - START) / 1000);
+    }
+
+    double start = seconds();
+    FILE *file = fopen(csv.c_str(), "r");
+    char line[128];
+    size_t found = 0;
+    while (file != nullptr && fgets(line, sizeof(line), file)) {
+        char *end;
+        unsigned long long time = strtoull(line, &end, 10);
+        if (time < from || time > to) {
+            continue;
+        }
+        if (strtol(end + 1, &end, 10) == station && end[1] == 'H') {
+            found++;
+        }
+    }
+    if (file != nullptr) {
+        fclose(file);
+    }
+    double csvSeconds = seconds() - start;
+
+    printf("scan %5d s: store %zu samples in %.2f ms, CSV %zu in %.0f ms\n", span, samples.size(), best * 1e3, found,
+           csvSeconds * 1e3);
+    ptyCheck(correct, "the store returns exactly the samples in the range");
+    ptyCheck(found == (size_t)span, "the CSV parse finds the same samples");
+}
+
+int main() {
+    char base[] = "/tmp/weatherbuslite-store-XXXXXX";
+    if (mkdtemp(base) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string directory = std::string(base) + "/store";
+    std::string csv = std::string(base) + "/readings.csv";
+    uint64_t readings = (uint64_t)STATIONS * 3 * SECONDS;
+
+    {
+        double start = seconds();
+        WeatherBusLiteStore store(directory.c_str());
+        bool ok = store.valid();
+        for (int s = 0; s < SECONDS && ok; s++) {
+            for (int station = 0; station < STATIONS; station++) {
+                for (int k = 0; k < 3; k++) {
+                    ok = ok && store.append(station, TYPES[k], START + s * 1000ULL, valueFor(station, k, s));
+                }
+            }
+        }
+        double appended = seconds();
+        ok = store.sync() && ok;
+        printf("store ingest: %llu readings, %.0f ns/reading, sync %.2f s\n", (unsigned long long)readings,
+               (appended - start) * 1e9 / readings, seconds() - appended);
+        ptyCheck(ok, "every append succeeds");
+    }
+    {
+        double start = seconds();
+        FILE *file = fopen(csv.c_str(), "w");
+        for (int s = 0; file != nullptr && s < SECONDS; s++) {
+            for (int station = 0; station < STATIONS; station++) {
+                for (int k = 0; k < 3; k++) {
+                    fprintf(file, "%llu,%d,%c,%.3f,%u\n", (unsigned long long)(START + s * 1000ULL), station, TYPES[k],
+                            valueFor(station, k, s), 0u);
+                }
+            }
+        }
+        double appended = seconds();
+        if (file != nullptr) {
+            fflush(file);
+            fsync(fileno(file));
+            fclose(file);
+        }
+        printf("CSV ingest:   %llu readings, %.0f ns/reading, fsync %.2f s\n", (unsigned long long)readings,
+               (appended - start) * 1e9 / readings, seconds() - appended);
+    }
+    scan(directory, csv, 3600);
+    scan(directory, csv, SECONDS);
+
+    // Outages longer than a delta can hold
+    {
+        std::string gapDirectory = std::string(base) + "/gaps";
+        const uint64_t gaps[] = {1000, 5 * 3600000ULL, 1000, 86400000ULL, WEATHERBUSLITE_STORE_MAX_DELTA,
+                                 WEATHERBUSLITE_STORE_MAX_DELTA + 1, 30 * 86400000ULL, 1000};
+        std::vector<uint64_t> times;
+        uint64_t time = START;
+        bool ok;
+        {
+            WeatherBusLiteStore store(gapDirectory.c_str());
+            ok = store.valid();
+            for (uint64_t gap : gaps) {
+                time += gap;
+                times.push_back(time);
+                ok = store.append(7, 'R', time, (float)times.size()) && ok;
+            }
+        }
+        bool exact = ok;
+        for (int pass = 0; pass < 2; pass++) {  // The second pass reads a new store, as after a restart
+            WeatherBusLiteStore store(gapDirectory.c_str());
+            std::vector<WeatherBusLiteStoredReading> samples;
+            store.read(7, 'R', 0, UINT64_MAX, samples);
+            exact = exact && samples.size() == times.size();
+            for (size_t i = 0; exact && i < samples.size(); i++) {
+                exact = samples[i].time == times[i] && samples[i].value == (float)(i + 1);
+            }
+            if (pass == 0) {
+                store.append(7, 'R', time + 1000, (float)(times.size() + 1));  // After recovery
+                times.push_back(time + 1000);
+            }
+        }
+
+        // An escape record whose time never reached the disk, as after a power loss
+        uint64_t torn = ((uint64_t)0xffffff << 8) | 1;
+        int fd = open((gapDirectory + "/7-R-000000.wbl").c_str(), O_WRONLY);
+        size_t slots = times.size() + 4;  // Four of the gaps took an escape
+        bool written = fd >= 0 && pwrite(fd, &torn, sizeof(torn), WEATHERBUSLITE_STORE_HEADER_SIZE + slots * 8) == 8;
+        if (fd >= 0) {
+            close(fd);
+        }
+        bool recovered = written;
+        {
+            WeatherBusLiteStore store(gapDirectory.c_str());
+            std::vector<WeatherBusLiteStoredReading> samples;
+            store.read(7, 'R', 0, UINT64_MAX, samples);
+            recovered = recovered && samples.size() == times.size();
+            store.append(7, 'R', times.back() + 1000, 0.0f);
+            samples.clear();
+            store.read(7, 'R', 0, UINT64_MAX, samples);
+            recovered = recovered && samples.size() == times.size() + 1 && samples.back().time == times.back() + 1000;
+        }
+
+        struct stat st;
+        bool oneSegment = stat((gapDirectory + "/7-R-000000.wbl").c_str(), &st) == 0
+                          && stat((gapDirectory + "/7-R-000001.wbl").c_str(), &st) != 0;
+        printf("outages of up to 30 days: %zu readings %s, %s\n", times.size(), exact ? "exact" : "WRONG",
+               oneSegment ? "one segment" : "several segments");
+        ptyCheck(exact, "readings after long outages keep their times across a reopen");
+        ptyCheck(oneSegment, "a long outage does not start a new segment");
+        ptyCheck(recovered, "an escape record without its time ends the column on reopen");
+    }
+
+    // Writers killed without syncing
+    std::string crashDirectory = std::string(base) + "/crash";
+    size_t known = 0;
+    bool contiguous = true, grew = true;
+    srand(75);
+    for (int round = 0; round < 5; round++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            WeatherBusLiteStore store(crashDirectory.c_str());
+            std::vector<WeatherBusLiteStoredReading> samples;
+            store.read(0, 'T', known > 0 ? crashTime(known - 1) : 0, UINT64_MAX, samples);  // The tail
+            uint64_t i = samples.empty() ? 0 : crashIndex(samples.back().time) + 1;
+            for (;;) {
+                store.append(0, 'T', crashTime(i), crashValue(i));
+                i++;
+            }
+        }
+        usleep(20000 + rand() % 200000);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        WeatherBusLiteStore store(crashDirectory.c_str());
+        std::vector<WeatherBusLiteStoredReading> samples;
+        store.read(0, 'T', 0, UINT64_MAX, samples);
+        bool ok = store.valid();
+        for (size_t i = 0; ok && i < samples.size(); i++) {
+            ok = samples[i].time == crashTime(i) && samples[i].value == crashValue(i);
+        }
+        printf("crash %d: %zu readings recovered, %s\n", round, samples.size(), ok ? "contiguous" : "BROKEN");
+        contiguous = contiguous && ok;
+        grew = grew && samples.size() > known;
+        known = samples.size();
+    }
+    ptyCheck(contiguous, "every reopen recovers a contiguous prefix");
+    ptyCheck(grew, "each writer continues where the recovered column ends");
+
+    if (system((std::string("rm -rf ") + base).c_str()) != 0) {
+        printf("could not remove %s\n", base);
+    }
+    return ptyResult();
+}
@@ -0,0 +1,94 @@
+/*
+ * WeatherBusLitePoller over the epoll and io_uring transports.
+ *
+ * Sweeps 1 and 64 pseudo-terminal buses, whose node answers at once, from
+ * one thread for 1 s with each transport, and prints readings per second,
+ * system calls per reading and the polling thread's CPU per reading. When
+ * the kernel has no io_uring, create() falls back to epoll and only the
+ * epoll figures mean anything.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "PtyTest.h"
+#include "WeatherBusLitePoller.h"
+#include "WeatherBusLiteTransport.h"
+
+#define SECONDS 1
+
+struct Run {
+    std::string transport;
+    double readingsPerSecond;
+    double callsPerReading;
+    double cpuPerReading;  // us, polling thread only
+    uint64_t readings;
+    uint64_t failed;
+};
+
+static double threadCpuSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static Run run(bool uring, int buses) {
+    PtyNodes nodes(buses, 0);
+    usleep(10000);
+    WeatherBusLiteTransport *transport = WeatherBusLiteTransport::create(uring);
+    uint64_t ok = 0, failed = 0;
+    WeatherBusLitePoller poller(*transport, [&](const WeatherBusLiteHostReading &reading) {
+        if (reading.ok) {
+            ok++;
+        } else {
+            failed++;
+        }
+    });
+    for (int i = 0; i < buses; i++) {
+        poller.addBus(nodes.slaves[i], "THPW");
+    }
+    uint64_t end = weatherBusLiteNanos() + 200000000ULL;  // Warm up
+    while (weatherBusLiteNanos() < end) {
+        poller.poll(10);
+    }
+
+    ok = failed = 0;
+    uint64_t calls = transport->systemCalls();
+    double cpu = threadCpuSeconds();
+    uint64_t start = weatherBusLiteNanos();
+    end = start + SECONDS * 1000000000ULL;
+    while (weatherBusLiteNanos() < end) {
+        poller.poll(10);
+    }
+    double elapsed = (weatherBusLiteNanos() - start) / 1e9;
+
+    Run result;
+    result.transport = transport->name();
+    result.readingsPerSecond = ok / elapsed;
+    result.callsPerReading = ok > 0 ? (double)(transport->systemCalls() - calls) / ok : 0;
+    result.cpuPerReading = ok > 0 ? (threadCpuSeconds() - cpu) * 1e6 / ok : 0;
+    result.readings = ok;
+    result.failed = failed;
+    delete transport;
+    return result;
+}
+
+int main() {
+    const int sizes[] = {1, 64};
+    for (int buses : sizes) {
+        Run epoll = run(false, buses);
+        Run uring = run(true, buses);
+        for (const Run *r : {&epoll, &uring}) {
+            printf("%3d buses  %-8s %7.0f readings/s, %.2f system calls and %.1f us CPU per reading\n", buses,
+                   r->transport.c_str(), r->readingsPerSecond, r->callsPerReading, r->cpuPerReading);
+            ptyCheck(r->readings > 0 && r->failed == 0, "every query answered");
+        }
+        if (uring.transport == "epoll") {
+            printf("%3d buses  no io_uring on this kernel\n", buses);
+        } else if (buses > 1) {
+            ptyCheck(uring.callsPerReading < epoll.callsPerReading / 2,
+                     "io_uring batches the system calls of many buses");
+        }
+    }
+    return ptyResult();
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Build and run the host tests and benchmarks.
+#
+#   ./run.sh                every harness
+#   ./run.sh TendencyTest   only the named ones
+#
+# Harnesses in this directory run the library against the simulated bus of
+# HostTest.h; those in linux/ run the Linux host build against simulated
+# nodes on pseudo-terminals. Binaries go to $BUILD.
+
+cd "$(dirname "$0")" || exit 1
+BUILD=${BUILD:-/tmp/weatherbuslite-tests}
+CXX=${CXX:-g++}
+mkdir -p "$BUILD/library" "$BUILD/linux" || exit 1
+
+# The library, built once against the stubs
+for source in ../../src/*.cpp HostTest.cpp; do
+    object="$BUILD/library/$(basename "$source" .cpp).o"
+    $CXX -std=gnu++11 -O2 -Wall -Istubs -I. -I../../src -c "$source" -o "$object" || exit 1
+done
+
+# The Linux host build, with the protocol sources it shares with the library
+for source in ../linux/*.cpp ../../src/WeatherBusLiteDecoder.cpp ../../src/WeatherBusLiteCrc.cpp; do
+    object="$BUILD/linux/$(basename "$source" .cpp).o"
+    $CXX -std=c++20 -O2 -Wall -pthread -I../linux -I../../src -c "$source" -o "$object" || exit 1
+done
+
+failed=""
+for test in *.cpp linux/*.cpp; do
+    name=$(basename "$test" .cpp)
+    if [ "$name" = HostTest ] || [ "$name" = "*" ]; then
+        continue
+    fi
+    if [ $# -gt 0 ] && ! echo " $* " | grep -q " $name "; then
+        continue
+    fi
+    echo "== $name"
+    case "$test" in
+        linux/*)
+            $CXX -std=c++20 -O2 -Wall -pthread -Ilinux -I../linux -I../../src "$test" "$BUILD"/linux/*.o \
+                -lutil -o "$BUILD/$name" ;;
+        *)
+            $CXX -std=gnu++11 -O2 -Wall -Istubs -I. -I../../src "$test" "$BUILD"/library/*.o -o "$BUILD/$name" ;;
+    esac || { failed="$failed $name"; continue; }
+    "$BUILD/$name" || failed="$failed $name"
+done
+
+if [ -n "$failed" ]; then
+    echo "failed:$failed"
+    exit 1
+fi
+echo "all passed"
@@ -0,0 +1,26 @@
+#ifndef ARDUINO_RS485_H
+#define ARDUINO_RS485_H
+
+// RS485 on the simulated bus of HostTest.h.
+
+#include <Arduino.h>
+
+class RS485Class : public Stream {
+public:
+    void begin(unsigned long baudRate);
+    void end();
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    using Print::write;
+    void flush();
+    void beginTransmission();
+    void endTransmission();
+    void receive();
+    void noReceive();
+};
+
+extern RS485Class RS485;
+
+#endif
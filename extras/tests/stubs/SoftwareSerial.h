@@ -0,0 +1,6 @@
+#ifndef SOFTWARE_SERIAL_H
+#define SOFTWARE_SERIAL_H
+
+// Included by WeatherBusLite.h but not used.
+
+#endif
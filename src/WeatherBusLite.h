@@ -5,32 +5,133 @@
 #include <ArduinoRS485.h>
 #include <SoftwareSerial.h> 
 
+#include "WeatherBusLiteCalibration.h"
+#include "WeatherBusLiteClock.h"
+#include "WeatherBusLiteDecoder.h"
+#include "WeatherBusLiteFilter.h"
+#include "WeatherBusLiteFrame.h"
+#include "WeatherBusLiteHistory.h"
+#include "WeatherBusLiteSketch.h"
+
 
 // timings
 #define WEATHERBUSLITE_BAUDRATE 9600
 #define WEATHERBUSLITE_RESPONSE_TIMEOUT 1000
 #define WEATHERBUSLITE_GRACE 2
+#define WEATHERBUSLITE_ECHO_TIMEOUT 5
+
+// number of sensor types that can have per-sensor settings attached
+#define WEATHERBUSLITE_MAX_SENSORS 10
+
+// quality flags a node may report with a reading (",!<hex>" field)
+#define WEATHERBUSLITE_FLAG_SATURATED 0x01  // Sensor at the end of its range
+#define WEATHERBUSLITE_FLAG_HEATER 0x02     // Heater on, e.g. humidity sensor drying
+#define WEATHERBUSLITE_FLAG_ESTIMATED 0x04  // Interpolated or held, not measured
+#define WEATHERBUSLITE_FLAG_WARMUP 0x08     // Sensor still settling after power up
+#define WEATHERBUSLITE_FLAG_FAULT 0x10      // Sensor reported an error
+
+// protocol profiles, so nodes with old and new firmware can share the bus
+#define WEATHERBUSLITE_PROFILE_DEFAULT 0      // Follow setFrameStart
+#define WEATHERBUSLITE_PROFILE_LEGACY 1       // ?T  /  T:value
+#define WEATHERBUSLITE_PROFILE_MARKED 2       // ?T  /  <STX>T:value
+#define WEATHERBUSLITE_PROFILE_CHECKSUMMED 3  // <STX>?T  /  <STX>T:value*<crc>
 
 class WeatherBusLite {
 public:
     WeatherBusLite();
 
-    void begin(uint32_t baudRate = 9600);
+    void begin(uint32_t baudRate = 9600, const WeatherBusLiteCalibration *calibrations = nullptr,
+               uint8_t calibrationCount = 0);
 
     bool queryTemp(float &temperature);
+    bool queryTemp(float &temperature, uint8_t &flags);
     bool queryHumidity(float &humidity);
+    bool queryHumidity(float &humidity, uint8_t &flags);
     bool queryPressure(float &pressure);
+    bool queryPressure(float &pressure, uint8_t &flags);
     bool queryAirQuality(float &airQuality);
+    bool queryAirQuality(float &airQuality, uint8_t &flags);
     bool queryUV(float &uv);
+    bool queryUV(float &uv, uint8_t &flags);
     bool queryRainfall(float &rainfall);
+    bool queryRainfall(float &rainfall, uint8_t &flags);
     bool queryWindSpeed(float &windSpeed);
+    bool queryWindSpeed(float &windSpeed, uint8_t &flags);
     bool queryWindDirection(float &windDirection);
+    bool queryWindDirection(float &windDirection, uint8_t &flags);
     bool queryCanopyTemperature(float &canopyTemperature);
+    bool queryCanopyTemperature(float &canopyTemperature, uint8_t &flags);
     bool queryCustom(char queryType, float &value);
+    bool queryCustom(char queryType, float &value, uint8_t &flags);
+    bool queryFresh(char queryType, float &value, unsigned long maxAge);
+    bool queryFresh(char queryType, float &value, unsigned long maxAge, uint8_t &flags);
+    bool queryHistory(char queryType, WeatherBusLiteSample *samples, uint8_t max, uint8_t &count);
 
-private:
+    void setLatencySketch(WeatherBusLiteSketch *sketch);
+    bool setValueSketch(char queryType, WeatherBusLiteSketch *sketch);
+    bool setFilter(char queryType, WeatherBusLiteFilter *filter);
+    void setEchoSuppression(bool enabled);
+    void setFrameStart(char marker);
+    bool setProfile(char queryType, uint8_t profile);
+    uint8_t profile(char queryType);
+    bool upgradeProfile(char queryType);
+
+    void broadcastTime();
+    bool lastSampleTime(unsigned long &time) const;
+    bool nextSampleDue(char queryType, unsigned long &time);
+
+    // Low level framing, used by the protocol extensions
     void sendQuery(const char* query);
-    bool parseResponse(char expectedType, float &value);
+    int readFrame(char expectedType, char *frame, size_t size);
+
+private:
+    typedef int (WeatherBusLite::*FrameReader)(char expectedType, char *frame, size_t size);
+
+    struct Profile {
+        FrameReader read;
+        bool markedQuery;  // Queries start with the marker
+    };
+
+    struct Sensor {
+        char type;
+        const WeatherBusLiteCalibration *calibration;
+        WeatherBusLiteSketch *sketch;
+        WeatherBusLiteFilter *filter;
+        uint8_t historyReceived;  // Samples to acknowledge with the next bulk request
+
+        // last accepted reading, for queryFresh
+        float cached;
+        uint8_t cachedFlags;
+        unsigned long cachedTime;  // Sample time
+        unsigned long nextSample;  // When the node expects to sample again
+        bool cacheValid;
+        bool nextSampleKnown;
+
+        uint8_t profile;
+    };
+
+    bool parseResponse(char expectedType, float &value, uint8_t &flags);
+    void discardEcho(const char *query, bool marked);
+    int readPlainFrame(char expectedType, char *frame, size_t size);
+    int readMarkedFrame(char expectedType, char *frame, size_t size);
+    int readChecksummedFrame(char expectedType, char *frame, size_t size);
+    const Profile &profileFor(char type);
+    bool acceptReading(char type, float &value);
+    Sensor *findSensor(char type, bool create);
+
+    Sensor _sensors[WEATHERBUSLITE_MAX_SENSORS];
+    uint8_t _sensorCount;
+    WeatherBusLiteSketch *_latencySketch;
+    unsigned long _queryStart;
+    uint32_t _baudRate;
+    bool _echoSuppression;
+    char _frameStart;
+    uint8_t _defaultProfile;
+    static const Profile _profiles[];
+
+    // optional fields of the last response
+    WeatherBusLiteFields _fields;
+    unsigned long _responseTime;
 };
 
 #endif
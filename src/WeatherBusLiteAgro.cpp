@@ -0,0 +1,240 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteAgro.h"
+
+#include <math.h>
+
+// longest gap (s) bridged by interpolation; longer gaps are left out of the integrals
+#define WEATHERBUSLITE_AGRO_MAX_GAP 3600.0f
+
+// erythemally weighted irradiance of one UV index step (W/m2)
+#define WEATHERBUSLITE_UV_INDEX_IRRADIANCE 0.025f
+
+// Constructor
+WeatherBusLiteAgro::WeatherBusLiteAgro(float latitude, float altitude)
+    : _latitude(latitude * (float)M_PI / 180.0f), _altitude(altitude), _lastUpdate(0) {
+    reset();
+}
+
+/**
+ * Add a set of readings.
+ *
+ * Pass NAN for any reading whose query failed; the interval around it is
+ * then left out of that quantity only.
+ *
+ * @param temperature Air temperature in degrees Celsius (queryTemp)
+ * @param humidity Relative humidity in percentage (queryHumidity)
+ * @param windSpeed Wind speed in m/s (queryWindSpeed)
+ * @param uv UV index (queryUV)
+ * @param canopyTemperature Canopy temperature in degrees Celsius (queryCanopyTemperature)
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteAgro::update(float temperature, float humidity, float windSpeed, float uv,
+                                float canopyTemperature, unsigned long now) {
+    float dt = _samples > 0 ? (now - _lastUpdate) / 1000.0f : 0.0f;
+    if (dt > WEATHERBUSLITE_AGRO_MAX_GAP) {
+        dt = 0.0f;
+    }
+    _lastUpdate = now;
+    _samples++;
+
+    if (!isnan(temperature)) {
+        if (temperature < _minTemp) {
+            _minTemp = temperature;
+        }
+        if (temperature > _maxTemp) {
+            _maxTemp = temperature;
+        }
+    }
+
+    float clipped = temperature;
+    if (clipped < WEATHERBUSLITE_AGRO_BASE_TEMP) {
+        clipped = WEATHERBUSLITE_AGRO_BASE_TEMP;
+    } else if (clipped > WEATHERBUSLITE_AGRO_UPPER_TEMP) {
+        clipped = WEATHERBUSLITE_AGRO_UPPER_TEMP;
+    }
+
+    integrate(TEMP, temperature, dt);
+    integrate(HUMIDITY, humidity, dt);
+    integrate(WIND, windSpeed, dt);
+    integrate(UV, uv, dt);
+    integrate(CANOPY_DELTA, canopyTemperature - temperature, dt);
+    integrate(DEGREES, clipped - WEATHERBUSLITE_AGRO_BASE_TEMP, dt);  // NAN propagates
+}
+
+/**
+ * Close the current day.
+ *
+ * Fills in the daily record and starts a new day. The readings at the day
+ * boundary should be added before calling this so they count in both days.
+ *
+ * @param dayOfYear Day of year of the day being closed, 1 to 366
+ * @param record The daily record
+ * @return True if the day had enough data for a record, false otherwise
+ */
+bool WeatherBusLiteAgro::closeDay(uint16_t dayOfYear, WeatherBusLiteDailyRecord &record) {
+    bool valid = _duration[TEMP] > 0.0f;
+
+    record.dayOfYear = dayOfYear;
+    record.samples = _samples;
+    record.minTemp = valid ? _minTemp : NAN;
+    record.maxTemp = valid ? _maxTemp : NAN;
+    record.meanTemp = mean(TEMP);
+    record.meanHumidity = mean(HUMIDITY);
+    record.meanWindSpeed = mean(WIND);
+    record.meanCanopyDelta = mean(CANOPY_DELTA);
+    record.degreeDays = mean(DEGREES);
+    record.uvDose = _integral[UV] * WEATHERBUSLITE_UV_INDEX_IRRADIANCE;
+    record.evapotranspiration = referenceEvapotranspiration(dayOfYear, record.minTemp, record.maxTemp,
+                                                            record.meanHumidity, record.meanWindSpeed);
+
+    // Carry the boundary readings over so the next day integrates from them
+    float previous[QUANTITIES];
+    for (uint8_t i = 0; i < QUANTITIES; i++) {
+        previous[i] = _previous[i];
+    }
+    bool carry = _samples > 0;
+    reset();
+    if (carry) {
+        for (uint8_t i = 0; i < QUANTITIES; i++) {
+            _previous[i] = previous[i];
+        }
+        if (!isnan(previous[TEMP])) {
+            _minTemp = previous[TEMP];
+            _maxTemp = previous[TEMP];
+        }
+        _samples = 1;
+    }
+
+    return valid;
+}
+
+/**
+ * Reset the accumulators.
+ */
+void WeatherBusLiteAgro::reset() {
+    for (uint8_t i = 0; i < QUANTITIES; i++) {
+        _previous[i] = NAN;
+        _integral[i] = 0.0f;
+        _duration[i] = 0.0f;
+    }
+    _minTemp = INFINITY;
+    _maxTemp = -INFINITY;
+    _samples = 0;
+}
+
+/**
+ * Integrate one quantity.
+ *
+ * Adds the trapezoid between the previous and the current value.
+ *
+ * @param quantity The quantity to integrate
+ * @param value The current value, NAN if missing
+ * @param dt Seconds since the previous value
+ */
+void WeatherBusLiteAgro::integrate(uint8_t quantity, float value, float dt) {
+    if (!isnan(value) && !isnan(_previous[quantity]) && dt > 0.0f) {
+        _integral[quantity] += (_previous[quantity] + value) * 0.5f * dt;
+        _duration[quantity] += dt;
+    }
+    _previous[quantity] = value;
+}
+
+/**
+ * Time weighted mean of a quantity.
+ *
+ * @param quantity The quantity
+ * @return The mean, NAN if nothing was integrated
+ */
+float WeatherBusLiteAgro::mean(uint8_t quantity) const {
+    if (_duration[quantity] <= 0.0f) {
+        return NAN;
+    }
+    return _integral[quantity] / _duration[quantity];
+}
+
+/**
+ * FAO-56 reference evapotranspiration.
+ *
+ * Daily Penman-Monteith equation (FAO-56 eq. 6) for the grass reference
+ * crop. Solar radiation is estimated from the temperature range with the
+ * Hargreaves radiation formula (eq. 50) since the station has no pyranometer.
+ *
+ * @param dayOfYear Day of year, 1 to 366
+ * @param minTemp Daily minimum temperature in degrees Celsius
+ * @param maxTemp Daily maximum temperature in degrees Celsius
+ * @param humidity Mean relative humidity in percentage
+ * @param windSpeed Mean wind speed at WEATHERBUSLITE_AGRO_WIND_HEIGHT in m/s
+ * @return ET0 in mm/day, NAN if an input is missing
+ */
+float WeatherBusLiteAgro::referenceEvapotranspiration(uint16_t dayOfYear, float minTemp, float maxTemp,
+                                                      float humidity, float windSpeed) const {
+    if (isnan(minTemp) || isnan(maxTemp) || isnan(humidity) || isnan(windSpeed)) {
+        return NAN;
+    }
+
+    // Extraterrestrial radiation, eq. 21-25 (MJ/m2/day)
+    float angle = 2.0f * (float)M_PI * dayOfYear / 365.0f;
+    float inverseDistance = 1.0f + 0.033f * cosf(angle);
+    float declination = 0.409f * sinf(angle - 1.39f);
+    float sunsetCosine = -tanf(_latitude) * tanf(declination);
+    if (sunsetCosine < -1.0f) {
+        sunsetCosine = -1.0f;  // Polar day
+    } else if (sunsetCosine > 1.0f) {
+        sunsetCosine = 1.0f;   // Polar night
+    }
+    float sunset = acosf(sunsetCosine);
+    float ra = 37.586f * inverseDistance * (sunset * sinf(_latitude) * sinf(declination)
+               + cosf(_latitude) * cosf(declination) * sinf(sunset));
+
+    // Net radiation, eq. 37-40 and 50
+    float range = maxTemp > minTemp ? maxTemp - minTemp : 0.0f;
+    float rs = WEATHERBUSLITE_AGRO_KRS * sqrtf(range) * ra;
+    float rso = (0.75f + 2e-5f * _altitude) * ra;
+    float relativeRs = rso > 0.0f ? rs / rso : 0.0f;
+    if (relativeRs > 1.0f) {
+        relativeRs = 1.0f;
+    }
+
+    float minVapour = 0.6108f * expf(17.27f * minTemp / (minTemp + 237.3f));
+    float maxVapour = 0.6108f * expf(17.27f * maxTemp / (maxTemp + 237.3f));
+    float es = (minVapour + maxVapour) * 0.5f;
+    float ea = es * humidity * 0.01f;
+
+    float minK = minTemp + 273.16f;
+    float maxK = maxTemp + 273.16f;
+    float rnl = 4.903e-9f * (minK * minK * minK * minK + maxK * maxK * maxK * maxK) * 0.5f
+                * (0.34f - 0.14f * sqrtf(ea)) * (1.35f * relativeRs - 0.35f);
+    float rn = 0.77f * rs - rnl;
+
+    // Psychrometric constant and vapour pressure slope, eq. 7, 8 and 13
+    float pressure = 101.3f * powf((293.0f - 0.0065f * _altitude) / 293.0f, 5.26f);
+    float gamma = 0.665e-3f * pressure;
+    float meanTemp = (minTemp + maxTemp) * 0.5f;
+    float meanVapour = 0.6108f * expf(17.27f * meanTemp / (meanTemp + 237.3f));
+    float delta = 4098.0f * meanVapour / ((meanTemp + 237.3f) * (meanTemp + 237.3f));
+
+    // Wind speed at 2 m, eq. 47
+    float u2 = windSpeed * 4.87f / logf(67.8f * WEATHERBUSLITE_AGRO_WIND_HEIGHT - 5.42f);
+
+    float et0 = (0.408f * delta * rn + gamma * 900.0f / (meanTemp + 273.0f) * u2 * (es - ea))
+                / (delta + gamma * (1.0f + 0.34f * u2));
+    return et0 > 0.0f ? et0 : 0.0f;
+}
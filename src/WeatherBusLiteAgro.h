@@ -0,0 +1,61 @@
+#ifndef WEATHERBUSLITE_AGRO_H
+#define WEATHERBUSLITE_AGRO_H
+
+#include <stdint.h>
+
+// growing degree day thresholds (C)
+#define WEATHERBUSLITE_AGRO_BASE_TEMP 10.0f
+#define WEATHERBUSLITE_AGRO_UPPER_TEMP 30.0f
+
+// anemometer height (m) and Hargreaves radiation coefficient (0.16 inland, 0.19 coastal)
+#define WEATHERBUSLITE_AGRO_WIND_HEIGHT 2.0f
+#define WEATHERBUSLITE_AGRO_KRS 0.16f
+
+// Daily summary uplinked in place of the raw samples.
+struct WeatherBusLiteDailyRecord {
+    uint16_t dayOfYear;
+    uint32_t samples;          // A day at 1 Hz is 86400
+    float minTemp;             // C
+    float maxTemp;             // C
+    float meanTemp;            // C
+    float meanHumidity;        // %
+    float meanWindSpeed;       // m/s
+    float meanCanopyDelta;     // Canopy minus air temperature, C
+    float evapotranspiration;  // FAO-56 reference ET0, mm
+    float degreeDays;          // Growing degree days, C day
+    float uvDose;              // Erythemal UV dose, J/m2
+};
+
+// Integrates readings over the day in fixed memory. Every quantity is a time
+// weighted trapezoidal integral, so irregular polling does not bias the means.
+class WeatherBusLiteAgro {
+public:
+    WeatherBusLiteAgro(float latitude, float altitude = 0.0f);
+
+    void update(float temperature, float humidity, float windSpeed, float uv,
+                float canopyTemperature, unsigned long now);
+    bool closeDay(uint16_t dayOfYear, WeatherBusLiteDailyRecord &record);
+
+private:
+    enum Quantity { TEMP, HUMIDITY, WIND, UV, CANOPY_DELTA, DEGREES, QUANTITIES };
+
+    void reset();
+    void integrate(uint8_t quantity, float value, float dt);
+    float mean(uint8_t quantity) const;
+    float referenceEvapotranspiration(uint16_t dayOfYear, float minTemp, float maxTemp,
+                                      float humidity, float windSpeed) const;
+
+    float _latitude;  // Radians
+    float _altitude;
+
+    float _previous[QUANTITIES];  // Last value, NAN if missing
+    float _integral[QUANTITIES];  // Value seconds
+    float _duration[QUANTITIES];  // Seconds integrated
+
+    float _minTemp;
+    float _maxTemp;
+    uint32_t _samples;
+    unsigned long _lastUpdate;
+};
+
+#endif
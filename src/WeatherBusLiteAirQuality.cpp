@@ -0,0 +1,281 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteAirQuality.h"
+
+#include <math.h>
+
+#define MINUTE_MS 60000UL
+
+struct Breakpoint {
+    float concentration;
+    float index;
+};
+
+// US EPA PM2.5 breakpoints (ug/m3, 24 hour), 2024 revision
+static const Breakpoint breakpoints[] = {
+    {0.0f, 0.0f},
+    {9.0f, 50.0f},
+    {35.4f, 100.0f},
+    {55.4f, 150.0f},
+    {125.4f, 200.0f},
+    {225.4f, 300.0f},
+    {325.4f, 500.0f}
+};
+
+/**
+ * Interpolate between the breakpoints, in either direction.
+ *
+ * @param value Concentration in ug/m3, or an index if fromIndex
+ * @param fromIndex True to convert an index to a concentration
+ * @return The index, or the concentration if fromIndex; clamped to the table
+ */
+static float convert(float value, bool fromIndex) {
+    const uint8_t count = sizeof(breakpoints) / sizeof(breakpoints[0]);
+    if (value <= 0.0f) {
+        return 0.0f;
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        const Breakpoint &low = breakpoints[i - 1];
+        const Breakpoint &high = breakpoints[i];
+        float x0 = fromIndex ? low.index : low.concentration;
+        float x1 = fromIndex ? high.index : high.concentration;
+        float y0 = fromIndex ? low.concentration : low.index;
+        float y1 = fromIndex ? high.concentration : high.index;
+        if (value <= x1) {
+            return y0 + (value - x0) * (y1 - y0) / (x1 - x0);
+        }
+    }
+    return fromIndex ? breakpoints[count - 1].concentration : breakpoints[count - 1].index;
+}
+
+// Constructor
+WeatherBusLiteAirQuality::WeatherBusLiteAirQuality() {
+    reset();
+}
+
+/**
+ * Reset all windows.
+ */
+void WeatherBusLiteAirQuality::reset() {
+    for (uint8_t i = 0; i < WEATHERBUSLITE_AQI_MINUTES; i++) {
+        _minuteSum[i] = 0.0f;
+        _minuteCount[i] = 0;
+    }
+    for (uint8_t i = 0; i < WEATHERBUSLITE_AQI_HOURS; i++) {
+        _hourMean[i] = NAN;
+    }
+    _minute = 0;
+    _minutesElapsed = 0;
+    _windowSum = 0.0f;
+    _windowCount = 0;
+    _hour = 0;
+    _hourSum = 0.0f;
+    _hourCount = 0;
+    _sum8 = 0.0f;
+    _sum24 = 0.0f;
+    _valid8 = 0;
+    _valid24 = 0;
+    _started = false;
+    _minuteStart = 0;
+}
+
+/**
+ * Add a reading.
+ *
+ * Advances the buckets to the current time first. An outage longer than the
+ * 24 hour window simply resets everything.
+ *
+ * @param concentration PM2.5 in ug/m3, not the index from queryAirQuality
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteAirQuality::update(float concentration, unsigned long now) {
+    if (!_started) {
+        _started = true;
+        _minuteStart = now;
+    } else if (now - _minuteStart >= WEATHERBUSLITE_AQI_HOURS * 60UL * MINUTE_MS) {
+        reset();
+        _started = true;
+        _minuteStart = now;
+    }
+
+    while (now - _minuteStart >= MINUTE_MS) {
+        _minuteStart += MINUTE_MS;
+        advanceMinute();
+    }
+
+    if (isnan(concentration) || _minuteCount[_minute] == UINT8_MAX) {
+        return;
+    }
+    _minuteSum[_minute] += concentration;
+    _minuteCount[_minute]++;
+    _windowSum += concentration;
+    _windowCount++;
+    _hourSum += concentration;
+    _hourCount++;
+}
+
+/**
+ * Add a reading from queryAirQuality.
+ *
+ * Converts the US EPA PM2.5 index back to a concentration and adds that.
+ * An index above 500 is taken as 500, the top of the table.
+ *
+ * @param aqi Air quality index, NAN if the query failed
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteAirQuality::updateIndex(float aqi, unsigned long now) {
+    update(isnan(aqi) ? NAN : convert(aqi, true), now);
+}
+
+/**
+ * Rolling 1 hour mean.
+ *
+ * @param mean Mean over the last 60 minutes
+ * @return True if there is any data in the window, false otherwise
+ */
+bool WeatherBusLiteAirQuality::hourlyMean(float &mean) const {
+    if (_windowCount == 0) {
+        return false;
+    }
+    mean = _windowSum / _windowCount;
+    return true;
+}
+
+/**
+ * Rolling 8 hour mean.
+ *
+ * Mean of the last 8 complete hourly means.
+ *
+ * @param mean The mean
+ * @return True if enough hours are valid, false otherwise
+ */
+bool WeatherBusLiteAirQuality::eightHourMean(float &mean) const {
+    if (_valid8 == 0 || _valid8 * 100 < 8 * WEATHERBUSLITE_AQI_COMPLETENESS) {
+        return false;
+    }
+    mean = _sum8 / _valid8;
+    return true;
+}
+
+/**
+ * Rolling 24 hour mean.
+ *
+ * Mean of the last 24 complete hourly means.
+ *
+ * @param mean The mean
+ * @return True if enough hours are valid, false otherwise
+ */
+bool WeatherBusLiteAirQuality::dailyMean(float &mean) const {
+    if (_valid24 == 0 || _valid24 * 100 < WEATHERBUSLITE_AQI_HOURS * WEATHERBUSLITE_AQI_COMPLETENESS) {
+        return false;
+    }
+    mean = _sum24 / _valid24;
+    return true;
+}
+
+/**
+ * Air quality index.
+ *
+ * Interpolates the 24 hour mean between the US EPA PM2.5 breakpoints.
+ *
+ * @param aqi Air quality index, 0 to 500
+ * @return True if the 24 hour mean is available, false otherwise
+ */
+bool WeatherBusLiteAirQuality::index(float &aqi) const {
+    float mean;
+    if (!dailyMean(mean)) {
+        return false;
+    }
+
+    aqi = convert(mean, false);
+    return true;
+}
+
+/**
+ * Move to the next minute bucket.
+ *
+ * The bucket being reused drops out of the rolling hour. Every 60 minutes
+ * the current hour is closed and the window sum is recomputed from the
+ * buckets so float rounding cannot build up.
+ */
+void WeatherBusLiteAirQuality::advanceMinute() {
+    _minute = (_minute + 1) % WEATHERBUSLITE_AQI_MINUTES;
+    _windowSum -= _minuteSum[_minute];
+    _windowCount -= _minuteCount[_minute];
+    _minuteSum[_minute] = 0.0f;
+    _minuteCount[_minute] = 0;
+
+    if (++_minutesElapsed < WEATHERBUSLITE_AQI_MINUTES) {
+        return;
+    }
+    _minutesElapsed = 0;
+    closeHour();
+
+    _windowSum = 0.0f;
+    for (uint8_t i = 0; i < WEATHERBUSLITE_AQI_MINUTES; i++) {
+        _windowSum += _minuteSum[i];
+    }
+}
+
+/**
+ * Close the current hour.
+ *
+ * Stores the hourly mean and updates the 8 and 24 hour sums with the hours
+ * entering and leaving each window. The sums are recomputed once a day.
+ */
+void WeatherBusLiteAirQuality::closeHour() {
+    float mean = _hourCount > 0 ? _hourSum / _hourCount : NAN;
+    _hourSum = 0.0f;
+    _hourCount = 0;
+
+    _hour = (_hour + 1) % WEATHERBUSLITE_AQI_HOURS;
+    float expired24 = _hourMean[_hour];
+    float expired8 = _hourMean[(_hour + WEATHERBUSLITE_AQI_HOURS - 8) % WEATHERBUSLITE_AQI_HOURS];
+    if (!isnan(expired24)) {
+        _sum24 -= expired24;
+        _valid24--;
+    }
+    if (!isnan(expired8)) {
+        _sum8 -= expired8;
+        _valid8--;
+    }
+
+    _hourMean[_hour] = mean;
+    if (!isnan(mean)) {
+        _sum8 += mean;
+        _valid8++;
+        _sum24 += mean;
+        _valid24++;
+    }
+
+    if (_hour == 0) {
+        _sum8 = 0.0f;
+        _sum24 = 0.0f;
+        for (uint8_t i = 0; i < WEATHERBUSLITE_AQI_HOURS; i++) {
+            float hourMean = _hourMean[(_hour + WEATHERBUSLITE_AQI_HOURS - i) % WEATHERBUSLITE_AQI_HOURS];
+            if (!isnan(hourMean)) {
+                _sum24 += hourMean;
+                if (i < 8) {
+                    _sum8 += hourMean;
+                }
+            }
+        }
+    }
+}
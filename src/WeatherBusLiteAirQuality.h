@@ -0,0 +1,59 @@
+#ifndef WEATHERBUSLITE_AIRQUALITY_H
+#define WEATHERBUSLITE_AIRQUALITY_H
+
+#include <stdint.h>
+
+// bucket layout: one hour of minute buckets rolled into a day of hour buckets
+#define WEATHERBUSLITE_AQI_MINUTES 60
+#define WEATHERBUSLITE_AQI_HOURS 24
+
+// share of valid hours (%) required for the 8 and 24 hour means
+#define WEATHERBUSLITE_AQI_COMPLETENESS 75
+
+// Rolling 1, 8 and 24 hour means of PM2.5 concentration readings, in ug/m3,
+// and the US EPA index of the 24 hour mean. Readings are summed into minute
+// buckets and every complete hour is reduced to a single hourly mean, so
+// memory is fixed and updates are O(1) amortised.
+//
+// Add concentrations with update(), or the US EPA index that queryAirQuality
+// returns with updateIndex(), which converts it back to ug/m3 first: the index
+// is piecewise linear in the concentration, so the conversion is exact below
+// 500, and means of an index would weight the breakpoint segments unevenly.
+class WeatherBusLiteAirQuality {
+public:
+    WeatherBusLiteAirQuality();
+
+    void reset();
+    void update(float concentration, unsigned long now);
+    void updateIndex(float aqi, unsigned long now);
+
+    bool hourlyMean(float &mean) const;
+    bool eightHourMean(float &mean) const;
+    bool dailyMean(float &mean) const;
+    bool index(float &aqi) const;
+
+private:
+    void advanceMinute();
+    void closeHour();
+
+    float _minuteSum[WEATHERBUSLITE_AQI_MINUTES];
+    uint8_t _minuteCount[WEATHERBUSLITE_AQI_MINUTES];
+    uint8_t _minute;         // Current minute bucket
+    uint8_t _minutesElapsed; // Minutes into the current hour
+    float _windowSum;        // Sum over all minute buckets
+    uint16_t _windowCount;
+
+    float _hourMean[WEATHERBUSLITE_AQI_HOURS];  // NAN if the hour had no data
+    uint8_t _hour;           // Most recent hour bucket
+    float _hourSum;          // Current hour
+    uint16_t _hourCount;
+    float _sum8;
+    float _sum24;
+    uint8_t _valid8;
+    uint8_t _valid24;
+
+    bool _started;
+    unsigned long _minuteStart;
+};
+
+#endif
@@ -0,0 +1,577 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteBlock.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteCrc.h"
+
+static const char base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * Value of a base64 digit.
+ *
+ * @param c The character
+ * @return The value, -1 if c is not a base64 digit
+ */
+static int8_t base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    }
+    if (c == '+') {
+        return 62;
+    }
+    if (c == '/') {
+        return 63;
+    }
+    return -1;
+}
+
+/**
+ * Encode bytes as base64 without padding.
+ *
+ * @param data The bytes
+ * @param length Number of bytes
+ * @param out Output, at least 4 characters per 3 bytes rounded up
+ * @return Number of characters written
+ */
+static size_t base64Encode(const uint8_t *data, size_t length, char *out) {
+    size_t pos = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (i + 1 < length) {
+            group |= (uint32_t)data[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            group |= data[i + 2];
+        }
+        uint8_t digits = length - i >= 3 ? 4 : length - i + 1;
+        for (uint8_t d = 0; d < digits; d++) {
+            out[pos++] = base64Digits[(group >> (18 - 6 * d)) & 0x3F];
+        }
+    }
+    return pos;
+}
+
+/**
+ * Decode base64 without padding.
+ *
+ * @param in The characters, ending at the first non-base64 character
+ * @param data Output buffer
+ * @param size Size of the output buffer
+ * @param end Set to the first character after the encoded data
+ * @return Number of bytes decoded, -1 if the input is malformed or too long
+ */
+static int base64Decode(const char *in, uint8_t *data, size_t size, const char *&end) {
+    size_t length = 0;
+    uint32_t group = 0;
+    uint8_t digits = 0;
+    int8_t value;
+    while ((value = base64Value(*in)) >= 0) {
+        group = (group << 6) | value;
+        in++;
+        if (++digits == 4) {
+            if (length + 3 > size) {
+                return -1;
+            }
+            data[length++] = group >> 16;
+            data[length++] = group >> 8;
+            data[length++] = group;
+            group = 0;
+            digits = 0;
+        }
+    }
+    end = in;
+
+    // A trailing group of 2 or 3 digits carries 1 or 2 bytes
+    if (digits == 1 || length + digits - 1 > size) {
+        return digits == 0 ? (int)length : -1;
+    }
+    group <<= 6 * (4 - digits);
+    for (uint8_t i = 0; i + 1 < digits; i++) {
+        data[length++] = group >> (16 - 8 * i);
+    }
+    return length;
+}
+
+/**
+ * Prepare the storage for a transfer.
+ *
+ * The default does nothing; flash sinks erase the region here.
+ *
+ * @param length Size of the transfer in bytes
+ * @return True if the storage is ready, false otherwise
+ */
+bool WeatherBusLiteBlockSink::begin(uint32_t length) {
+    (void)length;
+    return true;
+}
+
+/**
+ * Constructor.
+ *
+ * @param buffer The buffer
+ * @param capacity Size of the buffer
+ */
+WeatherBusLiteBufferSink::WeatherBusLiteBufferSink(uint8_t *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity) {}
+
+/**
+ * Prepare for a transfer.
+ *
+ * RAM needs no erasing; this only checks the size.
+ *
+ * @param length Size of the transfer in bytes
+ * @return True if the transfer fits, false otherwise
+ */
+bool WeatherBusLiteBufferSink::begin(uint32_t length) {
+    return length <= _capacity;
+}
+
+/**
+ * Write to the buffer.
+ *
+ * @param offset Offset in the buffer
+ * @param data The data
+ * @param length Number of bytes
+ * @return True if the data fits, false otherwise
+ */
+bool WeatherBusLiteBufferSink::write(uint32_t offset, const uint8_t *data, size_t length) {
+    if (offset + length > _capacity) {
+        return false;
+    }
+    memcpy(_buffer + offset, data, length);
+    return true;
+}
+
+/**
+ * Read from the buffer.
+ *
+ * @param offset Offset in the buffer
+ * @param data Where to copy the data
+ * @param length Number of bytes
+ * @return True if the range is inside the buffer, false otherwise
+ */
+bool WeatherBusLiteBufferSink::read(uint32_t offset, uint8_t *data, size_t length) {
+    if (offset + length > _capacity) {
+        return false;
+    }
+    memcpy(data, _buffer + offset, length);
+    return true;
+}
+
+/**
+ * Constructor.
+ *
+ * @param bus The bus the node is on
+ * @param type The node's sensor type (T, H, etc.)
+ * @param window Blocks sent between acknowledgements, up to
+ *               WEATHERBUSLITE_BLOCK_MAX_WINDOW
+ */
+WeatherBusLiteBlockSender::WeatherBusLiteBlockSender(WeatherBusLite &bus, char type, uint8_t window)
+    : _bus(bus), _type(type), _base(0), _bitmap(0), _blocksSent(0) {
+    if (window < 1) {
+        window = 1;
+    } else if (window > WEATHERBUSLITE_BLOCK_MAX_WINDOW) {
+        window = WEATHERBUSLITE_BLOCK_MAX_WINDOW;
+    }
+    _window = window;
+}
+
+/**
+ * Send a buffer.
+ *
+ * Announces the transfer, then repeatedly sends every block in the window
+ * the node has not acknowledged and polls for an acknowledgement. Calling
+ * it again with the same data after a failure resumes the transfer.
+ *
+ * @param data The data
+ * @param length Number of bytes
+ * @return True if the node received every block, false if it stopped responding
+ */
+bool WeatherBusLiteBlockSender::send(const uint8_t *data, uint32_t length) {
+    uint16_t blocks = (length + WEATHERBUSLITE_BLOCK_SIZE - 1) / WEATHERBUSLITE_BLOCK_SIZE;
+    char start[24];
+    snprintf(start, sizeof(start), "#%cS:%lx,%x", _type, (unsigned long)length,
+             weatherBusLiteCrc16(data, length));
+
+    uint8_t failures = 0;
+    while (!requestAck(start)) {
+        if (++failures > WEATHERBUSLITE_BLOCK_RETRIES) {
+            return false;
+        }
+    }
+
+    char poll[4] = {'?', _type, '#', '\0'};
+    failures = 0;
+    while (_base < blocks) {
+        uint16_t end = _base + _window < blocks ? _base + _window : blocks;
+        for (uint16_t seq = _base; seq < end; seq++) {
+            if (seq == _base || !(_bitmap & (1UL << (seq - _base - 1)))) {
+                sendBlock(data, length, seq);
+            }
+        }
+
+        uint16_t base = _base;
+        uint32_t bitmap = _bitmap;
+        if (!requestAck(poll) || (_base == base && _bitmap == bitmap)) {
+            // No reply or no progress
+            if (++failures > WEATHERBUSLITE_BLOCK_RETRIES) {
+                return false;
+            }
+        } else {
+            failures = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Send a buffer to every node listening on a group type.
+ *
+ * Streams the start frame and every block once without waiting for
+ * acknowledgements. Follow with send() to each node on its own type, which
+ * resumes the transfer and repeats only the blocks that node missed.
+ *
+ * @param data The data
+ * @param length Number of bytes
+ */
+void WeatherBusLiteBlockSender::broadcast(const uint8_t *data, uint32_t length) {
+    uint16_t blocks = (length + WEATHERBUSLITE_BLOCK_SIZE - 1) / WEATHERBUSLITE_BLOCK_SIZE;
+    char start[24];
+    snprintf(start, sizeof(start), "#%cS:%lx,%x", _type, (unsigned long)length,
+             weatherBusLiteCrc16(data, length));
+    _bus.sendQuery(start);
+
+    for (uint16_t seq = 0; seq < blocks; seq++) {
+        sendBlock(data, length, seq);
+    }
+}
+
+/**
+ * Number of block frames sent.
+ *
+ * @return Blocks sent including retransmissions
+ */
+uint32_t WeatherBusLiteBlockSender::blocksSent() const {
+    return _blocksSent;
+}
+
+/**
+ * Send a query answered by an acknowledgement.
+ *
+ * @param query The start frame or poll
+ * @return True if an acknowledgement was received, false otherwise
+ */
+bool WeatherBusLiteBlockSender::requestAck(const char *query) {
+    char response[32];
+    _bus.sendQuery(query);
+    if (_bus.readFrame(_type, response, sizeof(response)) < 0
+        || response[1] != '#' || response[2] != ':') {
+        return false;
+    }
+
+    char *end;
+    unsigned long base = strtoul(response + 3, &end, 16);
+    if (*end != ',') {
+        return false;
+    }
+    _base = base;
+    _bitmap = strtoul(end + 1, nullptr, 16);
+    return true;
+}
+
+/**
+ * Send one block.
+ *
+ * @param data The whole buffer
+ * @param length Size of the whole buffer
+ * @param seq Block number
+ */
+void WeatherBusLiteBlockSender::sendBlock(const uint8_t *data, uint32_t length, uint16_t seq) {
+    uint32_t offset = (uint32_t)seq * WEATHERBUSLITE_BLOCK_SIZE;
+    uint8_t size = length - offset < WEATHERBUSLITE_BLOCK_SIZE ? length - offset : WEATHERBUSLITE_BLOCK_SIZE;
+
+    char frame[(WEATHERBUSLITE_BLOCK_SIZE + 2) / 3 * 4 + 16];
+    int pos = snprintf(frame, sizeof(frame), "#%c%x:", _type, seq);
+    pos += base64Encode(data + offset, size, frame + pos);
+    snprintf(frame + pos, sizeof(frame) - pos, "*%x", weatherBusLiteCrc16(data + offset, size));
+
+    _bus.sendQuery(frame);
+    _blocksSent++;
+}
+
+/**
+ * Constructor.
+ *
+ * @param type This node's sensor type (T, H, etc.)
+ * @param sink Where received blocks are written
+ * @param capacity Largest transfer the sink can hold
+ */
+WeatherBusLiteBlockReceiver::WeatherBusLiteBlockReceiver(char type, WeatherBusLiteBlockSink &sink, uint32_t capacity)
+    : _type(type), _group(0), _sink(sink), _capacity(capacity), _length(0), _crc(0), _base(0), _bitmap(0),
+      _map(nullptr), _mapSize(0), _active(false), _verified(false) {}
+
+/**
+ * Also receive transfers broadcast to a group type.
+ *
+ * @param group The group type, shared by identical nodes
+ */
+void WeatherBusLiteBlockReceiver::setGroup(char group) {
+    _group = group;
+}
+
+/**
+ * Track every block of the transfer instead of only the window.
+ *
+ * Needed for broadcast transfers, where blocks arrive without waiting for
+ * acknowledgements and would otherwise be dropped once a block is missing.
+ * Transfers of more than 8 * size blocks are refused.
+ *
+ * @param map Storage for one bit per block
+ * @param size Size of the storage in bytes
+ */
+void WeatherBusLiteBlockReceiver::setMap(uint8_t *map, size_t size) {
+    _map = map;
+    _mapSize = size;
+    _active = false;
+}
+
+/**
+ * Handle a received line.
+ *
+ * @param line The line, without the newline
+ * @param out Where to write replies, e.g. RS485
+ * @return True if the line belonged to the block protocol, false otherwise
+ */
+bool WeatherBusLiteBlockReceiver::handle(const char *line, Print &out) {
+    if (line[0] == '?' && line[1] == _type && line[2] == '#') {
+        sendAck(out);
+        return true;
+    }
+    if (line[0] != '#' || (line[1] != _type && (_group == 0 || line[1] != _group))) {
+        return false;
+    }
+
+    if (line[2] == 'S' && line[3] == ':') {
+        char *end;
+        uint32_t length = strtoul(line + 4, &end, 16);
+        uint16_t crc = *end == ',' ? strtoul(end + 1, nullptr, 16) : 0;
+        if (!_active || length != _length || crc != _crc) {
+            // New transfer; the same one again resumes
+            _length = length;
+            _crc = crc;
+            restart();
+        }
+        if (line[1] == _type) {
+            sendAck(out);  // Group frames are never acknowledged
+        }
+        return true;
+    }
+
+    char *end;
+    unsigned long seq = strtoul(line + 2, &end, 16);
+    if (end != line + 2 && *end == ':') {
+        receiveBlock(seq, end + 1);
+    }
+    return true;
+}
+
+/**
+ * Check whether the transfer is complete.
+ *
+ * Reads the data back from the sink once to check the CRC of the whole
+ * transfer. If it does not match, the transfer starts over from the first
+ * block, so the next resume sends it again in full.
+ *
+ * @return True if every block was received and the CRC matches, false otherwise
+ */
+bool WeatherBusLiteBlockReceiver::complete() {
+    if (!_active || _base < blockCount()) {
+        return false;
+    }
+    if (_verified) {
+        return true;
+    }
+
+    uint8_t chunk[WEATHERBUSLITE_BLOCK_SIZE];
+    uint16_t crc = 0xFFFF;
+    for (uint32_t offset = 0; offset < _length; offset += WEATHERBUSLITE_BLOCK_SIZE) {
+        size_t size = _length - offset < WEATHERBUSLITE_BLOCK_SIZE ? _length - offset : WEATHERBUSLITE_BLOCK_SIZE;
+        if (!_sink.read(offset, chunk, size)) {
+            return false;
+        }
+        crc = weatherBusLiteCrc16(chunk, size, crc);
+    }
+    _verified = crc == _crc;
+    if (!_verified) {
+        restart();  // Resuming would never repair a block that passed its own CRC
+    }
+    return _verified;
+}
+
+/**
+ * Length of the current transfer.
+ *
+ * @return Length in bytes
+ */
+uint32_t WeatherBusLiteBlockReceiver::length() const {
+    return _length;
+}
+
+/**
+ * CRC of the current transfer, from its start frame.
+ *
+ * @return The CRC-16
+ */
+uint16_t WeatherBusLiteBlockReceiver::crc() const {
+    return _crc;
+}
+
+/**
+ * Start the current transfer over from the first block.
+ *
+ * Prepares the sink and forgets every block received so far. The transfer
+ * stays inactive if it does not fit the sink or the map.
+ */
+void WeatherBusLiteBlockReceiver::restart() {
+    _base = 0;
+    _bitmap = 0;
+    _verified = false;
+    _active = _length <= _capacity && (_map == nullptr || blockCount() <= _mapSize * 8) && _sink.begin(_length);
+    if (_map != nullptr && _active) {
+        memset(_map, 0, (blockCount() + 7) / 8);
+    }
+}
+
+/**
+ * Store a block.
+ *
+ * Blocks failing their CRC, outside the window (unless the whole transfer
+ * is tracked) or already received are dropped; the sender repeats whatever
+ * the acknowledgement is missing.
+ *
+ * @param seq Block number
+ * @param payload Payload in base64 followed by '*' and the CRC
+ */
+void WeatherBusLiteBlockReceiver::receiveBlock(uint16_t seq, const char *payload) {
+    if (!_active || seq < _base || seq >= blockCount()) {
+        return;
+    }
+    if ((_map == nullptr && seq > _base + WEATHERBUSLITE_BLOCK_MAX_WINDOW) || received(seq)) {
+        return;
+    }
+
+    uint8_t data[WEATHERBUSLITE_BLOCK_SIZE];
+    const char *end;
+    int size = base64Decode(payload, data, sizeof(data), end);
+
+    uint32_t offset = (uint32_t)seq * WEATHERBUSLITE_BLOCK_SIZE;
+    uint32_t expected = _length - offset < WEATHERBUSLITE_BLOCK_SIZE ? _length - offset : WEATHERBUSLITE_BLOCK_SIZE;
+    if (size != (int)expected || *end != '*' || strtoul(end + 1, nullptr, 16) != weatherBusLiteCrc16(data, size)) {
+        return;
+    }
+    if (!_sink.write(offset, data, size)) {
+        return;
+    }
+    markReceived(seq);
+}
+
+/**
+ * Check whether a block has been received.
+ *
+ * @param seq Block number, at least the base
+ * @return True if the block is stored, false otherwise
+ */
+bool WeatherBusLiteBlockReceiver::received(uint16_t seq) const {
+    if (_map != nullptr) {
+        return _map[seq >> 3] & (1 << (seq & 7));
+    }
+    return seq > _base && (_bitmap & (1UL << (seq - _base - 1)));
+}
+
+/**
+ * Record a received block and advance the base.
+ *
+ * @param seq Block number, at least the base
+ */
+void WeatherBusLiteBlockReceiver::markReceived(uint16_t seq) {
+    if (_map != nullptr) {
+        _map[seq >> 3] |= 1 << (seq & 7);
+        uint16_t blocks = blockCount();
+        while (_base < blocks && received(_base)) {
+            _base++;
+        }
+        return;
+    }
+
+    if (seq > _base) {
+        _bitmap |= 1UL << (seq - _base - 1);
+        return;
+    }
+
+    // Slide the window past every consecutive received block
+    _base++;
+    bool next;
+    do {
+        next = _bitmap & 1;
+        _bitmap >>= 1;
+        if (next) {
+            _base++;
+        }
+    } while (next);
+}
+
+/**
+ * Send an acknowledgement.
+ *
+ * @param out Where to write it
+ */
+void WeatherBusLiteBlockReceiver::sendAck(Print &out) {
+    if (_map != nullptr) {
+        _bitmap = 0;
+        for (uint8_t i = 0; i < WEATHERBUSLITE_BLOCK_MAX_WINDOW && _base + 1 + i < blockCount(); i++) {
+            if (received(_base + 1 + i)) {
+                _bitmap |= 1UL << i;
+            }
+        }
+    }
+
+    out.print(_type);
+    out.print("#:");
+    out.print((unsigned long)_base, HEX);
+    out.print(',');
+    out.print((unsigned long)_bitmap, HEX);
+    out.println();
+}
+
+/**
+ * Number of blocks in the current transfer.
+ *
+ * @return The block count
+ */
+uint16_t WeatherBusLiteBlockReceiver::blockCount() const {
+    return (_length + WEATHERBUSLITE_BLOCK_SIZE - 1) / WEATHERBUSLITE_BLOCK_SIZE;
+}
@@ -0,0 +1,116 @@
+#ifndef WEATHERBUSLITE_BLOCK_H
+#define WEATHERBUSLITE_BLOCK_H
+
+#include <Arduino.h>
+
+// payload bytes per block; a block frame is 4/3 of this plus up to 16 characters
+#define WEATHERBUSLITE_BLOCK_SIZE 48
+
+// largest window, limited by the 32 bit acknowledgement bitmap
+#define WEATHERBUSLITE_BLOCK_MAX_WINDOW 32
+
+// acknowledgement requests that may fail in a row before giving up
+#define WEATHERBUSLITE_BLOCK_RETRIES 5
+
+class WeatherBusLite;
+
+// Block transfer sub-protocol for payloads larger than a single reading.
+// The master streams numbered blocks and the node acknowledges selectively:
+//
+// Start:   #TS:<length>,<crc>        (node replies with an ack)
+// Block:   #T<seq>:<data>*<crc>      (no reply)
+// Poll:    ?T#                       (node replies with an ack)
+// Ack:     T#:<base>,<bitmap>
+//
+// A transfer can also be broadcast to several nodes listening on a group
+// type: start and block frames sent to the group are never acknowledged,
+// and each node is then polled and repaired on its own type.
+//
+// All numbers are hex. data is the block payload in base64 without padding,
+// crc the CRC-16 of the payload (of the whole transfer in the start frame).
+// base is the first block not yet received and bit i of bitmap is set if
+// block base + 1 + i has been received. Restarting a transfer with the same
+// length and crc resumes it from the node's base.
+
+// Storage the receiver writes blocks into, e.g. RAM or a flash region.
+// begin() is called before the first block of a transfer is written, and
+// again if the transfer fails verification, so flash can be erased.
+class WeatherBusLiteBlockSink {
+public:
+    virtual bool begin(uint32_t length);
+    virtual bool write(uint32_t offset, const uint8_t *data, size_t length) = 0;
+    virtual bool read(uint32_t offset, uint8_t *data, size_t length) = 0;
+};
+
+// Sink backed by a RAM buffer.
+class WeatherBusLiteBufferSink : public WeatherBusLiteBlockSink {
+public:
+    WeatherBusLiteBufferSink(uint8_t *buffer, size_t capacity);
+
+    bool begin(uint32_t length) override;
+    bool write(uint32_t offset, const uint8_t *data, size_t length) override;
+    bool read(uint32_t offset, uint8_t *data, size_t length) override;
+
+private:
+    uint8_t *_buffer;
+    size_t _capacity;
+};
+
+// Master side: sends a buffer to the node with a sliding window.
+class WeatherBusLiteBlockSender {
+public:
+    WeatherBusLiteBlockSender(WeatherBusLite &bus, char type, uint8_t window = 8);
+
+    bool send(const uint8_t *data, uint32_t length);
+    void broadcast(const uint8_t *data, uint32_t length);
+
+    uint32_t blocksSent() const;
+
+private:
+    bool requestAck(const char *query);
+    void sendBlock(const uint8_t *data, uint32_t length, uint16_t seq);
+
+    WeatherBusLite &_bus;
+    char _type;
+    uint8_t _window;
+    uint16_t _base;
+    uint32_t _bitmap;
+    uint32_t _blocksSent;
+};
+
+// Node side: receives a transfer into a sink.
+class WeatherBusLiteBlockReceiver {
+public:
+    WeatherBusLiteBlockReceiver(char type, WeatherBusLiteBlockSink &sink, uint32_t capacity);
+
+    void setGroup(char group);
+    void setMap(uint8_t *map, size_t size);
+
+    bool handle(const char *line, Print &out);
+    bool complete();
+    uint32_t length() const;
+    uint16_t crc() const;
+
+private:
+    void restart();
+    void receiveBlock(uint16_t seq, const char *payload);
+    bool received(uint16_t seq) const;
+    void markReceived(uint16_t seq);
+    void sendAck(Print &out);
+    uint16_t blockCount() const;
+
+    char _type;
+    char _group;
+    WeatherBusLiteBlockSink &_sink;
+    uint32_t _capacity;
+    uint32_t _length;
+    uint16_t _crc;
+    uint16_t _base;
+    uint32_t _bitmap;
+    uint8_t *_map;      // One bit per block of the whole transfer, optional
+    size_t _mapSize;
+    bool _active;
+    bool _verified;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef WEATHERBUSLITE_CALIBRATION_H
+#define WEATHERBUSLITE_CALIBRATION_H
+
+#include <stdint.h>
+
+// fixed point coefficient of the given polynomial degree: degree n is stored
+// with 16 + 8n fractional bits, so it must stay below 2^(15 - 8n) in magnitude
+#define WEATHERBUSLITE_COEFFICIENT(x, degree) \
+    ((int32_t)((x) * (double)(1LL << (16 + 8 * (degree))) + ((x) >= 0 ? 0.5 : -0.5)))
+
+// Q16.16 value, e.g. an offset or a piecewise table point
+#define WEATHERBUSLITE_FIXED(x) WEATHERBUSLITE_COEFFICIENT(x, 0)
+
+enum WeatherBusLiteCalibrationKind {
+    WEATHERBUSLITE_CALIBRATION_LINEAR,     // {offset, gain}, degrees 0 and 1
+    WEATHERBUSLITE_CALIBRATION_CUBIC,      // {c0, c1, c2, c3}, degrees 0 to 3
+    WEATHERBUSLITE_CALIBRATION_PIECEWISE   // {x0, y0, x1, y1, ...} Q16.16, x ascending
+};
+
+// One entry of the calibration table passed to WeatherBusLite::begin.
+// Readings are handled in Q16.16 and must stay within +/-32767 units. For a
+// piecewise table, points is the number of (x, y) pairs; readings outside the
+// table extend its first or last segment.
+struct WeatherBusLiteCalibration {
+    char type;
+    uint8_t kind;
+    uint8_t points;
+    const int32_t *coefficients;
+};
+
+float weatherBusLiteCalibrate(const WeatherBusLiteCalibration &calibration, float value);
+
+#endif
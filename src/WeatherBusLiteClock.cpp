@@ -0,0 +1,129 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteClock.h"
+
+// Constructor
+WeatherBusLiteClock::WeatherBusLiteClock() : _localAnchor(0), _masterAnchor(0), _skew(0), _syncs(0) {}
+
+/**
+ * Handle a received line.
+ *
+ * @param line The line, without the newline
+ * @param now Local time in milliseconds when the line ended
+ * @return True if the line was a time sync broadcast, false otherwise
+ */
+bool WeatherBusLiteClock::handle(const char *line, unsigned long now) {
+    if (line[0] != '!' || line[1] != 'S' || line[2] != ':') {
+        return false;
+    }
+
+    char *end;
+    unsigned long masterTime = strtoul(line + 3, &end, 10);
+    if (end == line + 3) {
+        return false;
+    }
+    sync(masterTime, now);
+    return true;
+}
+
+/**
+ * Apply a time sync.
+ *
+ * The first sync sets the clock. Each later one measures the skew over the
+ * time since the previous sync and folds it into a running average, then
+ * steps the clock to the master time. Syncs that arrive too soon are only
+ * used for the step, and a large error restarts the skew estimate.
+ *
+ * @param masterTime Master time in milliseconds
+ * @param now Local time in milliseconds
+ */
+void WeatherBusLiteClock::sync(unsigned long masterTime, unsigned long now) {
+    unsigned long elapsed = now - _localAnchor;
+    long error = (long)(masterTime - this->masterTime(now));
+
+    if (_syncs == 0 || error > WEATHERBUSLITE_CLOCK_MAX_ERROR || error < -WEATHERBUSLITE_CLOCK_MAX_ERROR) {
+        _skew = 0;
+        _syncs = 0;
+    } else if (elapsed >= WEATHERBUSLITE_CLOCK_MIN_INTERVAL) {
+        int64_t measured = ((int64_t)(long)(masterTime - _masterAnchor) - (int64_t)elapsed) * 1000000000LL
+                           / (int64_t)elapsed;
+        if (_syncs == 1) {
+            _skew = (int32_t)measured;
+        } else {
+            _skew += (int32_t)((measured - _skew) >> WEATHERBUSLITE_CLOCK_SMOOTHING);
+        }
+    } else {
+        // Too close to measure skew; keep the anchor for the next measurement
+        return;
+    }
+
+    _localAnchor = now;
+    _masterAnchor = masterTime;
+    if (_syncs < 255) {
+        _syncs++;
+    }
+}
+
+/**
+ * Check whether the clock has been set.
+ *
+ * @return True after the first sync, false otherwise
+ */
+bool WeatherBusLiteClock::synced() const {
+    return _syncs > 0;
+}
+
+/**
+ * Convert local time to master time.
+ *
+ * @param now Local time in milliseconds
+ * @return Master time in milliseconds, drift compensated
+ */
+unsigned long WeatherBusLiteClock::masterTime(unsigned long now) const {
+    long elapsed = (long)(now - _localAnchor);  // Negative for samples before the last sync
+    int64_t correction = (int64_t)elapsed * _skew / 1000000000LL;
+    return _masterAnchor + (unsigned long)(elapsed + (long)correction);
+}
+
+/**
+ * Estimated skew.
+ *
+ * @return How much faster the master clock runs, in parts per billion
+ */
+long WeatherBusLiteClock::skew() const {
+    return _skew;
+}
+
+/**
+ * Append a sample timestamp to a reply.
+ *
+ * Call after printing the value and before the newline. Nothing is written
+ * until the clock has been synced.
+ *
+ * @param out Where to write, e.g. RS485
+ * @param sampled Local time in milliseconds when the sample was taken
+ */
+void WeatherBusLiteClock::printTimestamp(Print &out, unsigned long sampled) const {
+    if (!synced()) {
+        return;
+    }
+    out.print(",@");
+    out.print(masterTime(sampled));
+}
@@ -0,0 +1,40 @@
+#ifndef WEATHERBUSLITE_CLOCK_H
+#define WEATHERBUSLITE_CLOCK_H
+
+#include <Arduino.h>
+
+// weight of a new skew measurement, as a right shift (2 = 1/4)
+#define WEATHERBUSLITE_CLOCK_SMOOTHING 2
+
+// shortest interval between syncs (ms) used to measure skew
+#define WEATHERBUSLITE_CLOCK_MIN_INTERVAL 10000UL
+
+// phase error (ms) beyond which the clock is stepped and relearned
+#define WEATHERBUSLITE_CLOCK_MAX_ERROR 1000L
+
+// Node-side clock disciplined by the master's time sync broadcast
+// (!S:<master millis>, see WeatherBusLite::broadcastTime). The crystal
+// drift is estimated from successive syncs, so the node keeps master time
+// between broadcasts and can stamp its replies:
+//
+// Reply:   T:23.4,@<master millis when sampled>
+class WeatherBusLiteClock {
+public:
+    WeatherBusLiteClock();
+
+    bool handle(const char *line, unsigned long now);
+    void sync(unsigned long masterTime, unsigned long now);
+
+    bool synced() const;
+    unsigned long masterTime(unsigned long now) const;
+    long skew() const;
+    void printTimestamp(Print &out, unsigned long sampled) const;
+
+private:
+    unsigned long _localAnchor;   // Local time of the last sync
+    unsigned long _masterAnchor;  // Master time of the last sync
+    int32_t _skew;                // Master minus local rate, parts per billion
+    uint8_t _syncs;
+};
+
+#endif
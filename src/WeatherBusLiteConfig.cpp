@@ -0,0 +1,246 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteConfig.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteCrc.h"
+
+/**
+ * Constructor.
+ *
+ * @param bus The bus the node is on
+ * @param type The node's sensor type (T, H, etc.)
+ */
+WeatherBusLiteConfigWriter::WeatherBusLiteConfigWriter(WeatherBusLite &bus, char type)
+    : _bus(bus), _type(type), _count(0) {}
+
+/**
+ * Add a setting to the batch.
+ *
+ * Nothing is sent until commit. Setting the same key twice keeps the last
+ * value.
+ *
+ * @param key The setting's key
+ * @param value The new value
+ * @return True if the setting was added, false if the batch is full
+ */
+bool WeatherBusLiteConfigWriter::set(char key, int32_t value) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_keys[i] == key) {
+            _values[i] = value;
+            return true;
+        }
+    }
+    if (_count >= WEATHERBUSLITE_CONFIG_MAX_SETTINGS) {
+        return false;
+    }
+    _keys[_count] = key;
+    _values[_count] = value;
+    _count++;
+    return true;
+}
+
+/**
+ * Send the batch and apply it on the node.
+ *
+ * The whole batch is resent if the node rejects the commit or does not
+ * answer. The batch is cleared afterwards either way.
+ *
+ * @return True if the node applied every setting, false otherwise
+ */
+bool WeatherBusLiteConfigWriter::commit() {
+    bool applied = false;
+    for (uint8_t attempt = 0; attempt <= WEATHERBUSLITE_CONFIG_RETRIES && !applied; attempt++) {
+        applied = sendBatch();
+    }
+    _count = 0;
+    return applied;
+}
+
+/**
+ * Read back a setting.
+ *
+ * @param key The setting's key
+ * @param value The value the node is using
+ * @return True if the node answered, false otherwise
+ */
+bool WeatherBusLiteConfigWriter::read(char key, int32_t &value) {
+    char query[5] = {'?', _type, '=', key, '\0'};
+    char response[32];
+    _bus.sendQuery(query);
+    if (_bus.readFrame(_type, response, sizeof(response)) < 0
+        || response[1] != '=' || response[2] != ':' || response[3] != key) {
+        return false;
+    }
+
+    char *end;
+    value = strtol(response + 4, &end, 10);
+    return end != response + 4;
+}
+
+/**
+ * Send the set frames and the commit.
+ *
+ * @return True if the node applied the batch, false otherwise
+ */
+bool WeatherBusLiteConfigWriter::sendBatch() {
+    char frame[20];
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < _count; i++) {
+        int length = snprintf(frame, sizeof(frame), "=%c%c%ld", _type, _keys[i], (long)_values[i]);
+        crc = weatherBusLiteCrc16((const uint8_t *)frame + 2, length - 2, crc);
+        _bus.sendQuery(frame);
+    }
+
+    char response[32];
+    snprintf(frame, sizeof(frame), "=%c!%x", _type, crc);
+    _bus.sendQuery(frame);
+    if (_bus.readFrame(_type, response, sizeof(response)) < 0
+        || response[1] != '=' || response[2] != ':') {
+        return false;
+    }
+    return response[3] == '1' && response[4] == ',' && strtoul(response + 5, nullptr, 16) == crc;
+}
+
+/**
+ * Constructor.
+ *
+ * @param type This node's sensor type (T, H, etc.)
+ * @param settings The node's settings; values are changed in place on commit
+ * @param count Number of settings, at most WEATHERBUSLITE_CONFIG_MAX_SETTINGS
+ */
+WeatherBusLiteConfig::WeatherBusLiteConfig(char type, WeatherBusLiteSetting *settings, uint8_t count)
+    : _type(type), _settings(settings),
+      _count(count < WEATHERBUSLITE_CONFIG_MAX_SETTINGS ? count : WEATHERBUSLITE_CONFIG_MAX_SETTINGS),
+      _stagedMask(0), _crc(0xFFFF), _appliedCrc(0), _invalid(false), _changed(false) {}
+
+/**
+ * Handle a received line.
+ *
+ * @param line The line, without the newline
+ * @param out Where to write replies, e.g. RS485
+ * @return True if the line belonged to the config protocol, false otherwise
+ */
+bool WeatherBusLiteConfig::handle(const char *line, Print &out) {
+    if (line[0] == '?' && line[1] == _type && line[2] == '=') {
+        int8_t index = find(line[3]);
+        if (index >= 0) {
+            out.print(_type);
+            out.print("=:");
+            out.print(line[3]);
+            out.print((long)*_settings[index].value);
+            out.println();
+        }
+        return true;
+    }
+    if (line[0] != '=' || line[1] != _type) {
+        return false;
+    }
+
+    if (line[2] == '!') {
+        commit(strtoul(line + 3, nullptr, 16), out);
+    } else {
+        stage(line + 2);
+    }
+    return true;
+}
+
+/**
+ * Check whether a commit changed the settings.
+ *
+ * Returns true once per applied commit, e.g. to restart the sample timer or
+ * save the settings to EEPROM.
+ *
+ * @return True if the settings changed since the last call, false otherwise
+ */
+bool WeatherBusLiteConfig::changed() {
+    bool changed = _changed;
+    _changed = false;
+    return changed;
+}
+
+/**
+ * Stage a write.
+ *
+ * @param text The "<key><value>" part of a set frame
+ */
+void WeatherBusLiteConfig::stage(const char *text) {
+    _crc = weatherBusLiteCrc16((const uint8_t *)text, strlen(text), _crc);
+
+    int8_t index = find(text[0]);
+    char *end;
+    long value = strtol(text + 1, &end, 10);
+    if (index < 0 || end == text + 1 || value < _settings[index].min || value > _settings[index].max) {
+        _invalid = true;
+        return;
+    }
+    _staged[index] = value;
+    _stagedMask |= 1UL << index;
+}
+
+/**
+ * Apply the staged writes if they match the master's batch.
+ *
+ * @param crc The master's CRC of the batch
+ * @param out Where to write the result
+ */
+void WeatherBusLiteConfig::commit(uint16_t crc, Print &out) {
+    bool applied;
+    if (_stagedMask == 0 && !_invalid) {
+        // Nothing staged: a repeat of the last commit, or an empty one
+        applied = crc == _appliedCrc || crc == 0xFFFF;
+    } else {
+        applied = !_invalid && crc == _crc;
+        if (applied) {
+            for (uint8_t i = 0; i < _count; i++) {
+                if (_stagedMask & (1UL << i)) {
+                    *_settings[i].value = _staged[i];
+                }
+            }
+            _appliedCrc = crc;
+            _changed = true;
+        }
+    }
+
+    out.print(_type);
+    out.print("=:");
+    out.print(applied ? '1' : '0');
+    out.print(',');
+    out.print(applied ? crc : _crc, HEX);
+    out.println();
+
+    _stagedMask = 0;
+    _crc = 0xFFFF;
+    _invalid = false;
+}
+
+/**
+ * Find a setting.
+ *
+ * @param key The setting's key
+ * @return Index into the settings, -1 if there is none with this key
+ */
+int8_t WeatherBusLiteConfig::find(char key) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_settings[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
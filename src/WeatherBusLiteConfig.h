@@ -0,0 +1,82 @@
+#ifndef WEATHERBUSLITE_CONFIG_H
+#define WEATHERBUSLITE_CONFIG_H
+
+#include <Arduino.h>
+
+// most settings one node exposes, and most writes in one batch
+#define WEATHERBUSLITE_CONFIG_MAX_SETTINGS 16
+
+// times a rejected or unanswered commit is retried with the whole batch
+#define WEATHERBUSLITE_CONFIG_RETRIES 3
+
+class WeatherBusLite;
+
+// Configuration over the bus. The master stages writes and then commits
+// them; the node applies all staged values at once, and only if the CRC of
+// what it received matches the master's:
+//
+// Set:     =T<key><value>            (no reply, staged)
+// Commit:  =T!<crc>                  (node replies with the result)
+// Result:  T=:<applied>,<crc>
+// Read:    ?T=<key>                  (node replies with the applied value)
+// Value:   T=:<key><value>
+//
+// key is a single letter, value a decimal integer and crc (hex) the CRC-16
+// of the "<key><value>" text of every set since the last commit, in order.
+// applied is 1 or 0. Staging is cleared by every commit, so a lost set
+// makes the commit fail instead of applying half a batch. A repeated commit
+// after a lost result reports the previous one.
+
+// A value a node can be configured with, e.g. the sample interval in ms or
+// a calibration coefficient in fixed point.
+struct WeatherBusLiteSetting {
+    char key;
+    int32_t *value;
+    int32_t min;
+    int32_t max;
+};
+
+// Master side: writes a batch of settings to one node.
+class WeatherBusLiteConfigWriter {
+public:
+    WeatherBusLiteConfigWriter(WeatherBusLite &bus, char type);
+
+    bool set(char key, int32_t value);
+    bool commit();
+    bool read(char key, int32_t &value);
+
+private:
+    bool sendBatch();
+
+    WeatherBusLite &_bus;
+    char _type;
+    char _keys[WEATHERBUSLITE_CONFIG_MAX_SETTINGS];
+    int32_t _values[WEATHERBUSLITE_CONFIG_MAX_SETTINGS];
+    uint8_t _count;
+};
+
+// Node side: stages and applies writes to the node's settings.
+class WeatherBusLiteConfig {
+public:
+    WeatherBusLiteConfig(char type, WeatherBusLiteSetting *settings, uint8_t count);
+
+    bool handle(const char *line, Print &out);
+    bool changed();
+
+private:
+    void stage(const char *text);
+    void commit(uint16_t crc, Print &out);
+    int8_t find(char key) const;
+
+    char _type;
+    WeatherBusLiteSetting *_settings;
+    uint8_t _count;
+    int32_t _staged[WEATHERBUSLITE_CONFIG_MAX_SETTINGS];
+    uint32_t _stagedMask;
+    uint16_t _crc;          // CRC of the staged set frames
+    uint16_t _appliedCrc;   // CRC of the last applied commit
+    bool _invalid;          // A staged write had an unknown key or bad value
+    bool _changed;
+};
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef WEATHERBUSLITE_CRC_H
+#define WEATHERBUSLITE_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-16/CCITT-FALSE. Pass the previous result as crc to continue a checksum
+// over several buffers.
+uint16_t weatherBusLiteCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteDecoder.h"
+#include "WeatherBusLiteCrc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum DecoderState { WAIT_FOR_START, WAIT_FOR_TYPE, READ_PAYLOAD };
+
+/**
+ * Constructor.
+ *
+ * @param frame Buffer for the frame
+ * @param size Size of the buffer
+ */
+WeatherBusLiteDecoder::WeatherBusLiteDecoder(char *frame, size_t size)
+    : _frame(frame), _size(size), _index(0), _type(0), _state(WAIT_FOR_START) {}
+
+/**
+ * Start waiting for a frame.
+ *
+ * @param expectedType The expected type of the response
+ */
+void WeatherBusLiteDecoder::begin(char expectedType) {
+    _type = expectedType;
+    _index = 0;
+    _state = WAIT_FOR_START;
+}
+
+/**
+ * Feed a byte of a plain frame.
+ *
+ * The frame starts at the first byte equal to the expected type. Frames
+ * longer than the buffer are truncated.
+ *
+ * @param c The received byte
+ * @return True if the frame is complete and null-terminated, false otherwise
+ */
+bool WeatherBusLiteDecoder::feedPlain(char c) {
+    switch (_state) {
+        case WAIT_FOR_START:
+            if (c == _type) {  // Check if first char matches expected type (T, H, etc.)
+                _index = 0;
+                _frame[_index++] = c;
+                _state = READ_PAYLOAD;
+            }
+            break;
+
+        case READ_PAYLOAD:
+            if (c == '\n' || _index >= _size - 1) {
+                _frame[_index] = '\0';  // Null-terminate the string
+                _state = WAIT_FOR_START;
+                return true;
+            }
+            _frame[_index++] = c;
+            break;
+    }
+    return false;
+}
+
+/**
+ * Feed a byte of a frame that begins with a start marker.
+ *
+ * The marker must be followed by the expected type. Every marker starts
+ * over, dropping a partial or corrupted frame, and frames longer than the
+ * buffer are dropped rather than truncated.
+ *
+ * @param c The received byte
+ * @param marker The start marker
+ * @return True if the frame is complete and null-terminated, false otherwise
+ */
+bool WeatherBusLiteDecoder::feedMarked(char c, char marker) {
+    if (c == marker) {
+        _index = 0;  // Resync on every start marker
+        _state = WAIT_FOR_TYPE;
+        return false;
+    }
+    switch (_state) {
+        case WAIT_FOR_TYPE:
+            if (c == _type) {
+                _frame[_index++] = c;
+                _state = READ_PAYLOAD;
+            } else {
+                _state = WAIT_FOR_START;  // Another node's frame or noise
+            }
+            break;
+
+        case READ_PAYLOAD:
+            if (c == '\n') {
+                _frame[_index] = '\0';
+                _state = WAIT_FOR_START;
+                return true;
+            }
+            if (_index >= _size - 1) {
+                _index = 0;  // Too long to be ours; wait for the next marker
+                _state = WAIT_FOR_START;
+                break;
+            }
+            _frame[_index++] = c;
+            break;
+    }
+    return false;
+}
+
+/**
+ * Length of the last complete frame.
+ *
+ * @return Length without the terminator
+ */
+size_t WeatherBusLiteDecoder::length() const {
+    return _index;
+}
+
+/**
+ * Parse a reading frame.
+ *
+ * The value follows the colon. Optional fields follow the value as
+ * ",<key><value>", so older masters reading the value with atof ignore
+ * them. Unknown keys are skipped. Known keys:
+ *
+ *   !  Quality flags in hex (WEATHERBUSLITE_FLAG_*)
+ *   @  Sample time in master millis (WeatherBusLiteClock)
+ *   ~  Sample age in ms when the reply was sent
+ *   +  ms until the node takes its next sample
+ *
+ * @param frame The frame, e.g. "T:23.4,!4"
+ * @param value The value
+ * @param fields The optional fields, cleared first
+ * @return True if the frame holds a value, false otherwise
+ */
+bool weatherBusLiteParseReading(const char *frame, float &value, WeatherBusLiteFields &fields) {
+    memset(&fields, 0, sizeof(fields));
+
+    const char *colonPos = strchr(frame, ':');  // Find colon in response
+    if (colonPos == nullptr) {
+        return false;  // Invalid response
+    }
+    char *end;
+    value = strtod(colonPos + 1, &end);  // Convert string after ':' to float
+
+    const char *field = end;
+    while (*field == ',' && field[1] != '\0') {
+        end = (char *)field + 2;
+        switch (field[1]) {
+            case '!':  // Quality flags
+                fields.flags = (uint8_t)strtoul(field + 2, &end, 16);
+                break;
+
+            case '@':  // Sample time
+                fields.sampleTime = strtoul(field + 2, &end, 10);
+                fields.hasSampleTime = end != field + 2;
+                break;
+
+            case '~':  // Sample age
+                fields.sampleAge = strtoul(field + 2, &end, 10);
+                fields.hasSampleAge = end != field + 2;
+                break;
+
+            case '+':  // Time to next sample
+                fields.nextSampleIn = strtoul(field + 2, &end, 10);
+                fields.hasNextSample = end != field + 2;
+                break;
+        }
+        field = strchr(end, ',');
+        if (field == nullptr) {
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check and remove the checksum of a frame.
+ *
+ * The frame text is followed by "*<crc>", the CRC-16 in hex of everything
+ * before the '*'.
+ *
+ * @param frame The frame, shortened in place
+ * @return Length of the frame without the checksum, -1 if it is missing or wrong
+ */
+int weatherBusLiteStripChecksum(char *frame) {
+    char *star = strrchr(frame, '*');
+    if (star == nullptr) {
+        return -1;
+    }
+    char *end;
+    unsigned long crc = strtoul(star + 1, &end, 16);
+    if (end == star + 1 || crc != weatherBusLiteCrc16((const uint8_t *)frame, star - frame)) {
+        return -1;
+    }
+    *star = '\0';
+    return star - frame;
+}
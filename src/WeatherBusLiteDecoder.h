@@ -0,0 +1,41 @@
+#ifndef WEATHERBUSLITE_DECODER_H
+#define WEATHERBUSLITE_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Optional fields of a reading, see weatherBusLiteParseReading.
+struct WeatherBusLiteFields {
+    uint8_t flags;               // WEATHERBUSLITE_FLAG_* bits
+    unsigned long sampleTime;    // Master millis when sampled
+    unsigned long sampleAge;     // ms between sampling and replying
+    unsigned long nextSampleIn;  // ms until the node samples again
+    bool hasSampleTime;
+    bool hasSampleAge;
+    bool hasNextSample;
+};
+
+// Response frame state machine, fed one byte at a time so it works on a
+// blocking UART as well as on buffers filled by a non-blocking host
+// transport. The frame is stored without the marker and newline.
+class WeatherBusLiteDecoder {
+public:
+    WeatherBusLiteDecoder(char *frame, size_t size);
+
+    void begin(char expectedType);
+    bool feedPlain(char c);
+    bool feedMarked(char c, char marker);
+    size_t length() const;
+
+private:
+    char *_frame;
+    size_t _size;
+    size_t _index;
+    char _type;
+    uint8_t _state;
+};
+
+bool weatherBusLiteParseReading(const char *frame, float &value, WeatherBusLiteFields &fields);
+int weatherBusLiteStripChecksum(char *frame);
+
+#endif
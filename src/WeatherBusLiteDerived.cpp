@@ -0,0 +1,242 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteDerived.h"
+
+#include <math.h>
+
+// inputs
+#define INPUT_TEMPERATURE 0x01
+#define INPUT_HUMIDITY    0x02
+#define INPUT_PRESSURE    0x04
+#define INPUT_WIND        0x08
+#define INPUT_ALTITUDE    0x10
+
+// metrics
+#define METRIC_DEW_POINT  0x01
+#define METRIC_HEAT_INDEX 0x02
+#define METRIC_WIND_CHILL 0x04
+#define METRIC_SEA_LEVEL  0x08
+
+// Constructor
+WeatherBusLiteDerived::WeatherBusLiteDerived(float altitude)
+    : _altitude(altitude), _temperature(0.0f), _humidity(0.0f), _pressure(0.0f), _windSpeed(0.0f),
+      _dewPoint(NAN), _heatIndex(NAN), _windChill(NAN), _seaLevelPressure(NAN),
+      _present(INPUT_ALTITUDE), _stale(0) {}
+
+/**
+ * Set station altitude.
+ *
+ * @param altitude Station altitude above mean sea level in metres
+ */
+void WeatherBusLiteDerived::setAltitude(float altitude) {
+    if (altitude != _altitude) {
+        _altitude = altitude;
+        markChanged(INPUT_ALTITUDE);
+    }
+}
+
+/**
+ * Set air temperature.
+ *
+ * @param temperature Temperature in degrees Celsius, as returned by queryTemp
+ */
+void WeatherBusLiteDerived::setTemperature(float temperature) {
+    if (temperature != _temperature || !has(INPUT_TEMPERATURE)) {
+        _temperature = temperature;
+        markChanged(INPUT_TEMPERATURE);
+    }
+}
+
+/**
+ * Set relative humidity.
+ *
+ * @param humidity Humidity in percentage, as returned by queryHumidity
+ */
+void WeatherBusLiteDerived::setHumidity(float humidity) {
+    if (humidity != _humidity || !has(INPUT_HUMIDITY)) {
+        _humidity = humidity;
+        markChanged(INPUT_HUMIDITY);
+    }
+}
+
+/**
+ * Set station pressure.
+ *
+ * @param pressure Pressure in hPa, as returned by queryPressure
+ */
+void WeatherBusLiteDerived::setPressure(float pressure) {
+    if (pressure != _pressure || !has(INPUT_PRESSURE)) {
+        _pressure = pressure;
+        markChanged(INPUT_PRESSURE);
+    }
+}
+
+/**
+ * Set wind speed.
+ *
+ * @param windSpeed Wind speed in m/s, as returned by queryWindSpeed
+ */
+void WeatherBusLiteDerived::setWindSpeed(float windSpeed) {
+    if (windSpeed != _windSpeed || !has(INPUT_WIND)) {
+        _windSpeed = windSpeed;
+        markChanged(INPUT_WIND);
+    }
+}
+
+/**
+ * Dew point.
+ *
+ * Magnus formula with the Alduchov and Eskridge coefficients.
+ *
+ * @return Dew point in degrees Celsius, NAN until temperature and humidity are set
+ */
+float WeatherBusLiteDerived::dewPoint() {
+    if (_stale & METRIC_DEW_POINT) {
+        _stale &= ~METRIC_DEW_POINT;
+        if (has(INPUT_TEMPERATURE | INPUT_HUMIDITY) && _humidity > 0.0f) {
+            float gamma = logf(_humidity * 0.01f) + 17.625f * _temperature / (243.04f + _temperature);
+            _dewPoint = 243.04f * gamma / (17.625f - gamma);
+        } else {
+            _dewPoint = NAN;
+        }
+    }
+    return _dewPoint;
+}
+
+/**
+ * Heat index.
+ *
+ * NWS algorithm: Steadman's simple formula below 80 F, otherwise the
+ * Rothfusz regression with the low and high humidity adjustments.
+ *
+ * @return Heat index in degrees Celsius, NAN until temperature and humidity are set
+ */
+float WeatherBusLiteDerived::heatIndex() {
+    if (_stale & METRIC_HEAT_INDEX) {
+        _stale &= ~METRIC_HEAT_INDEX;
+        if (has(INPUT_TEMPERATURE | INPUT_HUMIDITY)) {
+            float t = _temperature * 1.8f + 32.0f;
+            float rh = _humidity;
+            float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + rh * 0.094f);
+
+            if ((hi + t) * 0.5f >= 80.0f) {
+                hi = -42.379f + 2.04901523f * t + 10.14333127f * rh
+                     - 0.22475541f * t * rh - 0.00683783f * t * t
+                     - 0.05481717f * rh * rh + 0.00122874f * t * t * rh
+                     + 0.00085282f * t * rh * rh - 0.00000199f * t * t * rh * rh;
+
+                if (rh < 13.0f && t >= 80.0f && t <= 112.0f) {
+                    hi -= ((13.0f - rh) * 0.25f) * sqrtf((17.0f - fabsf(t - 95.0f)) / 17.0f);
+                } else if (rh > 85.0f && t >= 80.0f && t <= 87.0f) {
+                    hi += ((rh - 85.0f) * 0.1f) * ((87.0f - t) * 0.2f);
+                }
+            }
+
+            _heatIndex = (hi - 32.0f) / 1.8f;
+        } else {
+            _heatIndex = NAN;
+        }
+    }
+    return _heatIndex;
+}
+
+/**
+ * Wind chill.
+ *
+ * Environment Canada / NWS wind chill index. Outside its validity range
+ * (above 10 C or below 4.8 km/h) the air temperature is returned.
+ *
+ * @return Wind chill in degrees Celsius, NAN until temperature and wind speed are set
+ */
+float WeatherBusLiteDerived::windChill() {
+    if (_stale & METRIC_WIND_CHILL) {
+        _stale &= ~METRIC_WIND_CHILL;
+        if (has(INPUT_TEMPERATURE | INPUT_WIND)) {
+            float v = _windSpeed * 3.6f;  // km/h
+            if (_temperature <= 10.0f && v > 4.8f) {
+                float v16 = powf(v, 0.16f);
+                _windChill = 13.12f + 0.6215f * _temperature - 11.37f * v16 + 0.3965f * _temperature * v16;
+            } else {
+                _windChill = _temperature;
+            }
+        } else {
+            _windChill = NAN;
+        }
+    }
+    return _windChill;
+}
+
+/**
+ * Sea level pressure.
+ *
+ * Reduces station pressure to mean sea level using the barometric formula
+ * with the standard lapse rate.
+ *
+ * @return Sea level pressure in hPa, NAN until pressure and temperature are set
+ */
+float WeatherBusLiteDerived::seaLevelPressure() {
+    if (_stale & METRIC_SEA_LEVEL) {
+        _stale &= ~METRIC_SEA_LEVEL;
+        if (has(INPUT_PRESSURE | INPUT_TEMPERATURE)) {
+            float lapse = 0.0065f * _altitude;
+            float ratio = 1.0f - lapse / (_temperature + lapse + 273.15f);
+            _seaLevelPressure = _pressure * powf(ratio, -5.257f);
+        } else {
+            _seaLevelPressure = NAN;
+        }
+    }
+    return _seaLevelPressure;
+}
+
+/**
+ * Mark an input as changed.
+ *
+ * Flags every metric depending on the input for recomputation.
+ *
+ * @param input The input that changed
+ */
+void WeatherBusLiteDerived::markChanged(uint8_t input) {
+    _present |= input;
+    switch (input) {
+        case INPUT_TEMPERATURE:
+            _stale |= METRIC_DEW_POINT | METRIC_HEAT_INDEX | METRIC_WIND_CHILL | METRIC_SEA_LEVEL;
+            break;
+        case INPUT_HUMIDITY:
+            _stale |= METRIC_DEW_POINT | METRIC_HEAT_INDEX;
+            break;
+        case INPUT_WIND:
+            _stale |= METRIC_WIND_CHILL;
+            break;
+        case INPUT_PRESSURE:
+        case INPUT_ALTITUDE:
+            _stale |= METRIC_SEA_LEVEL;
+            break;
+    }
+}
+
+/**
+ * Check whether inputs have been set.
+ *
+ * @param inputs Mask of inputs
+ * @return True if every input in the mask has been set
+ */
+bool WeatherBusLiteDerived::has(uint8_t inputs) const {
+    return (_present & inputs) == inputs;
+}
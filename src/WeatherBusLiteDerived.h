@@ -0,0 +1,42 @@
+#ifndef WEATHERBUSLITE_DERIVED_H
+#define WEATHERBUSLITE_DERIVED_H
+
+#include <stdint.h>
+
+// Derived metrics computed from the raw sensor readings. Each metric is only
+// recomputed when one of its inputs has changed since it was last read.
+class WeatherBusLiteDerived {
+public:
+    WeatherBusLiteDerived(float altitude = 0.0f);
+
+    void setAltitude(float altitude);
+    void setTemperature(float temperature);
+    void setHumidity(float humidity);
+    void setPressure(float pressure);
+    void setWindSpeed(float windSpeed);
+
+    float dewPoint();
+    float heatIndex();
+    float windChill();
+    float seaLevelPressure();
+
+private:
+    void markChanged(uint8_t input);
+    bool has(uint8_t inputs) const;
+
+    float _altitude;
+    float _temperature;
+    float _humidity;
+    float _pressure;
+    float _windSpeed;
+
+    float _dewPoint;
+    float _heatIndex;
+    float _windChill;
+    float _seaLevelPressure;
+
+    uint8_t _present;  // Inputs that have been set
+    uint8_t _stale;    // Metrics needing recomputation
+};
+
+#endif
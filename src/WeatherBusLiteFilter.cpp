@@ -0,0 +1,200 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteFilter.h"
+
+#include <math.h>
+
+// MAD to standard deviation for normally distributed noise
+#define MAD_SCALE 1.4826f
+
+// Constructor
+WeatherBusLiteFilter::WeatherBusLiteFilter()
+    : _min(-INFINITY), _max(INFINITY), _maxRate(0.0f), _threshold(3.0f), _minSpread(0.0f), _windowSize(0) {
+    reset();
+}
+
+/**
+ * Enable the range check.
+ *
+ * Readings outside the physically possible range are rejected.
+ *
+ * @param min Lowest plausible value
+ * @param max Highest plausible value
+ */
+void WeatherBusLiteFilter::setRange(float min, float max) {
+    _min = min;
+    _max = max;
+}
+
+/**
+ * Enable the rate of change limit.
+ *
+ * Readings implying a faster change since the last accepted reading are
+ * rejected. A genuine step is accepted once enough time has passed.
+ *
+ * @param maxRate Largest plausible rate of change in units per second, 0 to disable
+ */
+void WeatherBusLiteFilter::setRateLimit(float maxRate) {
+    _maxRate = maxRate;
+}
+
+/**
+ * Enable the Hampel filter.
+ *
+ * A reading further than threshold scaled MADs from the median of the
+ * window is replaced by the median. The spread never drops below minSpread,
+ * so a run of identical readings (MAD of zero), such as a rain gauge
+ * reading 0 mm for days, does not flag the first genuine change. It is in
+ * sensor units, so it also works around a zero baseline: use about twice
+ * the sensor's noise, or for a sensor that moves in steps a little more
+ * than its largest genuine change over half a window divided by the
+ * threshold, e.g. 0.5 mm for a gauge tipping 0.2 mm every reading.
+ *
+ * @param window Number of readings including the new one, up to
+ *               WEATHERBUSLITE_FILTER_WINDOW, 0 to disable
+ * @param threshold Threshold in scaled MADs, 3 is typical
+ * @param minSpread Floor of the spread in sensor units, 0 for none
+ */
+void WeatherBusLiteFilter::setHampel(uint8_t window, float threshold, float minSpread) {
+    _windowSize = window > WEATHERBUSLITE_FILTER_WINDOW ? WEATHERBUSLITE_FILTER_WINDOW : window;
+    _threshold = threshold;
+    _minSpread = minSpread;
+    _windowCount = 0;
+    _windowHead = 0;
+}
+
+/**
+ * Reset the filter history and counters.
+ */
+void WeatherBusLiteFilter::reset() {
+    _windowCount = 0;
+    _windowHead = 0;
+    _last = 0.0f;
+    _lastTime = 0;
+    _hasLast = false;
+    _rejected = 0;
+    _replaced = 0;
+}
+
+/**
+ * Filter a reading.
+ *
+ * @param value The reading, replaced by the median if it is an outlier
+ * @param now Current time in milliseconds
+ * @return True if the reading was accepted, false if it was rejected
+ */
+bool WeatherBusLiteFilter::apply(float &value, unsigned long now) {
+    if (isnan(value) || value < _min || value > _max) {
+        _rejected++;
+        return false;
+    }
+
+    if (_maxRate > 0.0f && _hasLast) {
+        float change = fabsf(value - _last);
+        float allowed = _maxRate * (now - _lastTime) / 1000.0f;
+        if (change > allowed) {
+            _rejected++;
+            return false;
+        }
+    }
+
+    float raw = value;
+    if (_windowSize > 1 && _windowCount >= _windowSize - 1) {
+        float sorted[WEATHERBUSLITE_FILTER_WINDOW];
+        for (uint8_t i = 0; i < _windowSize - 1; i++) {
+            sorted[i] = _window[i];
+        }
+        sorted[_windowSize - 1] = raw;
+        float center = median(sorted, _windowSize);
+
+        for (uint8_t i = 0; i < _windowSize; i++) {
+            sorted[i] = fabsf(sorted[i] - center);
+        }
+        float spread = MAD_SCALE * median(sorted, _windowSize);
+        if (spread < _minSpread) {
+            spread = _minSpread;
+        }
+
+        if (fabsf(raw - center) > _threshold * spread) {
+            value = center;
+            _replaced++;
+        }
+    }
+
+    // The window keeps raw readings so a genuine step is followed after
+    // half a window
+    if (_windowSize > 1) {
+        _window[_windowHead] = raw;
+        _windowHead = (_windowHead + 1) % (_windowSize - 1);
+        if (_windowCount < _windowSize - 1) {
+            _windowCount++;
+        }
+    }
+
+    _last = value;
+    _lastTime = now;
+    _hasLast = true;
+    return true;
+}
+
+/**
+ * Number of rejected readings.
+ *
+ * @return Readings rejected by the range check or rate limit since the last reset
+ */
+uint16_t WeatherBusLiteFilter::rejected() const {
+    return _rejected;
+}
+
+/**
+ * Number of replaced readings.
+ *
+ * @return Readings replaced by the Hampel filter since the last reset
+ */
+uint16_t WeatherBusLiteFilter::replaced() const {
+    return _replaced;
+}
+
+/**
+ * Median of a small array.
+ *
+ * Insertion sort in place, which is fastest for the handful of values in
+ * the window.
+ *
+ * @param values The values, sorted on return
+ * @param count Number of values
+ * @return The median
+ */
+float WeatherBusLiteFilter::median(float *values, uint8_t count) {
+    for (uint8_t i = 1; i < count; i++) {
+        float v = values[i];
+        int8_t j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+
+    if (count & 1) {
+        return values[count / 2];
+    }
+    return (values[count / 2 - 1] + values[count / 2]) * 0.5f;
+}
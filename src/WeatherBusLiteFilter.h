@@ -0,0 +1,48 @@
+#ifndef WEATHERBUSLITE_FILTER_H
+#define WEATHERBUSLITE_FILTER_H
+
+#include <stdint.h>
+
+// largest Hampel window
+#define WEATHERBUSLITE_FILTER_WINDOW 9
+
+// Per-sensor plausibility filter applied to readings right after parsing.
+// Stages run in order and each is optional: physical range check, rate of
+// change limit and a Hampel (median / MAD) outlier filter.
+class WeatherBusLiteFilter {
+public:
+    WeatherBusLiteFilter();
+
+    void setRange(float min, float max);
+    void setRateLimit(float maxRate);
+    void setHampel(uint8_t window, float threshold, float minSpread = 0.0f);
+
+    void reset();
+    bool apply(float &value, unsigned long now);
+
+    uint16_t rejected() const;
+    uint16_t replaced() const;
+
+private:
+    static float median(float *values, uint8_t count);
+
+    float _min;
+    float _max;
+    float _maxRate;    // Units per second, 0 if disabled
+    float _threshold;  // Hampel threshold in scaled MADs
+    float _minSpread;  // Floor of the Hampel spread in sensor units
+
+    float _window[WEATHERBUSLITE_FILTER_WINDOW];
+    uint8_t _windowSize;  // 0 if the Hampel filter is disabled
+    uint8_t _windowCount;
+    uint8_t _windowHead;
+
+    float _last;
+    unsigned long _lastTime;
+    bool _hasLast;
+
+    uint16_t _rejected;
+    uint16_t _replaced;
+};
+
+#endif
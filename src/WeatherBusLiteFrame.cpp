@@ -0,0 +1,60 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteFrame.h"
+#include "WeatherBusLiteCrc.h"
+
+/**
+ * Constructor.
+ *
+ * @param out Where to write, e.g. RS485
+ * @param marker The start marker
+ * @param checksum True to end every line with a checksum
+ */
+WeatherBusLiteFramedPrint::WeatherBusLiteFramedPrint(Print &out, char marker, bool checksum)
+    : _out(out), _marker(marker), _checksum(checksum), _lineStart(true), _lineEnd(false),
+      _crc(0xFFFF) {}
+
+/**
+ * Write a byte, preceded by the marker if it starts a line and by the
+ * checksum if it ends one.
+ *
+ * @param c The byte
+ * @return 1 if the byte was written, 0 otherwise
+ */
+size_t WeatherBusLiteFramedPrint::write(uint8_t c) {
+    if (_lineStart) {
+        _out.write(_marker);
+        _lineStart = false;
+        _lineEnd = false;
+        _crc = 0xFFFF;
+    }
+
+    if (c == '\r' || c == '\n') {
+        if (_checksum && !_lineEnd) {
+            _out.write('*');
+            _out.print(_crc, HEX);
+        }
+        _lineEnd = true;  // Once for "\r\n"
+        _lineStart = c == '\n';
+    } else {
+        _crc = weatherBusLiteCrc16(&c, 1, _crc);
+    }
+    return _out.write(c);
+}
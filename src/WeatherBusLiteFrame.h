@@ -0,0 +1,35 @@
+#ifndef WEATHERBUSLITE_FRAME_H
+#define WEATHERBUSLITE_FRAME_H
+
+#include <Arduino.h>
+
+// start-of-frame marker (ASCII STX), never part of a frame's text
+#define WEATHERBUSLITE_FRAME_START 0x02
+
+// Node-side output that writes the start marker before every line, so
+// replies printed by the sketch or the protocol helpers are framed for a
+// master using WeatherBusLite::setFrameStart, and optionally appends a
+// checksum for the checksummed profile:
+//
+// Reply:   <STX>T:23.4
+// Reply:   <STX>T:23.4*<crc>
+//
+// crc is the CRC-16 in hex of the text between the marker and the '*'. A
+// master using the checksummed profile starts its queries with the marker;
+// a node strips it and answers those queries with checksum set.
+class WeatherBusLiteFramedPrint : public Print {
+public:
+    WeatherBusLiteFramedPrint(Print &out, char marker = WEATHERBUSLITE_FRAME_START, bool checksum = false);
+
+    size_t write(uint8_t c) override;
+
+private:
+    Print &_out;
+    char _marker;
+    bool _checksum;
+    bool _lineStart;
+    bool _lineEnd;
+    uint16_t _crc;  // CRC of the line so far
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteHistory.h"
+
+/**
+ * Constructor.
+ *
+ * @param buffer Storage for the samples
+ * @param capacity Number of samples the storage holds
+ */
+WeatherBusLiteHistory::WeatherBusLiteHistory(WeatherBusLiteSample *buffer, uint16_t capacity)
+    : _buffer(buffer), _capacity(capacity), _head(0), _count(0), _pending(0) {}
+
+/**
+ * Store a reading.
+ *
+ * @param value The reading
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteHistory::push(float value, unsigned long now) {
+    if (_capacity == 0) {
+        return;
+    }
+
+    if (_count == _capacity) {
+        // Overwrite the oldest sample
+        _head = (_head + 1) % _capacity;
+        _count--;
+        if (_pending > 0) {
+            _pending--;
+        }
+    }
+
+    WeatherBusLiteSample &sample = _buffer[(_head + _count) % _capacity];
+    sample.time = now;
+    sample.value = value;
+    _count++;
+}
+
+/**
+ * Number of buffered samples.
+ *
+ * @return The count
+ */
+uint16_t WeatherBusLiteHistory::count() const {
+    return _count;
+}
+
+/**
+ * Parse a bulk request.
+ *
+ * @param query The received query line, e.g. "?T*16,0"
+ * @param type The sensor type
+ * @param max Most samples to send
+ * @param acked Samples received from the previous reply
+ * @return True if the query is a bulk request, false otherwise
+ */
+bool WeatherBusLiteHistory::parseRequest(const char *query, char &type, uint8_t &max, uint8_t &acked) {
+    if (query[0] != '?' || query[1] == '\0' || query[2] != '*') {
+        return false;
+    }
+
+    char *end;
+    long requested = strtol(query + 3, &end, 10);
+    if (end == query + 3 || *end != ',') {
+        return false;
+    }
+    long received = strtol(end + 1, &end, 10);
+
+    type = query[1];
+    max = requested > WEATHERBUSLITE_HISTORY_BATCH ? WEATHERBUSLITE_HISTORY_BATCH : (requested < 0 ? 0 : requested);
+    acked = received > 255 ? 255 : (received < 0 ? 0 : received);
+    return true;
+}
+
+/**
+ * Answer a bulk request.
+ *
+ * Drops the acknowledged samples of the previous reply and writes the next
+ * batch, oldest first.
+ *
+ * @param out Where to write the reply, e.g. RS485 between beginTransmission
+ *            and endTransmission
+ * @param type The sensor type
+ * @param max Most samples to send
+ * @param acked Samples received from the previous reply
+ * @param now Current time in milliseconds
+ * @param digits Decimal places of the values
+ */
+void WeatherBusLiteHistory::respond(Print &out, char type, uint8_t max, uint8_t acked, unsigned long now,
+                                    uint8_t digits) {
+    if (acked > _pending) {
+        acked = _pending;
+    }
+    _head = _capacity > 0 ? (_head + acked) % _capacity : 0;
+    _count -= acked;
+
+    if (max > WEATHERBUSLITE_HISTORY_BATCH) {
+        max = WEATHERBUSLITE_HISTORY_BATCH;
+    }
+    _pending = _count < max ? _count : max;
+
+    out.print(type);
+    out.print("*:");
+    unsigned long previous = now;
+    for (uint8_t i = 0; i < _pending; i++) {
+        const WeatherBusLiteSample &sample = _buffer[(_head + i) % _capacity];
+        if (i > 0) {
+            out.print(';');
+            out.print(sample.time - previous);
+        } else {
+            out.print(now - sample.time);
+        }
+        out.print(',');
+        out.print(sample.value, digits);
+        previous = sample.time;
+    }
+    out.println();
+}
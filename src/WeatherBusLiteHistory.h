@@ -0,0 +1,45 @@
+#ifndef WEATHERBUSLITE_HISTORY_H
+#define WEATHERBUSLITE_HISTORY_H
+
+#include <Arduino.h>
+
+// most samples sent in one bulk reply
+#define WEATHERBUSLITE_HISTORY_BATCH 16
+
+// A timestamped reading. On the node the time is the node's millis(); the
+// master converts it to its own millis() when decoding a bulk reply.
+struct WeatherBusLiteSample {
+    unsigned long time;
+    float value;
+};
+
+// Node-side store-and-forward buffer. The node pushes every reading it takes
+// and the master downloads them in bulk after an outage with
+// WeatherBusLite::queryHistory. Oldest samples are overwritten when full.
+//
+// Bulk request:  ?T*<max>,<acked>
+// Bulk reply:    T*:<age>,<value>;<delta>,<value>;...
+//
+// acked is the number of samples the master got from the previous reply;
+// they are dropped before the next batch is sent. The first sample carries
+// its age in ms at the time of the reply, each following one the ms elapsed
+// since the sample before it.
+class WeatherBusLiteHistory {
+public:
+    WeatherBusLiteHistory(WeatherBusLiteSample *buffer, uint16_t capacity);
+
+    void push(float value, unsigned long now);
+    uint16_t count() const;
+
+    static bool parseRequest(const char *query, char &type, uint8_t &max, uint8_t &acked);
+    void respond(Print &out, char type, uint8_t max, uint8_t acked, unsigned long now, uint8_t digits = 2);
+
+private:
+    WeatherBusLiteSample *_buffer;
+    uint16_t _capacity;
+    uint16_t _head;   // Index of the oldest sample
+    uint16_t _count;
+    uint8_t _pending; // Samples sent in the last reply and not yet acknowledged
+};
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLitePredictor.h"
+#include "WeatherBusLite.h"
+
+#include <math.h>
+
+/**
+ * Constructor.
+ *
+ * @param tolerance Poll once the predicted standard deviation exceeds this
+ * @param processNoise How fast the rate of change wanders, in units^2 / s^3
+ * @param measurementNoise Variance of a single reading, in units^2
+ */
+WeatherBusLitePredictor::WeatherBusLitePredictor(float tolerance, float processNoise, float measurementNoise)
+    : _tolerance(tolerance), _processNoise(processNoise), _measurementNoise(measurementNoise) {
+    reset();
+}
+
+/**
+ * Reset the filter.
+ *
+ * The next call to needsPoll will request a reading.
+ */
+void WeatherBusLitePredictor::reset() {
+    _value = 0.0f;
+    _rate = 0.0f;
+    _p00 = 0.0f;
+    _p01 = 0.0f;
+    _p11 = 0.0f;
+    _initialized = false;
+    _lastUpdate = 0;
+}
+
+/**
+ * Add a measurement.
+ *
+ * Propagates the state to the time of the measurement and corrects it.
+ * The first measurement initialises the value with an unknown rate.
+ *
+ * @param measurement The reading
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLitePredictor::update(float measurement, unsigned long now) {
+    if (!_initialized) {
+        _value = measurement;
+        _rate = 0.0f;
+        _p00 = _measurementNoise;
+        _p01 = 0.0f;
+        _p11 = _tolerance * _tolerance;  // Unknown rate: about one tolerance per second
+        _initialized = true;
+        _lastUpdate = now;
+        return;
+    }
+
+    float dt = (now - _lastUpdate) / 1000.0f;
+    _lastUpdate = now;
+
+    // Predict
+    float q = _processNoise;
+    _value += _rate * dt;
+    _p00 += dt * (2.0f * _p01 + dt * _p11) + q * dt * dt * dt / 3.0f;
+    _p01 += dt * _p11 + q * dt * dt / 2.0f;
+    _p11 += q * dt;
+
+    // Correct
+    float s = _p00 + _measurementNoise;
+    float k0 = _p00 / s;
+    float k1 = _p01 / s;
+    float innovation = measurement - _value;
+    _value += k0 * innovation;
+    _rate += k1 * innovation;
+    _p11 -= k1 * _p01;
+    _p00 *= 1.0f - k0;
+    _p01 *= 1.0f - k0;
+}
+
+/**
+ * Predict the value.
+ *
+ * @param now Current time in milliseconds
+ * @param value Predicted value
+ * @param uncertainty Standard deviation of the prediction
+ * @return True if the filter has been initialised, false otherwise
+ */
+bool WeatherBusLitePredictor::predict(unsigned long now, float &value, float &uncertainty) const {
+    if (!_initialized) {
+        return false;
+    }
+
+    float dt = (now - _lastUpdate) / 1000.0f;
+    float variance = _p00 + dt * (2.0f * _p01 + dt * _p11) + _processNoise * dt * dt * dt / 3.0f;
+    value = _value + _rate * dt;
+    uncertainty = sqrtf(variance);
+    return true;
+}
+
+/**
+ * Check whether the sensor should be polled.
+ *
+ * @param now Current time in milliseconds
+ * @return True if the prediction is too uncertain, false otherwise
+ */
+bool WeatherBusLitePredictor::needsPoll(unsigned long now) const {
+    float value, uncertainty;
+    if (!predict(now, value, uncertainty)) {
+        return true;
+    }
+    return uncertainty > _tolerance;
+}
+
+/**
+ * Read the sensor or predict it.
+ *
+ * Queries the sensor if the prediction is too uncertain, otherwise returns
+ * the prediction without touching the bus. Readings flagged as estimated or
+ * faulty are passed through but not learned from.
+ *
+ * @param bus The bus the sensor is on
+ * @param queryType The sensor type (T, H, etc.)
+ * @param value Measured or predicted value
+ * @param now Current time in milliseconds
+ * @return True if a value is available, false if a needed query failed
+ */
+bool WeatherBusLitePredictor::poll(WeatherBusLite &bus, char queryType, float &value, unsigned long now) {
+    if (needsPoll(now)) {
+        float measurement;
+        uint8_t flags;
+        if (!bus.queryCustom(queryType, measurement, flags)) {
+            return false;
+        }
+        if (flags & (WEATHERBUSLITE_FLAG_ESTIMATED | WEATHERBUSLITE_FLAG_FAULT)) {
+            // Not a measurement; keep the uncertainty so the next call polls again
+            value = measurement;
+            return true;
+        }
+        update(measurement, now);
+        value = _value;
+        return true;
+    }
+
+    float uncertainty;
+    return predict(now, value, uncertainty);
+}
@@ -0,0 +1,35 @@
+#ifndef WEATHERBUSLITE_PREDICTOR_H
+#define WEATHERBUSLITE_PREDICTOR_H
+
+#include <stdint.h>
+
+class WeatherBusLite;
+
+// Per-sensor Kalman filter with a constant rate model. Predicts the value
+// between polls and reports when the prediction has become too uncertain,
+// so slow-varying sensors are only polled when needed.
+class WeatherBusLitePredictor {
+public:
+    WeatherBusLitePredictor(float tolerance, float processNoise, float measurementNoise);
+
+    void reset();
+    void update(float measurement, unsigned long now);
+    bool predict(unsigned long now, float &value, float &uncertainty) const;
+    bool needsPoll(unsigned long now) const;
+    bool poll(WeatherBusLite &bus, char queryType, float &value, unsigned long now);
+
+private:
+    float _tolerance;         // Largest acceptable standard deviation
+    float _processNoise;      // Rate noise density, units^2 / s^3
+    float _measurementNoise;  // Measurement variance, units^2
+
+    float _value;
+    float _rate;  // Units per second
+    float _p00;   // Covariance of value and rate
+    float _p01;
+    float _p11;
+    bool _initialized;
+    unsigned long _lastUpdate;
+};
+
+#endif
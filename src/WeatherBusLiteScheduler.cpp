@@ -0,0 +1,183 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteScheduler.h"
+#include "WeatherBusLite.h"
+
+/**
+ * Constructor.
+ *
+ * @param bus The bus to poll
+ * @param busCap Largest share of time the bus may spend in queries, 0 to 1
+ */
+WeatherBusLiteScheduler::WeatherBusLiteScheduler(WeatherBusLite &bus, float busCap)
+    : _bus(bus), _busCap(busCap), _stretch(1.0f), _slotCount(0) {}
+
+/**
+ * Add a sensor.
+ *
+ * @param queryType The sensor type (T, H, etc.)
+ * @param minInterval Shortest polling interval in milliseconds
+ * @param maxInterval Longest polling interval in milliseconds
+ * @param activeRate Rate of change, in units per second, at or above which
+ *                   the sensor is polled at the shortest interval
+ * @return True if the sensor was added, false if all slots are in use
+ */
+bool WeatherBusLiteScheduler::add(char queryType, unsigned long minInterval, unsigned long maxInterval,
+                                  float activeRate) {
+    if (_slotCount >= WEATHERBUSLITE_SCHEDULER_SLOTS) {
+        return false;
+    }
+
+    Slot &slot = _slots[_slotCount++];
+    slot.type = queryType;
+    slot.minInterval = minInterval;
+    slot.maxInterval = maxInterval;
+    slot.activeRate = activeRate;
+    slot.activity = 0.0f;
+    slot.duration = 0.0f;
+    slot.last = 0.0f;
+    slot.lastReading = 0;
+    slot.lastPoll = 0;
+    slot.interval = minInterval;  // Start fast until the activity is known
+    slot.polled = false;
+    slot.valid = false;
+    return true;
+}
+
+/**
+ * Poll the most overdue sensor.
+ *
+ * Call this from the main loop. At most one query is made per call.
+ *
+ * @param now Current time in milliseconds
+ * @param queryType Type of the sensor that was read
+ * @param value The reading
+ * @return True if a reading was taken, false if nothing was due or the query failed
+ */
+bool WeatherBusLiteScheduler::run(unsigned long now, char &queryType, float &value) {
+    Slot *due = nullptr;
+    float mostOverdue = 1.0f;
+
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        Slot &slot = _slots[i];
+        if (!slot.polled) {
+            due = &slot;
+            break;
+        }
+        float overdue = (now - slot.lastPoll) / (slot.interval * _stretch);
+        if (overdue >= mostOverdue) {
+            mostOverdue = overdue;
+            due = &slot;
+        }
+    }
+
+    if (due == nullptr) {
+        return false;
+    }
+
+    unsigned long start = millis();
+    bool ok = _bus.queryCustom(due->type, value);
+    float duration = (float)(millis() - start);
+    due->duration += WEATHERBUSLITE_SCHEDULER_SMOOTHING * (duration - due->duration);
+
+    if (ok) {
+        adapt(*due, value, now);
+        queryType = due->type;
+    }
+    due->lastPoll = now;
+    due->polled = true;
+    updateStretch();
+
+    return ok;
+}
+
+/**
+ * Current polling interval of a sensor.
+ *
+ * @param queryType The sensor type
+ * @return Interval in milliseconds including the bus cap stretch, 0 if unknown
+ */
+unsigned long WeatherBusLiteScheduler::interval(char queryType) const {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        if (_slots[i].type == queryType) {
+            return (unsigned long)(_slots[i].interval * _stretch);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Expected bus utilisation.
+ *
+ * @return Share of time spent in queries at the current intervals, 0 to 1
+ */
+float WeatherBusLiteScheduler::utilisation() const {
+    float busy = 0.0f;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        busy += _slots[i].duration / (_slots[i].interval * _stretch);
+    }
+    return busy;
+}
+
+/**
+ * Adapt a sensor's interval to its activity.
+ *
+ * Tracks a running average of the absolute rate of change, which rises with
+ * both trends and noise, and maps it linearly onto polling frequency between
+ * the slot's bounds.
+ *
+ * @param slot The slot
+ * @param value The new reading
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteScheduler::adapt(Slot &slot, float value, unsigned long now) {
+    if (slot.valid && now != slot.lastReading) {
+        float rate = (value - slot.last) * 1000.0f / (now - slot.lastReading);
+        if (rate < 0.0f) {
+            rate = -rate;
+        }
+        slot.activity += WEATHERBUSLITE_SCHEDULER_SMOOTHING * (rate - slot.activity);
+
+        float level = slot.activity / slot.activeRate;
+        if (level > 1.0f) {
+            level = 1.0f;
+        }
+        float slowest = 1.0f / slot.maxInterval;
+        float fastest = 1.0f / slot.minInterval;
+        slot.interval = (unsigned long)(1.0f / (slowest + level * (fastest - slowest)));
+    }
+    slot.last = value;
+    slot.lastReading = now;
+    slot.valid = true;
+}
+
+/**
+ * Recompute the interval stretch.
+ *
+ * Stretches every interval by the same factor when the sensors together
+ * would keep the bus busier than the cap allows.
+ */
+void WeatherBusLiteScheduler::updateStretch() {
+    float busy = 0.0f;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        busy += _slots[i].duration / _slots[i].interval;
+    }
+    _stretch = busy > _busCap ? busy / _busCap : 1.0f;
+}
@@ -0,0 +1,53 @@
+#ifndef WEATHERBUSLITE_SCHEDULER_H
+#define WEATHERBUSLITE_SCHEDULER_H
+
+#include <stdint.h>
+
+#define WEATHERBUSLITE_SCHEDULER_SLOTS 10
+
+// smoothing factor of the activity and query duration averages
+#define WEATHERBUSLITE_SCHEDULER_SMOOTHING 0.25f
+
+class WeatherBusLite;
+
+// Polls sensors at a rate that follows their activity: a sensor whose
+// readings change quickly is polled up to its minimum interval, a quiet one
+// backs off to its maximum interval. All intervals are stretched when the
+// expected bus utilisation would exceed the configured cap.
+class WeatherBusLiteScheduler {
+public:
+    WeatherBusLiteScheduler(WeatherBusLite &bus, float busCap = 0.5f);
+
+    bool add(char queryType, unsigned long minInterval, unsigned long maxInterval, float activeRate);
+    bool run(unsigned long now, char &queryType, float &value);
+
+    unsigned long interval(char queryType) const;
+    float utilisation() const;
+
+private:
+    struct Slot {
+        char type;
+        unsigned long minInterval;
+        unsigned long maxInterval;
+        float activeRate;  // Rate of change (units/s) that earns the minimum interval
+        float activity;    // Average rate of change, units/s
+        float duration;    // Average query duration, ms
+        float last;        // Last reading
+        unsigned long lastReading;
+        unsigned long lastPoll;
+        unsigned long interval;
+        bool polled;
+        bool valid;        // Whether last holds a reading
+    };
+
+    void adapt(Slot &slot, float value, unsigned long now);
+    void updateStretch();
+
+    WeatherBusLite &_bus;
+    float _busCap;
+    float _stretch;  // Interval multiplier enforcing the bus cap
+    Slot _slots[WEATHERBUSLITE_SCHEDULER_SLOTS];
+    uint8_t _slotCount;
+};
+
+#endif
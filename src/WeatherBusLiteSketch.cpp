@@ -0,0 +1,378 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteSketch.h"
+
+#include <math.h>
+#include <string.h>
+
+#define GAMMA ((1.0f + WEATHERBUSLITE_SKETCH_ACCURACY) / (1.0f - WEATHERBUSLITE_SKETCH_ACCURACY))
+
+// serialized sizes
+#define HEADER_SIZE 16
+#define STORE_HEADER_SIZE 4
+
+static const float logGamma = logf(GAMMA);
+
+// Constructor
+WeatherBusLiteSketch::WeatherBusLiteSketch() {
+    reset();
+}
+
+/**
+ * Reset the sketch.
+ *
+ * Typically called at the start of every reporting interval.
+ */
+void WeatherBusLiteSketch::reset() {
+    clear(_positive);
+    clear(_negative);
+    _zeroCount = 0;
+    _count = 0;
+    _min = INFINITY;
+    _max = -INFINITY;
+}
+
+/**
+ * Add a value.
+ *
+ * @param value The value to add
+ */
+void WeatherBusLiteSketch::add(float value) {
+    if (isnan(value)) {
+        return;
+    }
+
+    if (value > WEATHERBUSLITE_SKETCH_MIN_VALUE) {
+        insert(_positive, key(value), 1);
+    } else if (value < -WEATHERBUSLITE_SKETCH_MIN_VALUE) {
+        insert(_negative, key(-value), 1);
+    } else {
+        _zeroCount++;
+    }
+
+    _count++;
+    if (value < _min) {
+        _min = value;
+    }
+    if (value > _max) {
+        _max = value;
+    }
+}
+
+/**
+ * Merge another sketch into this one.
+ *
+ * @param other The sketch to merge
+ */
+void WeatherBusLiteSketch::merge(const WeatherBusLiteSketch &other) {
+    for (uint8_t i = 0; i < WEATHERBUSLITE_SKETCH_BINS; i++) {
+        if (other._positive.counts[i] > 0) {
+            insert(_positive, other._positive.offset + i, other._positive.counts[i]);
+        }
+        if (other._negative.counts[i] > 0) {
+            insert(_negative, other._negative.offset + i, other._negative.counts[i]);
+        }
+    }
+
+    _zeroCount += other._zeroCount;
+    _count += other._count;
+    if (other._min < _min) {
+        _min = other._min;
+    }
+    if (other._max > _max) {
+        _max = other._max;
+    }
+}
+
+/**
+ * Number of values added.
+ *
+ * @return The count
+ */
+uint32_t WeatherBusLiteSketch::count() const {
+    return _count;
+}
+
+/**
+ * Estimate a quantile.
+ *
+ * @param q The quantile, 0 to 1 (e.g. 0.95 for p95)
+ * @param value The estimate, within the configured relative accuracy
+ * @return True if the sketch holds any values, false otherwise
+ */
+bool WeatherBusLiteSketch::quantile(float q, float &value) const {
+    if (_count == 0 || q < 0.0f || q > 1.0f) {
+        return false;
+    }
+
+    uint32_t rank = (uint32_t)(q * (_count - 1));
+    uint32_t seen = 0;
+
+    // Most negative values first
+    for (int8_t i = WEATHERBUSLITE_SKETCH_BINS - 1; i >= 0; i--) {
+        seen += _negative.counts[i];
+        if (seen > rank) {
+            value = -WeatherBusLiteSketch::value(_negative.offset + i);
+            break;
+        }
+    }
+
+    if (seen <= rank) {
+        seen += _zeroCount;
+        if (seen > rank) {
+            value = 0.0f;
+        }
+    }
+
+    if (seen <= rank) {
+        value = _max;  // Reached only if a bin saturated at UINT32_MAX
+        for (uint8_t i = 0; i < WEATHERBUSLITE_SKETCH_BINS; i++) {
+            seen += _positive.counts[i];
+            if (seen > rank) {
+                value = WeatherBusLiteSketch::value(_positive.offset + i);
+                break;
+            }
+        }
+    }
+
+    if (value < _min) {
+        value = _min;
+    } else if (value > _max) {
+        value = _max;
+    }
+    return true;
+}
+
+/**
+ * Serialize the sketch.
+ *
+ * Little endian: version, bins, accuracy (1e-4), zero count, min and max,
+ * then for each store its offset, first used bin, number of bins and the
+ * 32 bit counts of those bins.
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ * @return Number of bytes written, 0 if the buffer is too small
+ */
+size_t WeatherBusLiteSketch::serialize(uint8_t *buffer, size_t size) const {
+    const Store *stores[2] = {&_positive, &_negative};
+    uint8_t first[2];
+    uint8_t length[2];
+    size_t needed = HEADER_SIZE;
+
+    for (uint8_t s = 0; s < 2; s++) {
+        uint8_t low = 0;
+        uint8_t high = 0;
+        bool any = false;
+        for (uint8_t i = 0; i < WEATHERBUSLITE_SKETCH_BINS; i++) {
+            if (stores[s]->counts[i] > 0) {
+                if (!any) {
+                    low = i;
+                    any = true;
+                }
+                high = i;
+            }
+        }
+        first[s] = low;
+        length[s] = any ? high - low + 1 : 0;
+        needed += STORE_HEADER_SIZE + 4 * length[s];
+    }
+
+    if (size < needed) {
+        return 0;
+    }
+
+    uint16_t accuracy = (uint16_t)(WEATHERBUSLITE_SKETCH_ACCURACY * 10000.0f + 0.5f);
+    size_t pos = 0;
+    buffer[pos++] = WEATHERBUSLITE_SKETCH_VERSION;
+    buffer[pos++] = WEATHERBUSLITE_SKETCH_BINS;
+    buffer[pos++] = accuracy & 0xFF;
+    buffer[pos++] = accuracy >> 8;
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[pos++] = (_zeroCount >> (8 * i)) & 0xFF;
+    }
+    memcpy(&buffer[pos], &_min, 4);
+    pos += 4;
+    memcpy(&buffer[pos], &_max, 4);
+    pos += 4;
+
+    for (uint8_t s = 0; s < 2; s++) {
+        uint16_t offset = (uint16_t)stores[s]->offset;
+        buffer[pos++] = offset & 0xFF;
+        buffer[pos++] = offset >> 8;
+        buffer[pos++] = first[s];
+        buffer[pos++] = length[s];
+        for (uint8_t i = 0; i < length[s]; i++) {
+            uint32_t count = stores[s]->counts[first[s] + i];
+            for (uint8_t b = 0; b < 4; b++) {
+                buffer[pos++] = (count >> (8 * b)) & 0xFF;
+            }
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * Load a serialized sketch.
+ *
+ * Replaces the contents of this sketch. Merge it into an accumulating
+ * sketch to combine stations. Also reads version 1 sketches, whose counts
+ * are 16 bit.
+ *
+ * @param buffer Serialized sketch
+ * @param size Size of the serialized sketch
+ * @return True if the sketch was loaded, false if it is malformed or was
+ *         built with different settings
+ */
+bool WeatherBusLiteSketch::deserialize(const uint8_t *buffer, size_t size) {
+    uint16_t accuracy = (uint16_t)(WEATHERBUSLITE_SKETCH_ACCURACY * 10000.0f + 0.5f);
+    if (size < HEADER_SIZE || (buffer[0] != WEATHERBUSLITE_SKETCH_VERSION && buffer[0] != 1)
+        || buffer[1] != WEATHERBUSLITE_SKETCH_BINS
+        || (buffer[2] | (buffer[3] << 8)) != accuracy) {
+        return false;
+    }
+
+    reset();
+    size_t pos = 4;
+    for (uint8_t i = 0; i < 4; i++) {
+        _zeroCount |= (uint32_t)buffer[pos++] << (8 * i);
+    }
+    memcpy(&_min, &buffer[pos], 4);
+    pos += 4;
+    memcpy(&_max, &buffer[pos], 4);
+    pos += 4;
+    _count = _zeroCount;
+    uint8_t countSize = buffer[0] == 1 ? 2 : 4;
+
+    Store *stores[2] = {&_positive, &_negative};
+    for (uint8_t s = 0; s < 2; s++) {
+        if (size < pos + STORE_HEADER_SIZE) {
+            reset();
+            return false;
+        }
+        int16_t offset = (int16_t)(buffer[pos] | (buffer[pos + 1] << 8));
+        uint8_t first = buffer[pos + 2];
+        uint8_t length = buffer[pos + 3];
+        pos += STORE_HEADER_SIZE;
+        if (first + length > WEATHERBUSLITE_SKETCH_BINS || size < pos + countSize * length) {
+            reset();
+            return false;
+        }
+
+        stores[s]->offset = offset;
+        stores[s]->empty = length == 0;
+        for (uint8_t i = 0; i < length; i++) {
+            uint32_t count = 0;
+            for (uint8_t b = 0; b < countSize; b++) {
+                count |= (uint32_t)buffer[pos++] << (8 * b);
+            }
+            stores[s]->counts[first + i] = count;
+            _count += count;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Clear a store.
+ *
+ * @param store The store
+ */
+void WeatherBusLiteSketch::clear(Store &store) {
+    memset(store.counts, 0, sizeof(store.counts));
+    store.offset = 0;
+    store.empty = true;
+}
+
+/**
+ * Add to a bin.
+ *
+ * The store covers WEATHERBUSLITE_SKETCH_BINS consecutive keys. A key above
+ * the range slides the window up, collapsing the lowest bins into the new
+ * first bin, so the upper quantiles keep their accuracy. A key below the
+ * range slides the window down if the top bins are free, otherwise it is
+ * counted in the first bin.
+ *
+ * @param store The store
+ * @param key The bin key
+ * @param count Count to add
+ */
+void WeatherBusLiteSketch::insert(Store &store, int16_t key, uint32_t count) {
+    const int16_t bins = WEATHERBUSLITE_SKETCH_BINS;
+
+    if (store.empty) {
+        store.offset = key - bins / 2;
+        store.empty = false;
+    }
+
+    if (key >= store.offset + bins) {
+        int16_t shift = key - (store.offset + bins - 1);
+        uint64_t collapsed = 0;
+        for (int16_t i = 0; i < bins && i <= shift; i++) {
+            collapsed += store.counts[i];
+        }
+        if (shift < bins) {
+            memmove(&store.counts[0], &store.counts[shift], (bins - shift) * sizeof(store.counts[0]));
+            memset(&store.counts[bins - shift], 0, shift * sizeof(store.counts[0]));
+        } else {
+            memset(store.counts, 0, sizeof(store.counts));
+        }
+        store.counts[0] = collapsed > UINT32_MAX ? UINT32_MAX : collapsed;
+        store.offset += shift;
+    } else if (key < store.offset) {
+        int16_t shift = store.offset - key;
+        int16_t high = bins - 1;
+        while (high >= 0 && store.counts[high] == 0) {
+            high--;
+        }
+        if (high + shift < bins) {
+            memmove(&store.counts[shift], &store.counts[0], (high + 1) * sizeof(store.counts[0]));
+            memset(&store.counts[0], 0, shift * sizeof(store.counts[0]));
+            store.offset = key;
+        } else {
+            key = store.offset;
+        }
+    }
+
+    uint32_t &bin = store.counts[key - store.offset];
+    bin = (uint64_t)bin + count > UINT32_MAX ? UINT32_MAX : bin + count;
+}
+
+/**
+ * Bin key of a value.
+ *
+ * @param value A positive value
+ * @return The key, ceil(log_gamma(value))
+ */
+int16_t WeatherBusLiteSketch::key(float value) {
+    return (int16_t)ceilf(logf(value) / logGamma);
+}
+
+/**
+ * Representative value of a bin.
+ *
+ * @param key The bin key
+ * @return The value with equal relative error to both bin edges
+ */
+float WeatherBusLiteSketch::value(int16_t key) {
+    return 2.0f * expf(key * logGamma) / (GAMMA + 1.0f);
+}
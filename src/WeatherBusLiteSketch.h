@@ -0,0 +1,55 @@
+#ifndef WEATHERBUSLITE_SKETCH_H
+#define WEATHERBUSLITE_SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// bins per sign and relative accuracy; 64 bins at 5% span a 600:1 range
+// before the lowest bins are collapsed
+#define WEATHERBUSLITE_SKETCH_BINS 64
+#define WEATHERBUSLITE_SKETCH_ACCURACY 0.05f
+
+// values closer to zero than this are counted as zero
+#define WEATHERBUSLITE_SKETCH_MIN_VALUE 1e-3f
+
+// serialized format; version 1 had 16 bit counts and is still read
+#define WEATHERBUSLITE_SKETCH_VERSION 2
+
+// Fixed memory quantile sketch (DDSketch) with relative error bounded by
+// WEATHERBUSLITE_SKETCH_ACCURACY. Sketches built with the same settings can
+// be serialized and merged, e.g. on a gateway collecting many stations.
+class WeatherBusLiteSketch {
+public:
+    WeatherBusLiteSketch();
+
+    void reset();
+    void add(float value);
+    void merge(const WeatherBusLiteSketch &other);
+
+    uint32_t count() const;
+    bool quantile(float q, float &value) const;
+
+    size_t serialize(uint8_t *buffer, size_t size) const;
+    bool deserialize(const uint8_t *buffer, size_t size);
+
+private:
+    struct Store {
+        uint32_t counts[WEATHERBUSLITE_SKETCH_BINS];  // 32 bit so merged sketches do not saturate
+        int16_t offset;  // Key of counts[0]
+        bool empty;
+    };
+
+    static void clear(Store &store);
+    static void insert(Store &store, int16_t key, uint32_t count);
+    static int16_t key(float value);
+    static float value(int16_t key);
+
+    Store _positive;
+    Store _negative;  // Keyed by magnitude
+    uint32_t _zeroCount;
+    uint32_t _count;
+    float _min;
+    float _max;
+};
+
+#endif
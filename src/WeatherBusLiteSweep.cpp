@@ -0,0 +1,151 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteSweep.h"
+#include "WeatherBusLite.h"
+
+/**
+ * Constructor.
+ *
+ * @param bus The bus to read
+ */
+WeatherBusLiteSweep::WeatherBusLiteSweep(WeatherBusLite &bus) : _bus(bus), _slotCount(0) {}
+
+/**
+ * Add a sensor.
+ *
+ * New sensors have no statistics yet and are read first, so their latency
+ * is learned on the first sweep.
+ *
+ * @param queryType The sensor type (T, H, etc.)
+ * @param weight How much a late reading of this sensor matters
+ * @return True if the sensor was added, false if all slots are in use
+ */
+bool WeatherBusLiteSweep::add(char queryType, float weight) {
+    if (_slotCount >= WEATHERBUSLITE_SWEEP_SLOTS || weight <= 0.0f) {
+        return false;
+    }
+
+    Slot &slot = _slots[_slotCount++];
+    slot.type = queryType;
+    slot.weight = weight;
+    slot.latency = 0.0f;
+    slot.failureRate = 0.0f;
+    slot.value = 0.0f;
+    slot.valid = false;
+    reorder();
+    return true;
+}
+
+/**
+ * Read every sensor once.
+ *
+ * Updates the statistics as it goes and reorders the sensors for the next
+ * sweep.
+ *
+ * @return Number of sensors read successfully
+ */
+uint8_t WeatherBusLiteSweep::run() {
+    uint8_t readings = 0;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        Slot &slot = _slots[i];
+
+        unsigned long start = millis();
+        slot.valid = _bus.queryCustom(slot.type, slot.value);
+        float latency = (float)(millis() - start);
+
+        slot.failureRate += WEATHERBUSLITE_SWEEP_SMOOTHING * ((slot.valid ? 0.0f : 1.0f) - slot.failureRate);
+        if (slot.valid) {
+            slot.latency += WEATHERBUSLITE_SWEEP_SMOOTHING * (latency - slot.latency);
+            readings++;
+        }
+    }
+
+    reorder();
+    return readings;
+}
+
+/**
+ * Reading of a sensor from the last sweep.
+ *
+ * @param queryType The sensor type
+ * @param value The reading
+ * @return True if the last sweep read the sensor, false otherwise
+ */
+bool WeatherBusLiteSweep::value(char queryType, float &value) const {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        if (_slots[i].type == queryType) {
+            value = _slots[i].value;
+            return _slots[i].valid;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sensor read at a position of the next sweep.
+ *
+ * @param position 0 for the first sensor read
+ * @return The sensor type, 0 if there is no such position
+ */
+char WeatherBusLiteSweep::order(uint8_t position) const {
+    return position < _slotCount ? _slots[position].type : 0;
+}
+
+/**
+ * Expected duration of the next sweep.
+ *
+ * @return Duration in milliseconds
+ */
+float WeatherBusLiteSweep::expectedDuration() const {
+    float duration = 0.0f;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        duration += cost(_slots[i]);
+    }
+    return duration;
+}
+
+/**
+ * Expected time a sensor holds up the sweep.
+ *
+ * @param slot The sensor
+ * @return Time in milliseconds
+ */
+float WeatherBusLiteSweep::cost(const Slot &slot) const {
+    return (1.0f - slot.failureRate) * slot.latency + slot.failureRate * WEATHERBUSLITE_RESPONSE_TIMEOUT;
+}
+
+/**
+ * Sort the sensors by cost / weight.
+ *
+ * Insertion sort: the order rarely changes much between sweeps, so this is
+ * close to a single pass.
+ */
+void WeatherBusLiteSweep::reorder() {
+    for (uint8_t i = 1; i < _slotCount; i++) {
+        Slot slot = _slots[i];
+        float key = cost(slot) / slot.weight;
+        uint8_t j = i;
+        while (j > 0 && cost(_slots[j - 1]) / _slots[j - 1].weight > key) {
+            _slots[j] = _slots[j - 1];
+            j--;
+        }
+        _slots[j] = slot;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef WEATHERBUSLITE_SWEEP_H
+#define WEATHERBUSLITE_SWEEP_H
+
+#include <stdint.h>
+
+#define WEATHERBUSLITE_SWEEP_SLOTS 10
+
+// smoothing factor of the latency and failure rate averages
+#define WEATHERBUSLITE_SWEEP_SMOOTHING 0.25f
+
+class WeatherBusLite;
+
+// Reads a set of sensors in the order that keeps the weighted staleness of
+// the sweep lowest. Each sensor's response latency and failure rate are
+// learned; its expected cost is the latency plus the failure rate times the
+// response timeout, and sensors are read in increasing cost / weight
+// (Smith's rule), so quick and important sensors are not held up behind
+// slow or unreliable ones.
+class WeatherBusLiteSweep {
+public:
+    WeatherBusLiteSweep(WeatherBusLite &bus);
+
+    bool add(char queryType, float weight = 1.0f);
+    uint8_t run();
+
+    bool value(char queryType, float &value) const;
+    char order(uint8_t position) const;
+    float expectedDuration() const;
+
+private:
+    struct Slot {
+        char type;
+        float weight;
+        float latency;      // Average response time of successful queries, ms
+        float failureRate;  // Share of queries that failed, 0 to 1
+        float value;        // Reading of the last sweep
+        bool valid;         // Whether the last sweep got a reading
+    };
+
+    float cost(const Slot &slot) const;
+    void reorder();
+
+    WeatherBusLite &_bus;
+    Slot _slots[WEATHERBUSLITE_SWEEP_SLOTS];
+    uint8_t _slotCount;
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteTendency.h"
+
+#define INTERVALS_PER_3H (10800000UL / WEATHERBUSLITE_TENDENCY_INTERVAL)
+
+// Constructor
+WeatherBusLiteTendency::WeatherBusLiteTendency() {
+    reset();
+}
+
+/**
+ * Reset the tracker.
+ *
+ * Discards all samples, e.g. after the pressure sensor has been offline.
+ */
+void WeatherBusLiteTendency::reset() {
+    _head = 0;
+    _count = 0;
+    _sumY = 0;
+    _sumXY = 0;
+    _accumulator = 0.0f;
+    _accumulated = 0;
+    _intervalStart = 0;
+    _lastUpdate = 0;
+}
+
+/**
+ * Add a pressure reading.
+ *
+ * Readings are averaged over consecutive WEATHERBUSLITE_TENDENCY_INTERVAL
+ * intervals, timed from the first reading, and each average is added to the
+ * window. A gap of more than three intervals between readings
+ * restarts the window since the samples would no longer be evenly spaced.
+ *
+ * @param pressure Station pressure in hPa, as returned by queryPressure
+ * @param now Current time in milliseconds
+ */
+void WeatherBusLiteTendency::update(float pressure, unsigned long now) {
+    if ((_count > 0 || _accumulated > 0) && now - _lastUpdate > 3 * WEATHERBUSLITE_TENDENCY_INTERVAL) {
+        reset();
+    }
+    _lastUpdate = now;
+
+    if (_accumulated > 0 && now - _intervalStart >= WEATHERBUSLITE_TENDENCY_INTERVAL) {
+        float average = _accumulator / _accumulated;
+        uint16_t sample = (uint16_t)(average * 10.0f + 0.5f);
+        _accumulator = 0.0f;
+        _accumulated = 0;
+
+        // Intervals stay on a fixed grid whatever the poll period; an
+        // interval without readings repeats the last average
+        unsigned long elapsed = (now - _intervalStart) / WEATHERBUSLITE_TENDENCY_INTERVAL;
+        _intervalStart += elapsed * WEATHERBUSLITE_TENDENCY_INTERVAL;
+        while (elapsed-- > 0) {
+            push(sample);
+        }
+    }
+
+    if (_count == 0 && _accumulated == 0) {
+        _intervalStart = now;
+    }
+    _accumulator += pressure;
+    _accumulated++;
+}
+
+/**
+ * Get the pressure tendency.
+ *
+ * Least squares slope over the window, scaled to a 3 hour change. Available
+ * once the window is at least half full.
+ *
+ * @param change Pressure change over 3 hours in hPa
+ * @return True if enough samples are available, false otherwise
+ */
+bool WeatherBusLiteTendency::tendency(float &change) const {
+    if (_count < WEATHERBUSLITE_TENDENCY_SAMPLES / 2) {
+        return false;
+    }
+
+    int64_t n = _count;
+    int64_t sumX = n * (n - 1) / 2;
+    int64_t sumXX = (n - 1) * n * (2 * n - 1) / 6;
+    int64_t numerator = n * _sumXY - sumX * _sumY;
+    int64_t denominator = n * sumXX - sumX * sumX;
+
+    // Slope is in 0.1 hPa per interval
+    change = (float)numerator / (float)denominator * (INTERVALS_PER_3H / 10.0f);
+    return true;
+}
+
+/**
+ * Classify the pressure tendency.
+ *
+ * @return Rising, falling or steady, unknown until enough samples are available
+ */
+WeatherBusLiteTrend WeatherBusLiteTendency::trend() const {
+    float change;
+    if (!tendency(change)) {
+        return WEATHERBUSLITE_TREND_UNKNOWN;
+    }
+    if (change >= WEATHERBUSLITE_TENDENCY_STEADY) {
+        return WEATHERBUSLITE_TREND_RISING;
+    }
+    if (change <= -WEATHERBUSLITE_TENDENCY_STEADY) {
+        return WEATHERBUSLITE_TREND_FALLING;
+    }
+    return WEATHERBUSLITE_TREND_STEADY;
+}
+
+/**
+ * Zambretti forecast.
+ *
+ * Computes the Zambretti forecast number from the sea level pressure and the
+ * current trend: 1-9 when falling, 10-19 when steady and 20-32 when rising,
+ * with lower numbers meaning more settled weather.
+ *
+ * @param seaLevelPressure Sea level pressure in hPa
+ * @return Forecast number, 0 if the trend is not known yet
+ */
+uint8_t WeatherBusLiteTendency::forecast(float seaLevelPressure) const {
+    float z;
+    uint8_t low, high;
+
+    switch (trend()) {
+        case WEATHERBUSLITE_TREND_FALLING:
+            z = 127.0f - 0.12f * seaLevelPressure;
+            low = 1;
+            high = 9;
+            break;
+        case WEATHERBUSLITE_TREND_STEADY:
+            z = 144.0f - 0.13f * seaLevelPressure;
+            low = 10;
+            high = 19;
+            break;
+        case WEATHERBUSLITE_TREND_RISING:
+            z = 185.0f - 0.16f * seaLevelPressure;
+            low = 20;
+            high = 32;
+            break;
+        default:
+            return 0;
+    }
+
+    if (z < low) {
+        return low;
+    }
+    if (z > high) {
+        return high;
+    }
+    return (uint8_t)(z + 0.5f);
+}
+
+/**
+ * Add a sample to the window.
+ *
+ * Keeps the sums needed for the slope up to date. When the window is full
+ * the oldest sample drops out and every remaining sample moves one index
+ * down, which takes the current sum off the weighted sum.
+ *
+ * @param sample Pressure in 0.1 hPa
+ */
+void WeatherBusLiteTendency::push(uint16_t sample) {
+    if (_count < WEATHERBUSLITE_TENDENCY_SAMPLES) {
+        _samples[(_head + _count) % WEATHERBUSLITE_TENDENCY_SAMPLES] = sample;
+        _sumXY += (int32_t)_count * sample;
+        _sumY += sample;
+        _count++;
+        return;
+    }
+
+    _sumY -= _samples[_head];
+    _sumXY -= _sumY;
+    _samples[_head] = sample;
+    _head = (_head + 1) % WEATHERBUSLITE_TENDENCY_SAMPLES;
+    _sumXY += (int32_t)(WEATHERBUSLITE_TENDENCY_SAMPLES - 1) * sample;
+    _sumY += sample;
+}
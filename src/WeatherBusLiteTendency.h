@@ -0,0 +1,49 @@
+#ifndef WEATHERBUSLITE_TENDENCY_H
+#define WEATHERBUSLITE_TENDENCY_H
+
+#include <stdint.h>
+
+// window: 36 decimated samples, 5 minutes apart, cover 3 hours
+#define WEATHERBUSLITE_TENDENCY_SAMPLES 36
+#define WEATHERBUSLITE_TENDENCY_INTERVAL 300000UL
+
+// change over 3 hours (hPa) below which pressure is considered steady
+#define WEATHERBUSLITE_TENDENCY_STEADY 1.6f
+
+enum WeatherBusLiteTrend {
+    WEATHERBUSLITE_TREND_UNKNOWN,
+    WEATHERBUSLITE_TREND_FALLING,
+    WEATHERBUSLITE_TREND_STEADY,
+    WEATHERBUSLITE_TREND_RISING
+};
+
+// Tracks the 3 hour barometric tendency from queryPressure readings. Samples
+// are averaged into fixed intervals and the least squares slope over the
+// window is maintained in integer arithmetic, so each update is O(1).
+class WeatherBusLiteTendency {
+public:
+    WeatherBusLiteTendency();
+
+    void reset();
+    void update(float pressure, unsigned long now);
+
+    bool tendency(float &change) const;
+    WeatherBusLiteTrend trend() const;
+    uint8_t forecast(float seaLevelPressure) const;
+
+private:
+    void push(uint16_t sample);
+
+    uint16_t _samples[WEATHERBUSLITE_TENDENCY_SAMPLES];  // Pressure in 0.1 hPa
+    uint8_t _head;    // Index of the oldest sample
+    uint8_t _count;   // Number of samples in the window
+    int32_t _sumY;    // Sum of samples
+    int32_t _sumXY;   // Sum of sample index times sample, oldest at index 0
+
+    float _accumulator;  // Readings averaged into the current interval
+    uint16_t _accumulated;
+    unsigned long _intervalStart;
+    unsigned long _lastUpdate;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *
+ * This file is part of the WeatherBusLite library.
+ * Copyright (c) 2025 Nikolai Patrick
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WeatherBusLiteUpdate.h"
+#include "WeatherBusLite.h"
+#include "WeatherBusLiteCrc.h"
+
+/**
+ * Constructor.
+ *
+ * @param bus The bus the nodes are on
+ * @param group The group type the nodes listen on
+ */
+WeatherBusLiteUpdater::WeatherBusLiteUpdater(WeatherBusLite &bus, char group)
+    : _bus(bus), _group(group), _blocksSent(0) {}
+
+/**
+ * Send the image to every node in the group at once.
+ *
+ * @param image The firmware image
+ * @param length Size of the image in bytes
+ */
+void WeatherBusLiteUpdater::broadcast(const uint8_t *image, uint32_t length) {
+    WeatherBusLiteBlockSender sender(_bus, _group);
+    sender.broadcast(image, length);
+    _blocksSent += sender.blocksSent();
+}
+
+/**
+ * Complete the transfer to one node and swap to the new image.
+ *
+ * Resumes the transfer, which only repeats the blocks the node is missing
+ * (all of them if there was no broadcast), then asks the node to verify
+ * the image and swap. A node whose image fails verification starts over,
+ * so calling this again sends the whole image.
+ *
+ * @param type The node's sensor type (T, H, etc.)
+ * @param image The firmware image
+ * @param length Size of the image in bytes
+ * @return True if the node verified the image and will swap, false otherwise
+ */
+bool WeatherBusLiteUpdater::update(char type, const uint8_t *image, uint32_t length) {
+    WeatherBusLiteBlockSender sender(_bus, type, WEATHERBUSLITE_UPDATE_WINDOW);
+    bool sent = sender.send(image, length);
+    _blocksSent += sender.blocksSent();
+    if (!sent) {
+        return false;
+    }
+
+    char swap[24];
+    snprintf(swap, sizeof(swap), "#%cW:%lx,%x", type, (unsigned long)length, weatherBusLiteCrc16(image, length));
+    char response[32];
+    for (uint8_t attempt = 0; attempt <= WEATHERBUSLITE_BLOCK_RETRIES; attempt++) {
+        _bus.sendQuery(swap);
+        if (_bus.readFrame(type, response, sizeof(response)) >= 0
+            && response[1] == '#' && response[2] == 'W' && response[3] == ':') {
+            return response[4] == '1';
+        }
+    }
+    return false;
+}
+
+/**
+ * Number of block frames sent.
+ *
+ * @return Blocks sent by broadcasts and updates, including repairs
+ */
+uint32_t WeatherBusLiteUpdater::blocksSent() const {
+    return _blocksSent;
+}
+
+/**
+ * Constructor.
+ *
+ * @param type This node's sensor type (T, H, etc.)
+ * @param staging Where the image is written
+ * @param capacity Largest image the staging area holds
+ * @param map Storage for one bit per block, at least capacity / 384 bytes
+ * @param mapSize Size of the map in bytes
+ * @param group The group type identical nodes listen on
+ */
+WeatherBusLiteUpdate::WeatherBusLiteUpdate(char type, WeatherBusLiteBlockSink &staging, uint32_t capacity,
+                                           uint8_t *map, size_t mapSize, char group)
+    : _receiver(type, staging, capacity), _type(type), _swapPending(false) {
+    _receiver.setGroup(group);
+    _receiver.setMap(map, mapSize);
+}
+
+/**
+ * Handle a received line.
+ *
+ * @param line The line, without the newline
+ * @param out Where to write replies, e.g. RS485
+ * @return True if the line belonged to the update, false otherwise
+ */
+bool WeatherBusLiteUpdate::handle(const char *line, Print &out) {
+    if (line[0] != '#' || line[1] != _type || line[2] != 'W' || line[3] != ':') {
+        return _receiver.handle(line, out);
+    }
+
+    char *end;
+    uint32_t length = strtoul(line + 4, &end, 16);
+    uint16_t crc = *end == ',' ? strtoul(end + 1, nullptr, 16) : 0;
+    bool verified = length == _receiver.length() && crc == _receiver.crc() && _receiver.complete();
+    if (verified) {
+        _swapPending = true;
+    }
+
+    out.print(_type);
+    out.print("#W:");
+    out.print(verified ? '1' : '0');
+    out.println();
+    return true;
+}
+
+/**
+ * Check whether a verified image is waiting to be swapped in.
+ *
+ * @return True once the master has confirmed the swap, false otherwise
+ */
+bool WeatherBusLiteUpdate::swapPending() const {
+    return _swapPending;
+}
+
+/**
+ * Length of the image being received.
+ *
+ * @return Length in bytes
+ */
+uint32_t WeatherBusLiteUpdate::length() const {
+    return _receiver.length();
+}
@@ -0,0 +1,63 @@
+#ifndef WEATHERBUSLITE_UPDATE_H
+#define WEATHERBUSLITE_UPDATE_H
+
+#include <Arduino.h>
+
+#include "WeatherBusLiteBlock.h"
+
+// default group type identical nodes listen on for broadcast updates
+#define WEATHERBUSLITE_UPDATE_GROUP '*'
+
+// window used when repairing a node after the broadcast
+#define WEATHERBUSLITE_UPDATE_WINDOW 32
+
+class WeatherBusLite;
+
+// Firmware update over the bus, built on the block transfer. The image is
+// broadcast once to the group, each node is then polled on its own type
+// and sent the blocks it missed, and finally told to swap:
+//
+// Swap:    #TW:<length>,<crc>        (node replies with the result)
+// Result:  T#W:<1|0>
+//
+// The node only agrees to swap after reading the whole image back from its
+// staging area and checking the CRC. If the CRC does not match, the node
+// starts the transfer over, so the next update() sends the whole image.
+// The swap itself is left to the sketch and its bootloader, since it
+// depends on the board.
+
+// Master side: updates a set of identical nodes.
+class WeatherBusLiteUpdater {
+public:
+    WeatherBusLiteUpdater(WeatherBusLite &bus, char group = WEATHERBUSLITE_UPDATE_GROUP);
+
+    void broadcast(const uint8_t *image, uint32_t length);
+    bool update(char type, const uint8_t *image, uint32_t length);
+
+    uint32_t blocksSent() const;
+
+private:
+    WeatherBusLite &_bus;
+    char _group;
+    uint32_t _blocksSent;
+};
+
+// Node side: receives an image into a staging area such as the upper half
+// of flash. Once swapPending() returns true the sketch hands the image to
+// its bootloader, e.g. InternalStorage.apply() with ArduinoOTA.
+class WeatherBusLiteUpdate {
+public:
+    WeatherBusLiteUpdate(char type, WeatherBusLiteBlockSink &staging, uint32_t capacity, uint8_t *map,
+                         size_t mapSize, char group = WEATHERBUSLITE_UPDATE_GROUP);
+
+    bool handle(const char *line, Print &out);
+    bool swapPending() const;
+    uint32_t length() const;
+
+private:
+    WeatherBusLiteBlockReceiver _receiver;
+    char _type;
+    bool _swapPending;
+};
+
+#endif
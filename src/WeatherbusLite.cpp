@@ -20,17 +20,35 @@
 #include "WeatherBusLite.h"
 
 // Constructor
-WeatherBusLite::WeatherBusLite() {}
+WeatherBusLite::WeatherBusLite()
+    : _sensorCount(0), _latencySketch(nullptr), _queryStart(0), _baudRate(WEATHERBUSLITE_BAUDRATE),
+      _echoSuppression(false), _frameStart(WEATHERBUSLITE_FRAME_START),
+      _defaultProfile(WEATHERBUSLITE_PROFILE_LEGACY),
+      _responseTime(0) {
+    memset(&_fields, 0, sizeof(_fields));
+}
 
 /** 
  * Initialize communication.
  * 
- * Inits the RS485 communication with the specified baud rate.
+ * Inits the RS485 communication with the specified baud rate and loads the
+ * per-sensor calibration table. The table is not copied and must stay valid.
  * 
  * @param baudRate Baud rate for RS485 communication
+ * @param calibrations Calibration table, one entry per sensor type
+ * @param calibrationCount Number of entries in the calibration table
  */
-void WeatherBusLite::begin(uint32_t baudRate) {
+void WeatherBusLite::begin(uint32_t baudRate, const WeatherBusLiteCalibration *calibrations,
+                           uint8_t calibrationCount) {
     RS485.begin(baudRate);
+    _baudRate = baudRate;
+
+    for (uint8_t i = 0; i < calibrationCount; i++) {
+        Sensor *sensor = findSensor(calibrations[i].type, true);
+        if (sensor != nullptr) {
+            sensor->calibration = &calibrations[i];
+        }
+    }
 }
 
 /**
@@ -42,8 +60,20 @@ void WeatherBusLite::begin(uint32_t baudRate) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryTemp(float &temperature) {
+    uint8_t flags;
+    return queryTemp(temperature, flags);
+}
+
+/**
+ * Query temperature sensor with quality flags.
+ * 
+ * @param temperature Temperature in degrees Celsius
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryTemp(float &temperature, uint8_t &flags) {
     sendQuery("?T");
-    return parseResponse('T', temperature);
+    return parseResponse('T', temperature, flags);
 }
 
 /**
@@ -55,8 +85,20 @@ bool WeatherBusLite::queryTemp(float &temperature) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryHumidity(float &humidity) {
+    uint8_t flags;
+    return queryHumidity(humidity, flags);
+}
+
+/**
+ * Query humidity sensor with quality flags.
+ * 
+ * @param humidity Humidity in percentage
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryHumidity(float &humidity, uint8_t &flags) {
     sendQuery("?H");
-    return parseResponse('H', humidity);
+    return parseResponse('H', humidity, flags);
 }
 
 /**
@@ -68,8 +110,20 @@ bool WeatherBusLite::queryHumidity(float &humidity) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryPressure(float &pressure) {
+    uint8_t flags;
+    return queryPressure(pressure, flags);
+}
+
+/**
+ * Query pressure sensor with quality flags.
+ * 
+ * @param pressure Pressure in hPa
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryPressure(float &pressure, uint8_t &flags) {
     sendQuery("?P");
-    return parseResponse('P', pressure);
+    return parseResponse('P', pressure, flags);
 }
 
 /**
@@ -81,8 +135,20 @@ bool WeatherBusLite::queryPressure(float &pressure) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryAirQuality(float &airQuality) {
+    uint8_t flags;
+    return queryAirQuality(airQuality, flags);
+}
+
+/**
+ * Query air quality sensor with quality flags.
+ * 
+ * @param airQuality Air quality index
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryAirQuality(float &airQuality, uint8_t &flags) {
     sendQuery("?A");
-    return parseResponse('A', airQuality);
+    return parseResponse('A', airQuality, flags);
 }
 
 /**
@@ -94,8 +160,20 @@ bool WeatherBusLite::queryAirQuality(float &airQuality) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryUV(float &UV) {
+    uint8_t flags;
+    return queryUV(UV, flags);
+}
+
+/**
+ * Query UV sensor with quality flags.
+ * 
+ * @param UV UV index
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryUV(float &UV, uint8_t &flags) {
     sendQuery("?U");
-    return parseResponse('U', UV);
+    return parseResponse('U', UV, flags);
 }
 
 /**
@@ -107,8 +185,20 @@ bool WeatherBusLite::queryUV(float &UV) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryRainfall(float &rainfall) {
+    uint8_t flags;
+    return queryRainfall(rainfall, flags);
+}
+
+/**
+ * Query rainfall sensor with quality flags.
+ * 
+ * @param rainfall Rainfall in mm
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryRainfall(float &rainfall, uint8_t &flags) {
     sendQuery("?R");
-    return parseResponse('R', rainfall);
+    return parseResponse('R', rainfall, flags);
 }
 
 /**
@@ -120,8 +210,20 @@ bool WeatherBusLite::queryRainfall(float &rainfall) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryWindSpeed(float &windSpeed) {
+    uint8_t flags;
+    return queryWindSpeed(windSpeed, flags);
+}
+
+/**
+ * Query wind speed sensor with quality flags.
+ * 
+ * @param windSpeed Wind speed in m/s
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryWindSpeed(float &windSpeed, uint8_t &flags) {
     sendQuery("?W");
-    return parseResponse('W', windSpeed);
+    return parseResponse('W', windSpeed, flags);
 }
 
 /**
@@ -133,8 +235,20 @@ bool WeatherBusLite::queryWindSpeed(float &windSpeed) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryWindDirection(float &windDirection) {
+    uint8_t flags;
+    return queryWindDirection(windDirection, flags);
+}
+
+/**
+ * Query wind direction sensor with quality flags.
+ * 
+ * @param windDirection Wind direction in degrees
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryWindDirection(float &windDirection, uint8_t &flags) {
     sendQuery("?D");
-    return parseResponse('D', windDirection);
+    return parseResponse('D', windDirection, flags);
 }
 
 /**
@@ -146,8 +260,20 @@ bool WeatherBusLite::queryWindDirection(float &windDirection) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryCanopyTemperature(float &canopyTemperature) {
+    uint8_t flags;
+    return queryCanopyTemperature(canopyTemperature, flags);
+}
+
+/**
+ * Query canopy temperature sensor with quality flags.
+ * 
+ * @param canopyTemperature Canopy temperature in degrees Celsius
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryCanopyTemperature(float &canopyTemperature, uint8_t &flags) {
     sendQuery("?C");
-    return parseResponse('C', canopyTemperature);
+    return parseResponse('C', canopyTemperature, flags);
 }
 
 /**
@@ -160,9 +286,359 @@ bool WeatherBusLite::queryCanopyTemperature(float &canopyTemperature) {
  * @return True if query was successful, false otherwise
  */
 bool WeatherBusLite::queryCustom(char queryType, float &value) {
+    uint8_t flags;
+    return queryCustom(queryType, value, flags);
+}
+
+/**
+ * Run a custom query with quality flags.
+ * 
+ * @param queryType The type of query to run
+ * @param value The value of the query
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported by the node
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryCustom(char queryType, float &value, uint8_t &flags) {
+    char query[3] = {'?', queryType, '\0'};
+    sendQuery(query);
+    return parseResponse(queryType, value, flags);
+}
+
+/**
+ * Read a sensor unless a recent reading is cached.
+ * 
+ * Returns the last reading without touching the bus if it was sampled at
+ * most maxAge ago. Also returns it when the node has reported (",+" field)
+ * that it has not taken a newer sample yet, since a query could not return
+ * anything fresher. Otherwise the sensor is queried.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param value The reading
+ * @param maxAge Oldest acceptable sample age in milliseconds
+ * @return True if a reading is available, false otherwise
+ */
+bool WeatherBusLite::queryFresh(char queryType, float &value, unsigned long maxAge) {
+    uint8_t flags;
+    return queryFresh(queryType, value, maxAge, flags);
+}
+
+/**
+ * Read a sensor unless a recent reading is cached, with quality flags.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param value The reading
+ * @param maxAge Oldest acceptable sample age in milliseconds
+ * @param flags WEATHERBUSLITE_FLAG_* bits reported with the reading
+ * @return True if a reading is available, false otherwise
+ */
+bool WeatherBusLite::queryFresh(char queryType, float &value, unsigned long maxAge, uint8_t &flags) {
+    Sensor *sensor = findSensor(queryType, true);
+    if (sensor != nullptr && sensor->cacheValid) {
+        unsigned long now = millis();
+        bool fresh = now - sensor->cachedTime <= maxAge;
+        bool unchanged = sensor->nextSampleKnown && (long)(now - sensor->nextSample) < 0;
+        if (fresh || unchanged) {
+            value = sensor->cached;
+            flags = sensor->cachedFlags;
+            return true;
+        }
+    }
+    return queryCustom(queryType, value, flags);
+}
+
+/**
+ * Download buffered samples.
+ * 
+ * Fetches samples the node buffered while the master was not polling, e.g.
+ * after an outage, oldest first. Each call acknowledges the samples of the
+ * previous call, so call it until it returns no samples. Each acknowledgement
+ * is sent once, so if a reply is lost the node sends those samples again
+ * instead of dropping them: a sample may arrive twice but is never lost.
+ * Sample times are converted to this board's millis(). Calibration is
+ * applied, the filter and sketches are not.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param samples Buffer for the samples
+ * @param max Size of the buffer, at most WEATHERBUSLITE_HISTORY_BATCH
+ * @param count Number of samples received
+ * @return True if query was successful, false otherwise
+ */
+bool WeatherBusLite::queryHistory(char queryType, WeatherBusLiteSample *samples, uint8_t max, uint8_t &count) {
+    count = 0;
+    if (max > WEATHERBUSLITE_HISTORY_BATCH) {
+        max = WEATHERBUSLITE_HISTORY_BATCH;
+    }
+
+    Sensor *sensor = findSensor(queryType, true);
+    uint8_t acked = sensor != nullptr ? sensor->historyReceived : 0;
+
+    char query[12];
+    snprintf(query, sizeof(query), "?%c*%u,%u", queryType, max, acked);
+    sendQuery(query);
+    if (sensor != nullptr) {
+        sensor->historyReceived = 0;  // Acknowledged once, even if the reply is lost
+    }
+
+    char response[WEATHERBUSLITE_HISTORY_BATCH * 24 + 8];
+    int length = readFrame(queryType, response, sizeof(response));
+    if (length < 0) {
+        return false;
+    }
+    if (response[1] != '*' || response[2] != ':') {
+        return false;
+    }
+
+    // Ages count from when the node started the reply, so take off its time on the wire
+    length += 2;  // With CRLF
+    uint8_t used = profile(queryType);
+    if (used != WEATHERBUSLITE_PROFILE_LEGACY) {
+        length++;  // Start marker
+    }
+    if (used == WEATHERBUSLITE_PROFILE_CHECKSUMMED) {
+        length += 5;  // '*' and the CRC, taken as four digits
+    }
+    unsigned long received = millis() - (length * 10000UL + _baudRate / 2) / _baudRate;
+
+    // Entries are "<age>,<value>" then ";<delta>,<value>" for each further sample
+    char *pos = response + 3;
+    unsigned long time = received;
+    while (count < max && *pos != '\0' && *pos != '\r') {
+        char *end;
+        unsigned long offset = strtoul(pos, &end, 10);
+        if (end == pos || *end != ',') {
+            return false;
+        }
+        pos = end + 1;
+        float value = strtod(pos, &end);
+        if (end == pos) {
+            return false;
+        }
+        pos = *end == ';' ? end + 1 : end;
+
+        time = count == 0 ? received - offset : time + offset;
+        if (sensor != nullptr && sensor->calibration != nullptr) {
+            value = weatherBusLiteCalibrate(*sensor->calibration, value);
+        }
+        samples[count].time = time;
+        samples[count].value = value;
+        count++;
+    }
+
+    if (sensor != nullptr) {
+        sensor->historyReceived = count;
+    }
+    return true;
+}
+
+/**
+ * Collect query latencies.
+ * 
+ * Adds the latency of every successful query, in milliseconds, to the sketch.
+ * 
+ * @param sketch The sketch, or nullptr to stop collecting
+ */
+void WeatherBusLite::setLatencySketch(WeatherBusLiteSketch *sketch) {
+    _latencySketch = sketch;
+}
+
+/**
+ * Collect sensor values.
+ * 
+ * Adds every value successfully read from the sensor to the sketch.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param sketch The sketch, or nullptr to stop collecting
+ * @return True if the sketch was attached, false if too many sensors are configured
+ */
+bool WeatherBusLite::setValueSketch(char queryType, WeatherBusLiteSketch *sketch) {
+    Sensor *sensor = findSensor(queryType, sketch != nullptr);
+    if (sensor == nullptr) {
+        return sketch == nullptr;
+    }
+    sensor->sketch = sketch;
+    return true;
+}
+
+/**
+ * Discard the echo of our own frames.
+ * 
+ * For transceivers whose receiver cannot be disabled while transmitting.
+ * The receiver is left on permanently and the echo of each frame is read
+ * back and compared byte for byte right after sending, so it never reaches
+ * the frame parser. The first byte that does not match is left in place.
+ * 
+ * Call after begin().
+ * 
+ * @param enabled True to suppress echoes, false to gate the receiver
+ */
+void WeatherBusLite::setEchoSuppression(bool enabled) {
+    _echoSuppression = enabled;
+    if (enabled) {
+        RS485.receive();
+    } else {
+        RS485.noReceive();
+    }
+}
+
+/**
+ * Require a start marker before every response frame.
+ * 
+ * Nodes must then write the marker before each reply, e.g. by printing
+ * through a WeatherBusLiteFramedPrint. Noise or a stale partial reply can no
+ * longer start a frame, and the next marker recovers from it. Makes
+ * WEATHERBUSLITE_PROFILE_MARKED the default profile, or
+ * WEATHERBUSLITE_PROFILE_LEGACY if the marker is 0.
+ * 
+ * @param marker The marker, e.g. WEATHERBUSLITE_FRAME_START, or 0 for none
+ */
+void WeatherBusLite::setFrameStart(char marker) {
+    if (marker != 0) {
+        _frameStart = marker;
+    }
+    _defaultProfile = marker != 0 ? WEATHERBUSLITE_PROFILE_MARKED : WEATHERBUSLITE_PROFILE_LEGACY;
+}
+
+/**
+ * Choose the protocol profile of one node.
+ * 
+ * Lets nodes with old and new firmware share the bus. The profile applies
+ * to every frame sent to or read from this type.
+ * 
+ * @param queryType The node's sensor type (T, H, etc.)
+ * @param profile WEATHERBUSLITE_PROFILE_*, DEFAULT to follow setFrameStart
+ * @return True if the profile was set, false if too many sensors are configured
+ */
+bool WeatherBusLite::setProfile(char queryType, uint8_t profile) {
+    Sensor *sensor = findSensor(queryType, true);
+    if (sensor == nullptr || profile > WEATHERBUSLITE_PROFILE_CHECKSUMMED) {
+        return false;
+    }
+    sensor->profile = profile;
+    return true;
+}
+
+/**
+ * Get the protocol profile of a node.
+ * 
+ * @param queryType The node's sensor type (T, H, etc.)
+ * @return The profile in use, never WEATHERBUSLITE_PROFILE_DEFAULT
+ */
+uint8_t WeatherBusLite::profile(char queryType) {
+    Sensor *sensor = findSensor(queryType, false);
+    return sensor != nullptr && sensor->profile != WEATHERBUSLITE_PROFILE_DEFAULT ? sensor->profile
+                                                                                 : _defaultProfile;
+}
+
+/**
+ * Move a node to the checksummed profile if its firmware supports it.
+ * 
+ * Sends a checksummed query; a node that answers it correctly keeps the
+ * new profile, any other node keeps its previous setting, including
+ * DEFAULT. Costs one response timeout for nodes that do not understand
+ * marked queries.
+ *
+ * The target is the checksummed rather than the cheaper marked profile
+ * because only the CRC catches a corrupted value. It costs up to 7 more
+ * characters per exchange, half again the wire time of a short reading,
+ * in exchange for never accepting a reading damaged in transit.
+ * 
+ * @param queryType The node's sensor type (T, H, etc.)
+ * @return True if the node now uses the checksummed profile, false otherwise
+ */
+bool WeatherBusLite::upgradeProfile(char queryType) {
+    if (profile(queryType) == WEATHERBUSLITE_PROFILE_CHECKSUMMED) {
+        return true;
+    }
+    Sensor *sensor = findSensor(queryType, true);
+    if (sensor == nullptr) {
+        return false;
+    }
+    uint8_t stored = sensor->profile;  // May be DEFAULT, which must keep following setFrameStart
+    sensor->profile = WEATHERBUSLITE_PROFILE_CHECKSUMMED;
+
     char query[3] = {'?', queryType, '\0'};
+    char response[32];
     sendQuery(query);
-    return parseResponse(queryType, value);
+    if (readFrame(queryType, response, sizeof(response)) < 0) {
+        sensor->profile = stored;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Filter sensor readings.
+ * 
+ * Runs every reading from the sensor through the filter. Readings the
+ * filter rejects make the query fail.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param filter The filter, or nullptr to remove it
+ * @return True if the filter was attached, false if too many sensors are configured
+ */
+bool WeatherBusLite::setFilter(char queryType, WeatherBusLiteFilter *filter) {
+    Sensor *sensor = findSensor(queryType, filter != nullptr);
+    if (sensor == nullptr) {
+        return filter == nullptr;
+    }
+    sensor->filter = filter;
+    return true;
+}
+
+/**
+ * Broadcast the time.
+ * 
+ * Sends this board's millis() to every node so they can discipline their
+ * clocks (see WeatherBusLiteClock). The time is advanced by the frame's
+ * transmission time so it is correct when the node sees the newline. Call
+ * it periodically, e.g. every few minutes.
+ */
+void WeatherBusLite::broadcastTime() {
+    char frame[16];
+    unsigned long now = millis();
+    int length = snprintf(frame, sizeof(frame), "!S:%lu", now) + 2;  // With CRLF
+    snprintf(frame, sizeof(frame), "!S:%lu", now + (length * 10000UL + _baudRate / 2) / _baudRate);
+    sendQuery(frame);
+}
+
+/**
+ * Get the sample time of the last reading.
+ * 
+ * Available when the node stamps its replies with a synced clock (",@"
+ * field) or reports the sample age (",~" field).
+ * 
+ * @param time This board's millis() when the node took the sample
+ * @return True if the last response carried a timestamp, false otherwise
+ */
+bool WeatherBusLite::lastSampleTime(unsigned long &time) const {
+    if (_fields.hasSampleTime) {
+        time = _fields.sampleTime;
+        return true;
+    }
+    if (_fields.hasSampleAge) {
+        time = _responseTime - _fields.sampleAge;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Get when a node takes its next sample.
+ * 
+ * Available when the node reports its schedule (",+" field). Polling right
+ * after this time gets the new sample with the least delay.
+ * 
+ * @param queryType The sensor type (T, H, etc.)
+ * @param time This board's millis() when the next sample is expected
+ * @return True if the node reported its schedule, false otherwise
+ */
+bool WeatherBusLite::nextSampleDue(char queryType, unsigned long &time) {
+    Sensor *sensor = findSensor(queryType, false);
+    if (sensor == nullptr || !sensor->nextSampleKnown) {
+        return false;
+    }
+    time = sensor->nextSample;
+    return true;
 }
 
 /**
@@ -173,14 +649,71 @@ bool WeatherBusLite::queryCustom(char queryType, float &value) {
  * @param query The query to send
  */
 void WeatherBusLite::sendQuery(const char* query) {
+    // Broadcasts go out plain so every node understands them
+    bool marked = query[0] != '!' && profileFor(query[1]).markedQuery;
+
+    if (_echoSuppression) {
+        // A late reply or line noise left in the buffer would be taken for the echo
+        while (RS485.available() > 0) {
+            RS485.read();
+        }
+    }
+
+    _queryStart = micros();
     RS485.beginTransmission();
+    if (marked) {
+        RS485.write(_frameStart);
+    }
     RS485.print(query);
     RS485.println();
     RS485.endTransmission();
     RS485.flush();
+    if (_echoSuppression) {
+        discardEcho(query, marked);
+    }
     delay(WEATHERBUSLITE_GRACE);
 }
 
+/**
+ * Read back the echo of a frame just sent.
+ * 
+ * Stops at the first byte that differs, e.g. a reply or a collision, or when
+ * the echo stops arriving. A receive buffer that overflowed while sending
+ * simply ends the echo early.
+ * 
+ * @param query The frame that was sent, without CRLF
+ * @param marked True if the frame was preceded by the start marker
+ */
+void WeatherBusLite::discardEcho(const char *query, bool marked) {
+    char marker[2] = {_frameStart, '\0'};
+    const char *expected = marked ? marker : query;
+    bool lineEnd = false;
+    unsigned long lastByte = millis();
+    while (millis() - lastByte < WEATHERBUSLITE_ECHO_TIMEOUT) {
+        if (*expected == '\0') {
+            if (marked) {
+                expected = query;
+                marked = false;
+                continue;
+            }
+            if (lineEnd) {
+                return;
+            }
+            expected = "\r\n";
+            lineEnd = true;
+        }
+        if (!RS485.available()) {
+            continue;
+        }
+        if (RS485.peek() != (uint8_t)*expected) {
+            return;
+        }
+        RS485.read();
+        expected++;
+        lastByte = millis();
+    }
+}
+
 /**
  * Parse response from sensor.
  * 
@@ -190,51 +723,201 @@ void WeatherBusLite::sendQuery(const char* query) {
  * @param value The value of the response
  * @return True if parsing was successful, false otherwise
  */
-bool WeatherBusLite::parseResponse(char expectedType, float &value) {
-    enum ParseState { WAIT_FOR_START, READ_PAYLOAD, DONE };
-    ParseState state = WAIT_FOR_START; // Start in the waiting state
+bool WeatherBusLite::parseResponse(char expectedType, float &value, uint8_t &flags) {
+    memset(&_fields, 0, sizeof(_fields));
+
+    char response[32];  // Buffer for incoming data
+    if (readFrame(expectedType, response, sizeof(response)) < 0) {
+        return false;  // Timeout
+    }
+    _responseTime = millis();
+
+    if (!weatherBusLiteParseReading(response, value, _fields)) {
+        return false;  // Invalid response
+    }
+    flags = _fields.flags;
+    return acceptReading(expectedType, value);
+}
+
+/**
+ * Read a response frame.
+ * 
+ * Waits for a frame starting with the expected type and reads it up to the
+ * newline, which is not stored. The node's protocol profile picks how the
+ * frame is delimited and checked, see setProfile.
+ * 
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame, null-terminated on success
+ * @param size Size of the buffer
+ * @return Length of the frame, -1 on timeout or a bad checksum
+ */
+int WeatherBusLite::readFrame(char expectedType, char *frame, size_t size) {
+    FrameReader reader = profileFor(expectedType).read;
+    if (!_echoSuppression) {
+        RS485.receive();  // Enable receiving
+    }
+    int length = (this->*reader)(expectedType, frame, size);
+    if (!_echoSuppression) {
+        RS485.noReceive();  // Disable receiving
+    }
+    return length;
+}
+
+/**
+ * Read a plain frame.
+ * 
+ * The frame starts at the first byte equal to the expected type. Frames
+ * longer than the buffer are truncated.
+ * 
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame, null-terminated on success
+ * @param size Size of the buffer
+ * @return Length of the frame, -1 on timeout
+ */
+int WeatherBusLite::readPlainFrame(char expectedType, char *frame, size_t size) {
+    WeatherBusLiteDecoder decoder(frame, size);
+    decoder.begin(expectedType);
 
-    char response[32] = {0};  // Buffer for incoming data
-    int index = 0;            // Response buffer index
     unsigned long startMillis = millis();
-    RS485.receive();  // Enable receiving
     while (millis() - startMillis < WEATHERBUSLITE_RESPONSE_TIMEOUT) {
-        if (RS485.available()) {
-            char incoming = RS485.read();
-            // State machine to parse response
-            switch (state) {
-                case WAIT_FOR_START:
-                    if (incoming == expectedType) {  // Check if first char matches expected type (T, H, etc.)
-                        response[index++] = incoming;
-                        state = READ_PAYLOAD;
-                    }
-                    break;
-
-                case READ_PAYLOAD:
-                    if (incoming == '\n' || index >= sizeof(response) - 1) {
-                        response[index] = '\0';  // Null-terminate the string
-                        state = DONE;
-                    } else {
-                        response[index++] = incoming;
-                    }
-                    break;
-
-                case DONE:
-                    break;
-            }
+        if (RS485.available() && decoder.feedPlain(RS485.read())) {
+            return decoder.length();
+        }
+    }
 
-            if (state == DONE) {
-                char *colonPos = strchr(response, ':');  // Find colon in response
-                if (colonPos != nullptr) {
-                    value = atof(colonPos + 1);  // Convert string after ':' to float
-                    return true;  // Successfully parsed
-                }
-            }
+    return -1; // Timeout
+}
+
+/**
+ * Read a frame that begins with the start marker.
+ * 
+ * The marker must be followed by the expected type. Every marker starts
+ * over, dropping a partial or corrupted frame, and frames longer than the
+ * buffer are dropped rather than truncated.
+ * 
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame, without the marker
+ * @param size Size of the buffer
+ * @return Length of the frame, -1 on timeout
+ */
+int WeatherBusLite::readMarkedFrame(char expectedType, char *frame, size_t size) {
+    WeatherBusLiteDecoder decoder(frame, size);
+    decoder.begin(expectedType);
+
+    unsigned long startMillis = millis();
+    while (millis() - startMillis < WEATHERBUSLITE_RESPONSE_TIMEOUT) {
+        if (RS485.available() && decoder.feedMarked(RS485.read(), _frameStart)) {
+            return decoder.length();
         }
     }
 
-    RS485.noReceive();  // Disable receiving
+    return -1; // Timeout
+}
+
+/**
+ * Read a marked frame ending in a checksum.
+ * 
+ * The frame text is followed by "*<crc>", the CRC-16 in hex of everything
+ * between the marker and the '*'. The checksum is removed from the frame.
+ * 
+ * @param expectedType The expected type of the response
+ * @param frame Buffer for the frame, without the marker and checksum
+ * @param size Size of the buffer
+ * @return Length of the frame, -1 on timeout or a bad checksum
+ */
+int WeatherBusLite::readChecksummedFrame(char expectedType, char *frame, size_t size) {
+    if (readMarkedFrame(expectedType, frame, size) < 0) {
+        return -1;
+    }
+    return weatherBusLiteStripChecksum(frame);
+}
+
+/**
+ * Handle a successfully parsed reading.
+ * 
+ * Calibrates the reading, runs the sensor's filter, feeds the latency and
+ * value sketches and caches the reading for queryFresh.
+ * 
+ * @param type The sensor type
+ * @param value The parsed value, calibrated and possibly replaced by the filter
+ * @return True if the reading was accepted, false if the filter rejected it
+ */
+bool WeatherBusLite::acceptReading(char type, float &value) {
+    if (_latencySketch != nullptr) {
+        _latencySketch->add((micros() - _queryStart) / 1000.0f);
+    }
 
-    return false; // Timeout or invalid response
+    Sensor *sensor = findSensor(type, false);
+    if (sensor == nullptr) {
+        return true;
+    }
+    if (sensor->calibration != nullptr) {
+        value = weatherBusLiteCalibrate(*sensor->calibration, value);
+    }
+    if (sensor->filter != nullptr && !sensor->filter->apply(value, millis())) {
+        return false;
+    }
+    if (sensor->sketch != nullptr) {
+        sensor->sketch->add(value);
+    }
+
+    sensor->cached = value;
+    sensor->cachedFlags = _fields.flags;
+    sensor->cacheValid = lastSampleTime(sensor->cachedTime);
+    if (!sensor->cacheValid) {
+        sensor->cachedTime = _responseTime;
+        sensor->cacheValid = true;
+    }
+    sensor->nextSampleKnown = _fields.hasNextSample;
+    sensor->nextSample = _responseTime + _fields.nextSampleIn;
+    return true;
 }
 
+/**
+ * Find per-sensor settings.
+ * 
+ * @param type The sensor type
+ * @param create Whether to add an entry if the sensor has none
+ * @return The entry, or nullptr if not found or the table is full
+ */
+WeatherBusLite::Sensor *WeatherBusLite::findSensor(char type, bool create) {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        if (_sensors[i].type == type) {
+            return &_sensors[i];
+        }
+    }
+    if (!create || _sensorCount >= WEATHERBUSLITE_MAX_SENSORS) {
+        return nullptr;
+    }
+
+    Sensor &sensor = _sensors[_sensorCount++];
+    sensor.type = type;
+    sensor.calibration = nullptr;
+    sensor.sketch = nullptr;
+    sensor.filter = nullptr;
+    sensor.historyReceived = 0;
+    sensor.cacheValid = false;
+    sensor.nextSampleKnown = false;
+    sensor.profile = WEATHERBUSLITE_PROFILE_DEFAULT;
+    return &sensor;
+}
+
+/**
+ * Protocol profiles, indexed by WEATHERBUSLITE_PROFILE_*.
+ */
+const WeatherBusLite::Profile WeatherBusLite::_profiles[] = {
+    {&WeatherBusLite::readPlainFrame, false},        // DEFAULT, never used
+    {&WeatherBusLite::readPlainFrame, false},        // LEGACY
+    {&WeatherBusLite::readMarkedFrame, false},       // MARKED
+    {&WeatherBusLite::readChecksummedFrame, true},   // CHECKSUMMED
+};
+
+/**
+ * Find the profile to talk to a node with.
+ * 
+ * @param type The node's sensor type (T, H, etc.)
+ * @return The profile
+ */
+const WeatherBusLite::Profile &WeatherBusLite::profileFor(char type) {
+    return _profiles[profile(type)];
+}
\ No newline at end of file